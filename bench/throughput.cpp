@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Send and receive throughput between two peers in the same process. It runs under Node with the
+// mock WebRTC implementation, built with -DRTC_MOCK_WEBRTC=ON -DRTC_BUILD_BENCHMARKS=ON, or
+// natively against the stub backend.
+
+#include "rtc/rtc.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#include "rtcstub.hpp"
+#endif
+
+using namespace rtc;
+using namespace std::chrono_literals;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+bool waitUntil(const std::function<bool()> &predicate, std::chrono::milliseconds timeout) {
+#ifdef __EMSCRIPTEN__
+	double deadline = emscripten_get_now() + double(timeout.count());
+	while (!predicate()) {
+		if (emscripten_get_now() >= deadline)
+			return false;
+		emscripten_sleep(0);
+	}
+	return true;
+#else
+	return stub::runUntil(predicate, timeout);
+#endif
+}
+
+struct Pair {
+	shared_ptr<PeerConnection> local;
+	shared_ptr<PeerConnection> remote;
+	shared_ptr<DataChannel> sender;
+	shared_ptr<DataChannel> receiver;
+};
+
+Pair connectPair() {
+	Pair pair;
+	pair.local = std::make_shared<PeerConnection>();
+	pair.remote = std::make_shared<PeerConnection>();
+
+	auto local = pair.local.get();
+	auto remote = pair.remote.get();
+	local->onLocalDescription([remote](const Description &d) { remote->setRemoteDescription(d); });
+	local->onLocalCandidate([remote](const Candidate &c) { remote->addRemoteCandidate(c); });
+	remote->onLocalDescription([local](const Description &d) { local->setRemoteDescription(d); });
+	remote->onLocalCandidate([local](const Candidate &c) { local->addRemoteCandidate(c); });
+
+	auto receiver = std::make_shared<shared_ptr<DataChannel>>();
+	remote->onDataChannel([receiver](shared_ptr<DataChannel> dc) { *receiver = std::move(dc); });
+	pair.sender = local->createDataChannel("throughput");
+
+	if (!waitUntil([&]() { return pair.sender->isOpen() && *receiver && (*receiver)->isOpen(); },
+	               5s))
+		throw std::runtime_error("Peers failed to connect");
+
+	pair.receiver = std::move(*receiver);
+	return pair;
+}
+
+double seconds(clock_type::duration d) { return std::chrono::duration<double>(d).count(); }
+
+// Sends count messages in batches, letting the event loop deliver each batch before the next one
+// so that the buffered amount stays bounded. Send throughput only counts the time spent in send(),
+// receive throughput counts the time from the first send to the last message received.
+void run(Pair &pair, size_t size, size_t count) {
+	const size_t batch = std::max(size_t(1), size_t(1024 * 1024) / size);
+	binary message(size, byte(0x42));
+	size_t received = 0;
+	pair.receiver->onMessage([&received](binary) { ++received; }, [](string) {});
+
+	clock_type::duration sendTime{0};
+	auto start = clock_type::now();
+	size_t sent = 0;
+	while (sent < count) {
+		size_t n = std::min(batch, count - sent);
+		auto sendStart = clock_type::now();
+		for (size_t i = 0; i < n; ++i)
+			pair.sender->send(message.data(), message.size());
+		sendTime += clock_type::now() - sendStart;
+		sent += n;
+
+		if (!waitUntil([&]() { return received == sent; }, 10s))
+			throw std::runtime_error("Messages were not delivered");
+	}
+	auto total = clock_type::now() - start;
+
+	double mb = double(size) * double(count) / (1024.0 * 1024.0);
+	std::printf("%8zu B x %-7zu send %10.0f msg/s %9.1f MiB/s   receive %10.0f msg/s %9.1f MiB/s\n",
+	            size, count, double(count) / seconds(sendTime), mb / seconds(sendTime),
+	            double(count) / seconds(total), mb / seconds(total));
+}
+
+} // namespace
+
+int main() {
+	try {
+		Pair pair = connectPair();
+		run(pair, 16, 100000);
+		run(pair, 1024, 100000);
+		run(pair, 16 * 1024, 20000);
+		run(pair, 64 * 1024, 5000);
+		return 0;
+	} catch (const std::exception &e) {
+		std::fprintf(stderr, "Error: %s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Microbenchmarks of the C++ layer, built natively against the stub backend with
+// -DRTC_NATIVE_STUB=ON -DRTC_BUILD_BENCHMARKS=ON. Time spent in the backend is included, but it
+// is cheap compared to the JS library, so results mostly reflect the C++ paths.
+
+#include "rtc/rtc.h"
+#include "rtc/rtc.hpp"
+#include "rtcstub.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace rtc;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Pair {
+	shared_ptr<PeerConnection> local;
+	shared_ptr<PeerConnection> remote;
+	shared_ptr<DataChannel> sender;
+	shared_ptr<DataChannel> receiver;
+};
+
+// Connects two peers through the stub and opens a channel between them
+Pair connectPair(const string &label = "bench") {
+	Pair pair;
+	pair.local = std::make_shared<PeerConnection>();
+	pair.remote = std::make_shared<PeerConnection>();
+
+	auto local = pair.local.get();
+	auto remote = pair.remote.get();
+	local->onLocalDescription([remote](const Description &d) { remote->setRemoteDescription(d); });
+	local->onLocalCandidate([remote](const Candidate &c) { remote->addRemoteCandidate(c); });
+	remote->onLocalDescription([local](const Description &d) { local->setRemoteDescription(d); });
+	remote->onLocalCandidate([local](const Candidate &c) { local->addRemoteCandidate(c); });
+
+	auto receiver = std::make_shared<shared_ptr<DataChannel>>();
+	remote->onDataChannel([receiver](shared_ptr<DataChannel> dc) { *receiver = std::move(dc); });
+	pair.sender = local->createDataChannel(label);
+
+	bool connected = stub::runUntil(
+	    [&]() { return pair.sender->isOpen() && *receiver && (*receiver)->isOpen(); }, 1s);
+	if (!connected)
+		throw std::runtime_error("Stub peers failed to connect");
+
+	pair.receiver = std::move(*receiver);
+	return pair;
+}
+
+void BM_Send(benchmark::State &state) {
+	auto pair = connectPair();
+	binary message(size_t(state.range(0)), byte(0x42));
+	size_t received = 0;
+	pair.receiver->onMessage([&received](message_variant) { ++received; });
+
+	const size_t batch = 1024;
+	size_t count = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(pair.sender->send(message.data(), message.size()));
+		if (++count % batch == 0) {
+			// Deliver outside of the measurement so that buffers don't grow unbounded
+			state.PauseTiming();
+			stub::runPending();
+			state.ResumeTiming();
+		}
+	}
+	stub::runPending();
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Send)->Arg(16)->Arg(1024)->Arg(65536);
+
+void BM_SendString(benchmark::State &state) {
+	auto pair = connectPair();
+	string message(size_t(state.range(0)), 'x');
+	pair.receiver->onMessage([](message_variant) {});
+
+	const size_t batch = 1024;
+	size_t count = 0;
+	for (auto _ : state) {
+		// Goes through message_variant construction, like most applications
+		benchmark::DoNotOptimize(pair.sender->send(message));
+		if (++count % batch == 0) {
+			state.PauseTiming();
+			stub::runPending();
+			state.ResumeTiming();
+		}
+	}
+	stub::runPending();
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SendString)->Arg(16)->Arg(1024);
+
+void BM_ReceiveDispatch(benchmark::State &state) {
+	auto pair = connectPair();
+	binary message(size_t(state.range(0)), byte(0x42));
+	size_t received = 0;
+	pair.receiver->onMessage([&received](message_variant data) {
+		benchmark::DoNotOptimize(data);
+		++received;
+	});
+
+	const size_t batch = 256;
+	for (auto _ : state) {
+		state.PauseTiming();
+		for (size_t i = 0; i < batch; ++i)
+			pair.sender->send(message.data(), message.size());
+		state.ResumeTiming();
+
+		// Dispatches the batch to the receiver callback
+		stub::runPending();
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+	state.counters["received"] = double(received);
+}
+BENCHMARK(BM_ReceiveDispatch)->Arg(16)->Arg(1024)->Arg(65536);
+
+void BM_HandleLookup(benchmark::State &state) {
+	rtcConfiguration config = {};
+	int pc = rtcCreatePeerConnection(&config);
+	std::vector<int> ids;
+	for (int64_t i = 0; i < state.range(0); ++i)
+		ids.push_back(rtcCreateDataChannel(pc, ("channel-" + std::to_string(i)).c_str()));
+
+	std::mt19937 generator(42);
+	std::uniform_int_distribution<size_t> distribution(0, ids.size() - 1);
+	std::vector<int> order(4096);
+	for (auto &id : order)
+		id = ids[distribution(generator)];
+
+	size_t i = 0;
+	for (auto _ : state) {
+		// Resolves the handle through the C API maps
+		benchmark::DoNotOptimize(rtcGetBufferedAmount(order[i++ % order.size()]));
+	}
+	state.SetItemsProcessed(state.iterations());
+
+	rtcDeletePeerConnection(pc);
+	stub::runPending();
+}
+BENCHMARK(BM_HandleLookup)->Arg(1)->Arg(64)->Arg(1024);
+
+void BM_BroadcastFanOut(benchmark::State &state) {
+	std::vector<Pair> pairs;
+	PeerGroup group;
+	size_t received = 0;
+	for (int64_t i = 0; i < state.range(0); ++i) {
+		pairs.push_back(connectPair());
+		auto &pair = pairs.back();
+		pair.receiver->onMessage([&received](message_variant) { ++received; });
+		group.join("peer-" + std::to_string(i), pair.local, pair.sender);
+	}
+
+	binary message(256, byte(0x42));
+	for (auto _ : state) {
+		// One message to every member, then one callback per receiver
+		benchmark::DoNotOptimize(group.broadcast(message.data(), message.size()));
+		stub::runPending();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+	state.counters["received"] = double(received);
+}
+BENCHMARK(BM_BroadcastFanOut)->Arg(1)->Arg(8)->Arg(64);
+
+} // namespace
+
+BENCHMARK_MAIN();
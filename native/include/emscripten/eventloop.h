@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Native stand-in for the Emscripten header, see native/src/eventloop.cpp
+
+#ifndef EMSCRIPTEN_EVENTLOOP_H_STUB
+#define EMSCRIPTEN_EVENTLOOP_H_STUB
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int emscripten_set_timeout(void (*cb)(void *userData), double msecs, void *userData);
+void emscripten_clear_timeout(int id);
+long emscripten_set_interval(void (*cb)(void *userData), double intervalMsecs, void *userData);
+void emscripten_clear_interval(long id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMSCRIPTEN_EVENTLOOP_H_STUB
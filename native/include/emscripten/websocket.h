@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Native stand-in for the Emscripten header, see native/src/websocket.cpp
+
+#ifndef EMSCRIPTEN_WEBSOCKET_H_STUB
+#define EMSCRIPTEN_WEBSOCKET_H_STUB
+
+#include "emscripten.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int EMSCRIPTEN_WEBSOCKET_T;
+typedef int EMSCRIPTEN_RESULT;
+
+#define EMSCRIPTEN_RESULT_SUCCESS 0
+#define EMSCRIPTEN_RESULT_NOT_SUPPORTED -1
+#define EMSCRIPTEN_RESULT_INVALID_TARGET -4
+#define EMSCRIPTEN_RESULT_INVALID_PARAM -5
+#define EMSCRIPTEN_RESULT_FAILED -6
+
+typedef struct EmscriptenWebSocketOpenEvent {
+	EMSCRIPTEN_WEBSOCKET_T socket;
+} EmscriptenWebSocketOpenEvent;
+
+typedef struct EmscriptenWebSocketMessageEvent {
+	EMSCRIPTEN_WEBSOCKET_T socket;
+	uint8_t *data;
+	uint32_t numBytes;
+	EM_BOOL isText;
+} EmscriptenWebSocketMessageEvent;
+
+typedef struct EmscriptenWebSocketErrorEvent {
+	EMSCRIPTEN_WEBSOCKET_T socket;
+} EmscriptenWebSocketErrorEvent;
+
+typedef struct EmscriptenWebSocketCloseEvent {
+	EMSCRIPTEN_WEBSOCKET_T socket;
+	EM_BOOL wasClean;
+	unsigned short code;
+	char reason[512];
+} EmscriptenWebSocketCloseEvent;
+
+typedef struct EmscriptenWebSocketCreateAttributes {
+	const char *url;
+	const char *protocols;
+	EM_BOOL createOnMainThread;
+} EmscriptenWebSocketCreateAttributes;
+
+typedef EM_BOOL (*em_websocket_open_callback_func)(int eventType,
+                                                   const EmscriptenWebSocketOpenEvent *event,
+                                                   void *userData);
+typedef EM_BOOL (*em_websocket_message_callback_func)(int eventType,
+                                                      const EmscriptenWebSocketMessageEvent *event,
+                                                      void *userData);
+typedef EM_BOOL (*em_websocket_error_callback_func)(int eventType,
+                                                    const EmscriptenWebSocketErrorEvent *event,
+                                                    void *userData);
+typedef EM_BOOL (*em_websocket_close_callback_func)(int eventType,
+                                                    const EmscriptenWebSocketCloseEvent *event,
+                                                    void *userData);
+
+EM_BOOL emscripten_websocket_is_supported(void);
+EMSCRIPTEN_WEBSOCKET_T emscripten_websocket_new(EmscriptenWebSocketCreateAttributes *attributes);
+EMSCRIPTEN_RESULT emscripten_websocket_set_onopen_callback(EMSCRIPTEN_WEBSOCKET_T socket,
+                                                           void *userData,
+                                                           em_websocket_open_callback_func callback);
+EMSCRIPTEN_RESULT
+emscripten_websocket_set_onmessage_callback(EMSCRIPTEN_WEBSOCKET_T socket, void *userData,
+                                            em_websocket_message_callback_func callback);
+EMSCRIPTEN_RESULT
+emscripten_websocket_set_onerror_callback(EMSCRIPTEN_WEBSOCKET_T socket, void *userData,
+                                          em_websocket_error_callback_func callback);
+EMSCRIPTEN_RESULT
+emscripten_websocket_set_onclose_callback(EMSCRIPTEN_WEBSOCKET_T socket, void *userData,
+                                          em_websocket_close_callback_func callback);
+EMSCRIPTEN_RESULT emscripten_websocket_send_utf8_text(EMSCRIPTEN_WEBSOCKET_T socket,
+                                                      const char *textData);
+EMSCRIPTEN_RESULT emscripten_websocket_send_binary(EMSCRIPTEN_WEBSOCKET_T socket, void *binaryData,
+                                                   uint32_t dataLength);
+EMSCRIPTEN_RESULT emscripten_websocket_get_buffered_amount(EMSCRIPTEN_WEBSOCKET_T socket,
+                                                           size_t *bufferedAmount);
+EMSCRIPTEN_RESULT emscripten_websocket_close(EMSCRIPTEN_WEBSOCKET_T socket, unsigned short code,
+                                             const char *reason);
+EMSCRIPTEN_RESULT emscripten_websocket_delete(EMSCRIPTEN_WEBSOCKET_T socket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMSCRIPTEN_WEBSOCKET_H_STUB
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_STUB_H
+#define RTC_STUB_H
+
+// Control of the event loop emulated by the native stub backend, which replaces the browser when
+// the library is built with RTC_NATIVE_STUB. Everything runs on the calling thread: callbacks are
+// only invoked from these functions, like they would be from the browser event loop.
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+namespace rtc::stub {
+
+// Runs the tasks and timers that are due, including the ones they schedule in turn, and returns
+// the number of callbacks run. Timers in the future are not waited for.
+size_t runPending();
+
+// Runs the event loop, waiting for timers if necessary, until the predicate returns true or the
+// timeout expires. Returns the last result of the predicate.
+bool runUntil(const std::function<bool()> &predicate, std::chrono::milliseconds timeout);
+
+// Returns the number of pending tasks and timers
+size_t pendingCount();
+
+// WebSockets all connect to an in-memory server which echoes messages back. While it is down,
+// connections are refused, and taking it down makes open connections fail like a network loss.
+void setWebSocketServerUp(bool up);
+
+} // namespace rtc::stub
+
+#endif // RTC_STUB_H
@@ -0,0 +1,1536 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// In-memory loopback implementation of the functions of the JS library (wasm/js/webrtc.js), for
+// native builds with RTC_NATIVE_STUB. Peer connections in the same process are paired through a
+// session attribute in the SDP, so the application still exchanges descriptions and candidates,
+// then messages are delivered through the emulated event loop without loss. Like the JS library,
+// it reports state changes the way browsers do, so that the C++ layer runs the same code paths.
+
+#include "eventloop.hpp"
+
+#include <emscripten/emscripten.h>
+#include <emscripten/eventloop.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using rtc::stub::post;
+using std::optional;
+using std::string;
+
+const int MaxMessageSize = 262144;
+
+// Same encoding as in the JS library
+enum HeapSource { HeapMessages = 0, HeapSdp, HeapCandidates, HeapErrors, HeapOther, HeapCount };
+
+enum class SignalingState {
+	Stable = 0,
+	HaveLocalOffer,
+	HaveRemoteOffer,
+	HaveLocalPranswer,
+	HaveRemotePranswer,
+	Closed
+};
+enum class ConnectionState { New = 0, Connecting, Connected, Disconnected, Failed, Closed };
+enum class IceState { New = 0, Checking, Connected, Completed, Failed, Disconnected, Closed };
+enum class GatheringState { New = 0, Gathering, Complete };
+enum class ChannelState { Connecting, Open, Closing, Closed };
+
+struct SessionDescription {
+	string type;
+	string sdp;
+};
+
+struct Channel {
+	int id;
+	int pc;         // owning connection
+	int remote = 0; // paired channel on the remote connection
+	string label;
+	string protocol;
+	bool unordered = false;
+	bool negotiated = false;
+	int maxRetransmits = -1;
+	int maxPacketLifeTime = -1;
+	int stream = -1;
+	ChannelState state = ChannelState::Connecting;
+	size_t bufferedAmount = 0;
+	size_t bufferedAmountLowThreshold = 0;
+	uint64_t messagesSent = 0;
+	uint64_t messagesReceived = 0;
+	bool userDeleted = false;
+	void *userPointer = nullptr;
+	void (*openCallback)(void *) = nullptr;
+	void (*errorCallback)(const char *, void *) = nullptr;
+	void (*messageCallback)(const char *, int, void *) = nullptr;
+	void (*bufferedAmountLowCallback)(void *) = nullptr;
+};
+
+struct Connection {
+	int id;
+	bool autoNegotiation = true;
+	int candidateSignaling = 0;
+	int candidateBatchInterval = 50;
+	int maxGatheringDelay = 0;
+
+	SignalingState signalingState = SignalingState::Stable;
+	ConnectionState state = ConnectionState::New;
+	IceState iceState = IceState::New;
+	GatheringState gatheringState = GatheringState::New;
+
+	optional<SessionDescription> localDescription;
+	optional<SessionDescription> remoteDescription;
+	optional<SessionDescription> pendingLocalDescription;
+	string iceUfrag;
+	string icePwd;
+	string gatheredUfrag;
+	std::vector<string> candidates;
+	int remoteSession = 0;
+	int remoteCandidates = 0;
+	int remote = 0;                  // paired connection once connected
+	string connectedUfrag;           // remote ICE ufrag the pair was selected with
+	optional<bool> dtlsClient;       // the answerer is the client, fixed by the first negotiation
+	bool negotiated = false;         // the application m-line has been negotiated
+	bool negotiationNeeded = false;
+	bool negotiationNeededScheduled = false;
+	bool iceRestart = false;         // the next offer restarts ICE
+	bool descriptionPending = false; // waiting for gathering in non-trickle mode
+	int negotiationTimeout = 0;
+	int candidateTimeout = 0;
+	int gatheringTimeout = 0;
+	long statsInterval = 0;
+	double *statsBuffer = nullptr;
+	std::vector<std::pair<string, string>> candidateQueue;
+	std::set<int> channels;
+	uint64_t bytesSent = 0;
+	uint64_t bytesReceived = 0;
+	bool userDeleted = false;
+
+	void *userPointer = nullptr;
+	void (*dataChannelCallback)(int, void *) = nullptr;
+	void (*descriptionCallback)(const char *, const char *, void *) = nullptr;
+	void (*candidateCallback)(const char *, const char *, void *) = nullptr;
+	void (*candidatesCallback)(const char *, int, void *) = nullptr;
+	void (*stateChangeCallback)(int, void *) = nullptr;
+	void (*iceStateChangeCallback)(int, void *) = nullptr;
+	void (*gatheringStateChangeCallback)(int, void *) = nullptr;
+	void (*signalingStateChangeCallback)(int, void *) = nullptr;
+	void (*selectedCandidatePairChangeCallback)(void *) = nullptr;
+};
+
+struct Message {
+	int source;
+	int sink;
+	std::shared_ptr<const string> data; // shared between the sinks of a multi-send
+	bool binary;
+};
+
+// Mirrors the accounting of the JS library, compiled out unless RTC_ENABLE_HEAP_STATS is set
+struct HeapAccounting {
+#if RTC_ENABLE_HEAP_STATS
+	std::array<double, HeapCount> live = {};
+	std::array<double, HeapCount> allocations = {};
+	std::array<double, HeapCount> peak = {};
+	double totalLive = 0;
+	double totalPeak = 0;
+	std::unordered_map<void *, std::pair<size_t, int>> entries;
+
+	void add(int source, size_t size) {
+		live[source] += double(size);
+		allocations[source] += 1;
+		peak[source] = std::max(peak[source], live[source]);
+		totalLive += double(size);
+		totalPeak = std::max(totalPeak, totalLive);
+	}
+
+	void remove(int source, size_t size) {
+		live[source] -= double(size);
+		totalLive -= double(size);
+	}
+#else
+	void add(int, size_t) {}
+	void remove(int, size_t) {}
+#endif
+};
+
+int nextId = 1;
+std::unordered_map<int, std::unique_ptr<Connection>> connections;
+std::unordered_map<int, std::unique_ptr<Channel>> channels;
+std::unordered_set<int> certificates;
+std::deque<Message> messageQueue;
+bool messageFlushScheduled = false;
+HeapAccounting heap;
+
+Connection *findConnection(int pc) {
+	auto it = connections.find(pc);
+	return it != connections.end() ? it->second.get() : nullptr;
+}
+
+Channel *findChannel(int dc) {
+	auto it = channels.find(dc);
+	return it != channels.end() ? it->second.get() : nullptr;
+}
+
+void logError(const string &message) { std::fprintf(stderr, "rtc stub: %s\n", message.c_str()); }
+
+// Strings passed to the C++ layer, which frees them with js_rtcFree()
+char *allocString(const string &str, [[maybe_unused]] int source) {
+	size_t size = str.size() + 1;
+	char *ptr = static_cast<char *>(std::malloc(size));
+	std::memcpy(ptr, str.c_str(), size);
+#if RTC_ENABLE_HEAP_STATS
+	heap.add(source, size);
+	heap.entries.emplace(ptr, std::make_pair(size, source));
+#endif
+	return ptr;
+}
+
+void freeString(void *ptr) {
+	if (!ptr)
+		return;
+
+#if RTC_ENABLE_HEAP_STATS
+	if (auto it = heap.entries.find(ptr); it != heap.entries.end()) {
+		heap.remove(it->second.second, it->second.first);
+		heap.entries.erase(it);
+	}
+#endif
+	std::free(ptr);
+}
+
+// Same semantics as stringToUTF8() and lengthBytesUTF8() in Emscripten
+int copyString(const string &str, char *buffer, int size) {
+	if (buffer && size > 0) {
+		size_t len = std::min(str.size(), size_t(size - 1));
+		std::memcpy(buffer, str.data(), len);
+		buffer[len] = '\0';
+	}
+	return int(str.size());
+}
+
+string randomString(size_t length) {
+	static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	string str(length, ' ');
+	for (auto &c : str)
+		c = chars[size_t(emscripten_random() * (sizeof(chars) - 1)) % (sizeof(chars) - 1)];
+	return str;
+}
+
+string fingerprint(int session) {
+	string str;
+	char hex[4];
+	for (int i = 0; i < 32; ++i) {
+		std::snprintf(hex, sizeof(hex), i > 0 ? ":%02X" : "%02X", (session * 31 + i * 17) & 0xFF);
+		str += hex;
+	}
+	return str;
+}
+
+string hostCandidate(int session) {
+	return "candidate:1 1 udp 2122260223 127.0.0.1 " + std::to_string(10000 + session) + " typ host";
+}
+
+optional<string> sdpAttribute(const string &sdp, const string &name) {
+	string prefix = "a=" + name + ":";
+	size_t pos = 0;
+	while (pos < sdp.size()) {
+		size_t end = sdp.find('\n', pos);
+		if (end == string::npos)
+			end = sdp.size();
+
+		if (sdp.compare(pos, prefix.size(), prefix) == 0) {
+			size_t last = end;
+			if (last > pos && sdp[last - 1] == '\r')
+				--last;
+			return sdp.substr(pos + prefix.size(), last - pos - prefix.size());
+		}
+		pos = end + 1;
+	}
+	return std::nullopt;
+}
+
+int countCandidates(const string &sdp) {
+	int count = 0;
+	size_t pos = 0;
+	while ((pos = sdp.find("a=candidate:", pos)) != string::npos) {
+		if (pos == 0 || sdp[pos - 1] == '\n')
+			++count;
+		pos += 12;
+	}
+	return count;
+}
+
+string replaceAttribute(const string &sdp, const string &name, const string &value) {
+	string prefix = "a=" + name + ":";
+	string result;
+	size_t pos = 0;
+	while (pos < sdp.size()) {
+		size_t end = sdp.find('\n', pos);
+		end = end != string::npos ? end + 1 : sdp.size();
+		if (sdp.compare(pos, prefix.size(), prefix) == 0)
+			result += prefix + value + (sdp[end - 1] == '\n' ? "\r\n" : "");
+		else
+			result.append(sdp, pos, end - pos);
+		pos = end;
+	}
+	return result;
+}
+
+// State notifications
+
+void setSignalingState(Connection *c, SignalingState state);
+void negotiationNeeded(Connection *c);
+
+void notifySignalingState(Connection *c) {
+	if (c->userDeleted || !c->signalingStateChangeCallback)
+		return;
+	if (c->signalingState != SignalingState::Closed)
+		c->signalingStateChangeCallback(int(c->signalingState), c->userPointer);
+}
+
+void setSignalingState(Connection *c, SignalingState state) {
+	if (c->signalingState == state)
+		return;
+
+	c->signalingState = state;
+	notifySignalingState(c);
+	if (state == SignalingState::Stable && c->negotiationNeeded)
+		negotiationNeeded(c);
+}
+
+void setGatheringState(Connection *c, GatheringState state) {
+	if (c->gatheringState == state)
+		return;
+
+	c->gatheringState = state;
+	if (!c->userDeleted && c->gatheringStateChangeCallback)
+		c->gatheringStateChangeCallback(int(state), c->userPointer);
+}
+
+void setConnectionStates(int pc, IceState iceState, ConnectionState state) {
+	Connection *c = findConnection(pc);
+	if (c && c->iceState != iceState) {
+		c->iceState = iceState;
+		if (!c->userDeleted && c->iceStateChangeCallback)
+			c->iceStateChangeCallback(int(iceState), c->userPointer);
+	}
+	c = findConnection(pc); // the callback might have deleted it
+	if (c && c->state != state) {
+		c->state = state;
+		if (!c->userDeleted && c->stateChangeCallback)
+			c->stateChangeCallback(int(state), c->userPointer);
+	}
+}
+
+// Data channels
+
+void channelOpen(int dc) {
+	Channel *ch = findChannel(dc);
+	if (!ch || ch->state != ChannelState::Connecting)
+		return;
+
+	ch->state = ChannelState::Open;
+	if (!ch->userDeleted && ch->openCallback)
+		ch->openCallback(ch->userPointer);
+}
+
+void channelClosed(int dc) {
+	Channel *ch = findChannel(dc);
+	if (!ch || ch->state == ChannelState::Closed)
+		return;
+
+	ch->state = ChannelState::Closed;
+	if (Connection *c = findConnection(ch->pc))
+		c->channels.erase(dc);
+
+	// A null message signals the closing, like in the JS library
+	if (!ch->userDeleted && ch->messageCallback)
+		ch->messageCallback(nullptr, 0, ch->userPointer);
+}
+
+void eraseChannel(int dc) {
+	Channel *ch = findChannel(dc);
+	if (!ch)
+		return;
+
+	if (Connection *c = findConnection(ch->pc))
+		c->channels.erase(dc);
+
+	// Keep the remote side consistent for messages in flight
+	if (Channel *r = findChannel(ch->remote))
+		r->remote = 0;
+
+	channels.erase(dc);
+}
+
+void unregisterChannel(int dc) {
+	Channel *ch = findChannel(dc);
+	if (!ch)
+		return;
+
+	ch->userDeleted = true;
+	ch->openCallback = nullptr;
+	ch->errorCallback = nullptr;
+	ch->messageCallback = nullptr;
+	ch->bufferedAmountLowCallback = nullptr;
+	if (ch->state != ChannelState::Closed) {
+		// The remote side still gets notified, then the local object is dropped
+		int remote = ch->remote;
+		if (Channel *r = findChannel(remote); r && r->state == ChannelState::Open)
+			r->state = ChannelState::Closing;
+		post([remote]() { channelClosed(remote); });
+	}
+	eraseChannel(dc);
+}
+
+int createChannel(Connection *c, const string &label, bool unordered, int maxRetransmits,
+                  int maxPacketLifeTime, const string &protocol, bool negotiated, int stream) {
+	if (maxRetransmits >= 0 && maxPacketLifeTime >= 0) {
+		logError("maxRetransmits and maxPacketLifeTime are mutually exclusive");
+		return 0;
+	}
+	if (negotiated && stream < 0) {
+		logError("Negotiated DataChannel requires an id");
+		return 0;
+	}
+
+	auto ch = std::make_unique<Channel>();
+	ch->id = nextId++;
+	ch->pc = c->id;
+	ch->label = label;
+	ch->protocol = protocol;
+	ch->unordered = unordered;
+	ch->maxRetransmits = maxRetransmits;
+	ch->maxPacketLifeTime = maxRetransmits >= 0 ? -1 : maxPacketLifeTime;
+	ch->negotiated = negotiated;
+	ch->stream = stream;
+	int dc = ch->id;
+	channels.emplace(dc, std::move(ch));
+	c->channels.insert(dc);
+	return dc;
+}
+
+void flushMessages() {
+	messageFlushScheduled = false;
+	// Only deliver what was queued before, new sends wait for the next iteration
+	std::deque<Message> queue;
+	std::swap(queue, messageQueue);
+	for (const auto &message : queue) {
+		size_t size = message.data->size();
+		if (Channel *source = findChannel(message.source)) {
+			bool wasAbove = source->bufferedAmount > source->bufferedAmountLowThreshold;
+			source->bufferedAmount -= std::min(size, source->bufferedAmount);
+			if (wasAbove && source->bufferedAmount <= source->bufferedAmountLowThreshold &&
+			    !source->userDeleted && source->bufferedAmountLowCallback)
+				source->bufferedAmountLowCallback(source->userPointer);
+		}
+
+		Channel *sink = findChannel(message.sink);
+		if (!sink || sink->state != ChannelState::Open)
+			continue;
+
+		sink->messagesReceived++;
+		if (Connection *c = findConnection(sink->pc))
+			c->bytesReceived += size;
+
+		if (sink->userDeleted || !sink->messageCallback)
+			continue;
+
+		// The JS library copies each message to the heap for the duration of the callback
+		heap.add(HeapMessages, message.binary ? size : size + 1);
+		sink->messageCallback(message.data->c_str(), message.binary ? int(size) : -1,
+		                      sink->userPointer);
+		heap.remove(HeapMessages, message.binary ? size : size + 1);
+	}
+}
+
+int sendMessage(Channel *ch, std::shared_ptr<const string> data, bool binary) {
+	if (ch->state != ChannelState::Open)
+		return -1;
+
+	size_t size = data->size();
+	if (size > size_t(MaxMessageSize)) {
+		logError("Message size exceeds the maximum");
+		return -1;
+	}
+
+	ch->bufferedAmount += size;
+	ch->messagesSent++;
+	if (Connection *c = findConnection(ch->pc))
+		c->bytesSent += size;
+
+	messageQueue.push_back(Message{ch->id, ch->remote, std::move(data), binary});
+	if (!messageFlushScheduled) {
+		messageFlushScheduled = true;
+		post(flushMessages);
+	}
+	return int(ch->bufferedAmount);
+}
+
+// Connections
+
+string buildSdp(Connection *c, const string &setup) {
+	string sdp;
+	sdp += "v=0\r\n";
+	sdp += "o=- " + std::to_string(c->id) + " 2 IN IP4 127.0.0.1\r\n";
+	sdp += "s=-\r\n";
+	sdp += "t=0 0\r\n";
+	sdp += "a=group:BUNDLE 0\r\n";
+	sdp += "a=x-mock-session:" + std::to_string(c->id) + "\r\n";
+	sdp += "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n";
+	sdp += "c=IN IP4 0.0.0.0\r\n";
+	sdp += "a=mid:0\r\n";
+	sdp += "a=ice-ufrag:" + c->iceUfrag + "\r\n";
+	sdp += "a=ice-pwd:" + c->icePwd + "\r\n";
+	sdp += "a=ice-options:trickle\r\n";
+	sdp += "a=fingerprint:sha-256 " + fingerprint(c->id) + "\r\n";
+	sdp += "a=setup:" + setup + "\r\n";
+	sdp += "a=sctp-port:5000\r\n";
+	sdp += "a=max-message-size:" + std::to_string(MaxMessageSize) + "\r\n";
+	if (c->gatheredUfrag == c->iceUfrag) {
+		for (const auto &candidate : c->candidates)
+			sdp += "a=" + candidate + "\r\n";
+		if (c->gatheringState == GatheringState::Complete)
+			sdp += "a=end-of-candidates\r\n";
+	}
+	return sdp;
+}
+
+void negotiate(int pc, string type, const string &iceUfrag, const string &icePwd);
+void tryConnect(int pc);
+void selectPair(Connection *c);
+
+void scheduleNegotiation(Connection *c) {
+	// Coalesce negotiation requests so that a single offer is generated
+	if (c->negotiationTimeout)
+		return;
+
+	c->negotiationTimeout = emscripten_set_timeout(
+	    [](void *ptr) {
+		    int pc = int(reinterpret_cast<intptr_t>(ptr));
+		    Connection *c = findConnection(pc);
+		    if (!c)
+			    return;
+		    c->negotiationTimeout = 0;
+		    if (c->userDeleted || !c->negotiationNeeded)
+			    return;
+		    if (c->signalingState != SignalingState::Stable)
+			    return;
+		    negotiate(pc, "offer", "", "");
+	    },
+	    0, reinterpret_cast<void *>(intptr_t(c->id)));
+}
+
+void negotiationNeeded(Connection *c) {
+	c->negotiationNeeded = true;
+	if (c->negotiationNeededScheduled)
+		return;
+
+	c->negotiationNeededScheduled = true;
+	int pc = c->id;
+	post([pc]() {
+		Connection *c = findConnection(pc);
+		if (!c)
+			return;
+		c->negotiationNeededScheduled = false;
+		// Like in browsers, the event is delayed until the signaling state is stable
+		if (!c->negotiationNeeded || c->signalingState != SignalingState::Stable)
+			return;
+		if (c->autoNegotiation && !c->userDeleted)
+			scheduleNegotiation(c);
+	});
+}
+
+void restartCredentials(Connection *c) {
+	c->iceUfrag = randomString(4);
+	c->icePwd = randomString(24);
+}
+
+void flushCandidates(Connection *c) {
+	if (c->candidateTimeout) {
+		emscripten_clear_timeout(c->candidateTimeout);
+		c->candidateTimeout = 0;
+	}
+	auto queue = std::move(c->candidateQueue);
+	c->candidateQueue.clear();
+	if (c->userDeleted || !c->candidatesCallback || queue.empty())
+		return;
+
+	// Candidates are packed as consecutive null-terminated candidate and mid strings
+	string buffer;
+	for (const auto &[candidate, mid] : queue) {
+		buffer.append(candidate).push_back('\0');
+		buffer.append(mid).push_back('\0');
+	}
+	heap.add(HeapCandidates, buffer.size());
+	c->candidatesCallback(buffer.data(), int(queue.size()), c->userPointer);
+	heap.remove(HeapCandidates, buffer.size());
+}
+
+void emitDescription(Connection *c) {
+	c->descriptionPending = false;
+	if (c->gatheringTimeout) {
+		emscripten_clear_timeout(c->gatheringTimeout);
+		c->gatheringTimeout = 0;
+	}
+	if (!c->descriptionCallback || !c->localDescription)
+		return;
+
+	const auto &desc = *c->localDescription;
+	size_t size = desc.sdp.size() + desc.type.size() + 2;
+	heap.add(HeapSdp, size);
+	c->descriptionCallback(desc.sdp.c_str(), desc.type.c_str(), c->userPointer);
+	heap.remove(HeapSdp, size);
+}
+
+void handleCandidate(Connection *c, const string &candidate) {
+	if (c->userDeleted || c->candidateSignaling == 2) // non-trickle: embedded in the description
+		return;
+
+	if (c->candidateSignaling == 1) {
+		c->candidateQueue.emplace_back(candidate, "0");
+		if (!c->candidateTimeout) {
+			c->candidateTimeout = emscripten_set_timeout(
+			    [](void *ptr) {
+				    if (Connection *c = findConnection(int(reinterpret_cast<intptr_t>(ptr)))) {
+					    c->candidateTimeout = 0;
+					    flushCandidates(c);
+				    }
+			    },
+			    c->candidateBatchInterval, reinterpret_cast<void *>(intptr_t(c->id)));
+		}
+		return;
+	}
+
+	if (!c->candidateCallback)
+		return;
+
+	size_t size = candidate.size() + 3;
+	heap.add(HeapCandidates, size);
+	c->candidateCallback(candidate.c_str(), "0", c->userPointer);
+	heap.remove(HeapCandidates, size);
+}
+
+void handleGatheringComplete(Connection *c) {
+	if (c->userDeleted)
+		return;
+	if (c->candidateSignaling == 1)
+		flushCandidates(c);
+	if (c->descriptionPending)
+		emitDescription(c);
+}
+
+void gather(Connection *c) {
+	if (c->gatheredUfrag == c->iceUfrag)
+		return;
+
+	c->gatheredUfrag = c->iceUfrag;
+	c->candidates.clear();
+	int pc = c->id;
+	post([pc]() {
+		Connection *c = findConnection(pc);
+		if (!c || c->signalingState == SignalingState::Closed)
+			return;
+
+		setGatheringState(c, GatheringState::Gathering);
+		if (!(c = findConnection(pc)))
+			return;
+
+		string candidate = hostCandidate(c->id);
+		c->candidates.push_back(candidate);
+		handleCandidate(c, candidate);
+
+		post([pc]() {
+			Connection *c = findConnection(pc);
+			if (!c || c->signalingState == SignalingState::Closed)
+				return;
+
+			setGatheringState(c, GatheringState::Complete);
+			if (!(c = findConnection(pc)))
+				return;
+
+			// The local description now embeds the candidates, like in browsers
+			if (c->localDescription) {
+				auto setup = sdpAttribute(c->localDescription->sdp, "setup").value_or("actpass");
+				c->localDescription->sdp = buildSdp(c, setup);
+			}
+			handleGatheringComplete(c);
+		});
+	});
+}
+
+bool isAssociated(Connection *c) {
+	Connection *r = findConnection(c->remote);
+	return r && c->state == ConnectionState::Connected && r->remote == c->id &&
+	       r->state == ConnectionState::Connected;
+}
+
+int allocateStream(Connection *c, Connection *r) {
+	std::set<int> used;
+	for (int dc : c->channels)
+		if (Channel *ch = findChannel(dc); ch && ch->stream >= 0)
+			used.insert(ch->stream);
+	for (int dc : r->channels)
+		if (Channel *ch = findChannel(dc); ch && ch->stream >= 0)
+			used.insert(ch->stream);
+
+	// The DTLS client uses even stream IDs and the server odd ones
+	int stream = c->dtlsClient.value_or(false) ? 0 : 1;
+	while (used.count(stream))
+		stream += 2;
+	return stream;
+}
+
+void linkChannels(Connection *c) {
+	Connection *r = findConnection(c->remote);
+	if (!r)
+		return;
+
+	std::vector<int> incoming;
+	std::vector<int> local(c->channels.begin(), c->channels.end());
+	for (int dc : local) {
+		Channel *ch = findChannel(dc);
+		if (!ch || ch->remote || ch->state != ChannelState::Connecting)
+			continue;
+
+		if (ch->negotiated) {
+			Channel *match = nullptr;
+			for (int rdc : r->channels) {
+				Channel *other = findChannel(rdc);
+				if (other && other->negotiated && other->stream == ch->stream && !other->remote &&
+				    other->state == ChannelState::Connecting) {
+					match = other;
+					break;
+				}
+			}
+			if (!match)
+				continue; // wait for the remote side to create it
+
+			ch->remote = match->id;
+			match->remote = ch->id;
+			int rdc = match->id;
+			post([dc]() { channelOpen(dc); });
+			post([rdc]() { channelOpen(rdc); });
+			continue;
+		}
+
+		if (ch->stream < 0)
+			ch->stream = allocateStream(c, r);
+
+		int rdc = createChannel(r, ch->label, ch->unordered, ch->maxRetransmits,
+		                        ch->maxPacketLifeTime, ch->protocol, false, ch->stream);
+		ch = findChannel(dc);
+		Channel *other = findChannel(rdc);
+		ch->remote = rdc;
+		other->remote = dc;
+		incoming.push_back(rdc);
+		post([dc]() { channelOpen(dc); });
+	}
+
+	if (incoming.empty())
+		return;
+
+	int rpc = r->id;
+	post([rpc, incoming]() {
+		for (int rdc : incoming) {
+			Connection *r = findConnection(rpc);
+			if (!r || r->signalingState == SignalingState::Closed)
+				return;
+
+			if (!r->userDeleted && r->dataChannelCallback)
+				r->dataChannelCallback(rdc, r->userPointer);
+
+			channelOpen(rdc);
+		}
+	});
+}
+
+void completeNegotiation(Connection *c) {
+	if (!c->localDescription || !c->remoteDescription)
+		return;
+
+	c->negotiated = true;
+	if (!c->dtlsClient)
+		c->dtlsClient = c->localDescription->type == "answer";
+
+	// An answer negotiates the application m-line too, but not an ICE restart
+	if (!c->iceRestart)
+		c->negotiationNeeded = false;
+
+	if (c->remote && sdpAttribute(c->remoteDescription->sdp, "ice-ufrag").value_or("") !=
+	                     c->connectedUfrag) {
+		// ICE restart while connected: check the new credentials, like Firefox does
+		int pc = c->id;
+		setConnectionStates(pc, IceState::Checking, ConnectionState::Connected);
+		post([pc]() {
+			Connection *c = findConnection(pc);
+			if (c && c->remote && c->signalingState != SignalingState::Closed)
+				selectPair(c);
+		});
+		return;
+	}
+
+	tryConnect(c->id);
+}
+
+void selectPair(Connection *c) {
+	int pc = c->id;
+	c->connectedUfrag = sdpAttribute(c->remoteDescription->sdp, "ice-ufrag").value_or("");
+	setConnectionStates(pc, IceState::Connected, ConnectionState::Connected);
+	c = findConnection(pc);
+	if (c && !c->userDeleted && c->selectedCandidatePairChangeCallback)
+		c->selectedCandidatePairChangeCallback(c->userPointer);
+}
+
+void tryConnect(int pc) {
+	Connection *c = findConnection(pc);
+	if (!c || c->remote || c->signalingState == SignalingState::Closed)
+		return;
+	if (!c->negotiated || c->remoteCandidates == 0)
+		return;
+
+	Connection *r = findConnection(c->remoteSession);
+	if (!r || r->remoteSession != pc || r->signalingState == SignalingState::Closed)
+		return;
+
+	c->remote = r->id;
+	int rpc = r->id;
+	setConnectionStates(pc, IceState::Checking, ConnectionState::Connecting);
+	tryConnect(rpc); // in case it was waiting for this side
+	post([pc, rpc]() {
+		Connection *c = findConnection(pc);
+		if (!c || c->signalingState == SignalingState::Closed)
+			return;
+
+		selectPair(c);
+		c = findConnection(pc);
+		if (c && isAssociated(c)) {
+			linkChannels(c);
+			if (Connection *r = findConnection(rpc))
+				linkChannels(r);
+		}
+	});
+}
+
+void disconnected(int pc, std::vector<int> remoteChannels) {
+	Connection *c = findConnection(pc);
+	if (!c || c->signalingState == SignalingState::Closed)
+		return;
+
+	c->remote = 0;
+	for (int dc : remoteChannels)
+		channelClosed(dc);
+
+	setConnectionStates(pc, IceState::Disconnected, ConnectionState::Disconnected);
+	post([pc]() {
+		Connection *c = findConnection(pc);
+		if (c && c->signalingState != SignalingState::Closed)
+			setConnectionStates(pc, IceState::Failed, ConnectionState::Failed);
+	});
+}
+
+void closeConnection(Connection *c) {
+	if (c->negotiationTimeout)
+		emscripten_clear_timeout(c->negotiationTimeout);
+	if (c->statsInterval)
+		emscripten_clear_interval(c->statsInterval);
+	if (c->candidateTimeout)
+		emscripten_clear_timeout(c->candidateTimeout);
+	if (c->gatheringTimeout)
+		emscripten_clear_timeout(c->gatheringTimeout);
+	c->negotiationTimeout = 0;
+	c->statsInterval = 0;
+	c->candidateTimeout = 0;
+	c->gatheringTimeout = 0;
+	c->candidateQueue.clear();
+	if (c->signalingState == SignalingState::Closed)
+		return;
+
+	// As specified, closing the connection fires no events locally
+	c->signalingState = SignalingState::Closed;
+	c->iceState = IceState::Closed;
+	c->state = ConnectionState::Closed;
+
+	int pc = c->id;
+	int rpc = c->remote;
+	c->remote = 0;
+	std::vector<int> local(c->channels.begin(), c->channels.end());
+	std::vector<int> remoteChannels;
+	for (int dc : local) {
+		if (Channel *ch = findChannel(dc)) {
+			if (ch->remote)
+				remoteChannels.push_back(ch->remote);
+			ch->state = ChannelState::Closed;
+		}
+	}
+	if (rpc)
+		post([rpc, remoteChannels]() { disconnected(rpc, remoteChannels); });
+
+	// Browsers don't fire close events on channels when the connection is closed, so the JS
+	// library notifies them, then unregisters them in case the user did not delete them
+	for (int dc : local) {
+		Channel *ch = findChannel(dc);
+		if (ch && !ch->userDeleted && ch->messageCallback)
+			ch->messageCallback(nullptr, 0, ch->userPointer);
+		if ((ch = findChannel(dc))) {
+			ch->userDeleted = true;
+			eraseChannel(dc);
+		}
+	}
+	if ((c = findConnection(pc)))
+		c->channels.clear();
+}
+
+void setLocalDescription(int pc, SessionDescription description) {
+	Connection *c = findConnection(pc);
+	if (!c)
+		return;
+
+	const string &type = description.type;
+	SignalingState state = c->signalingState;
+	optional<SignalingState> next;
+	if (type == "offer" &&
+	    (state == SignalingState::Stable || state == SignalingState::HaveLocalOffer))
+		next = SignalingState::HaveLocalOffer;
+	else if (type == "answer" && (state == SignalingState::HaveRemoteOffer ||
+	                              state == SignalingState::HaveLocalPranswer))
+		next = SignalingState::Stable;
+	else if (type == "pranswer" && (state == SignalingState::HaveRemoteOffer ||
+	                                state == SignalingState::HaveLocalPranswer))
+		next = SignalingState::HaveLocalPranswer;
+	else if (type == "rollback" && state == SignalingState::HaveLocalOffer)
+		next = SignalingState::Stable;
+
+	if (!next) {
+		logError("Cannot set local " + type + " description in state " +
+		         std::to_string(int(state)));
+		return;
+	}
+
+	if (type == "rollback") {
+		c->localDescription = std::move(c->pendingLocalDescription);
+		c->pendingLocalDescription.reset();
+	} else {
+		if (auto ufrag = sdpAttribute(description.sdp, "ice-ufrag"))
+			c->iceUfrag = *ufrag;
+		if (auto pwd = sdpAttribute(description.sdp, "ice-pwd"))
+			c->icePwd = *pwd;
+		if (type == "offer") {
+			c->pendingLocalDescription = c->localDescription;
+			c->negotiationNeeded = false;
+			c->iceRestart = false;
+		}
+		c->localDescription = std::move(description);
+	}
+
+	setSignalingState(c, *next);
+	if (!(c = findConnection(pc)))
+		return;
+
+	if (type != "rollback")
+		gather(c);
+
+	if (*next == SignalingState::Stable && type != "rollback")
+		completeNegotiation(c);
+}
+
+void handleDescription(int pc, SessionDescription description) {
+	// setLocalDescription() is asynchronous in browsers
+	post([pc, description = std::move(description)]() mutable {
+		setLocalDescription(pc, std::move(description));
+		Connection *c = findConnection(pc);
+		if (!c || c->userDeleted)
+			return;
+
+		if (c->candidateSignaling == 2 && c->gatheringState != GatheringState::Complete) {
+			// Non-trickle: wait for candidates to be embedded in the description
+			c->descriptionPending = true;
+			if (c->maxGatheringDelay > 0 && !c->gatheringTimeout) {
+				c->gatheringTimeout = emscripten_set_timeout(
+				    [](void *ptr) {
+					    Connection *c = findConnection(int(reinterpret_cast<intptr_t>(ptr)));
+					    if (!c)
+						    return;
+					    c->gatheringTimeout = 0;
+					    if (!c->userDeleted && c->descriptionPending)
+						    emitDescription(c);
+				    },
+				    c->maxGatheringDelay, reinterpret_cast<void *>(intptr_t(pc)));
+			}
+			return;
+		}
+		emitDescription(c);
+	});
+}
+
+void negotiate(int pc, string type, const string &iceUfrag, const string &icePwd) {
+	Connection *c = findConnection(pc);
+	if (!c)
+		return;
+
+	if (type.empty())
+		type = c->signalingState == SignalingState::HaveRemoteOffer ||
+		               c->signalingState == SignalingState::HaveLocalPranswer
+		           ? "answer"
+		           : "offer";
+
+	if (type == "rollback") {
+		post([pc]() { setLocalDescription(pc, SessionDescription{"rollback", ""}); });
+		return;
+	}
+
+	string sdp;
+	if (type == "offer") {
+		if (c->iceRestart)
+			restartCredentials(c);
+		sdp = buildSdp(c, "actpass");
+	} else {
+		if (c->signalingState != SignalingState::HaveRemoteOffer &&
+		    c->signalingState != SignalingState::HaveLocalPranswer) {
+			logError("Cannot create an answer without a remote offer");
+			return;
+		}
+		sdp = buildSdp(c, "active");
+	}
+
+	if (!iceUfrag.empty())
+		sdp = replaceAttribute(sdp, "ice-ufrag", iceUfrag);
+	if (!icePwd.empty())
+		sdp = replaceAttribute(sdp, "ice-pwd", icePwd);
+
+	handleDescription(pc, SessionDescription{type, std::move(sdp)});
+}
+
+void setRemoteDescription(int pc, SessionDescription description) {
+	Connection *c = findConnection(pc);
+	if (!c || c->signalingState == SignalingState::Closed)
+		return;
+
+	const string &type = description.type;
+	SignalingState state = c->signalingState;
+	optional<SignalingState> next;
+	if (type == "offer" &&
+	    (state == SignalingState::Stable || state == SignalingState::HaveRemoteOffer))
+		next = SignalingState::HaveRemoteOffer;
+	else if (type == "answer" && (state == SignalingState::HaveLocalOffer ||
+	                              state == SignalingState::HaveRemotePranswer))
+		next = SignalingState::Stable;
+	else if (type == "pranswer" && (state == SignalingState::HaveLocalOffer ||
+	                                state == SignalingState::HaveRemotePranswer))
+		next = SignalingState::HaveRemotePranswer;
+	else if (type == "rollback" && state == SignalingState::HaveRemoteOffer)
+		next = SignalingState::Stable;
+
+	if (!next) {
+		logError("Cannot set remote " + type + " description in state " +
+		         std::to_string(int(state)));
+		return;
+	}
+
+	if (type != "rollback") {
+		auto session = sdpAttribute(description.sdp, "x-mock-session");
+		if (!session) {
+			logError("Remote description is not from a stub peer");
+			return;
+		}
+		int remoteSession = std::atoi(session->c_str());
+		if (c->remoteSession && c->remoteSession != remoteSession) {
+			logError("Remote peer changed");
+			return;
+		}
+		c->remoteSession = remoteSession;
+		c->remoteCandidates += countCandidates(description.sdp);
+		// The answer to an offer restarting ICE has new credentials too
+		if (type == "offer" && c->remoteDescription &&
+		    sdpAttribute(description.sdp, "ice-ufrag") !=
+		        sdpAttribute(c->remoteDescription->sdp, "ice-ufrag"))
+			restartCredentials(c);
+		c->remoteDescription = std::move(description);
+	}
+
+	setSignalingState(c, *next);
+	if ((c = findConnection(pc)) && *next == SignalingState::Stable && type != "rollback")
+		completeNegotiation(c);
+}
+
+void writeStats(Connection *c) {
+	if (!c->statsBuffer)
+		return;
+
+	uint64_t messagesSent = 0;
+	uint64_t messagesReceived = 0;
+	for (int dc : c->channels) {
+		if (Channel *ch = findChannel(dc)) {
+			messagesSent += ch->messagesSent;
+			messagesReceived += ch->messagesReceived;
+		}
+	}
+	double *buffer = c->statsBuffer;
+	buffer[0] = emscripten_get_now();
+	buffer[1] = c->remote ? 0 : -1; // loopback
+	buffer[2] = double(c->bytesSent);
+	buffer[3] = double(c->bytesReceived);
+	buffer[4] = double(messagesSent);
+	buffer[5] = double(messagesReceived);
+}
+
+} // namespace
+
+extern "C" {
+
+// Certificates are not used by the stub, so they are ready immediately
+
+int js_rtcGenerateCertificate(int) {
+	int cert = nextId++;
+	certificates.insert(cert);
+	return cert;
+}
+
+void js_rtcDeleteCertificate(int cert) { certificates.erase(cert); }
+
+int js_rtcIsCertificateReady(int cert) { return certificates.count(cert) ? 1 : 0; }
+
+void js_rtcPreloadCertificate(int) {}
+
+int js_rtcCreatePeerConnection(const char **, const char **, const char **, int,
+                               bool disableAutoNegotiation, int candidateSignaling,
+                               int candidateBatchInterval, int maxGatheringDelay, int, int, int,
+                               int, int, int) {
+	auto c = std::make_unique<Connection>();
+	c->id = nextId++;
+	c->autoNegotiation = !disableAutoNegotiation;
+	c->candidateSignaling = candidateSignaling;
+	c->candidateBatchInterval = candidateBatchInterval;
+	c->maxGatheringDelay = maxGatheringDelay;
+	restartCredentials(c.get());
+	int pc = c->id;
+	connections.emplace(pc, std::move(c));
+	return pc;
+}
+
+void js_rtcClosePeerConnection(int pc) {
+	if (Connection *c = findConnection(pc))
+		closeConnection(c);
+}
+
+void js_rtcDeletePeerConnection(int pc) {
+	if (Connection *c = findConnection(pc)) {
+		c->userDeleted = true;
+		closeConnection(c);
+		connections.erase(pc);
+	}
+}
+
+int js_rtcGetLiveObjectCount() {
+	return int(connections.size() + channels.size() + certificates.size());
+}
+
+void js_rtcFree(void *ptr) { freeString(ptr); }
+
+void js_rtcGetHeapStats(int source, double *pStats) {
+#if RTC_ENABLE_HEAP_STATS
+	if (source < 0) {
+		double allocations = 0;
+		for (double count : heap.allocations)
+			allocations += count;
+		pStats[0] = heap.totalLive;
+		pStats[1] = allocations;
+		pStats[2] = heap.totalPeak;
+	} else if (source < HeapCount) {
+		pStats[0] = heap.live[source];
+		pStats[1] = heap.allocations[source];
+		pStats[2] = heap.peak[source];
+	}
+#else
+	(void)source;
+	pStats[0] = pStats[1] = pStats[2] = 0;
+#endif
+}
+
+char *js_rtcGetLocalDescription(int pc) {
+	Connection *c = findConnection(pc);
+	return c && c->localDescription ? allocString(c->localDescription->sdp, HeapSdp) : nullptr;
+}
+
+char *js_rtcGetLocalDescriptionType(int pc) {
+	Connection *c = findConnection(pc);
+	return c && c->localDescription ? allocString(c->localDescription->type, HeapSdp) : nullptr;
+}
+
+char *js_rtcGetRemoteDescription(int pc) {
+	Connection *c = findConnection(pc);
+	return c && c->remoteDescription ? allocString(c->remoteDescription->sdp, HeapSdp) : nullptr;
+}
+
+char *js_rtcGetRemoteDescriptionType(int pc) {
+	Connection *c = findConnection(pc);
+	return c && c->remoteDescription ? allocString(c->remoteDescription->type, HeapSdp) : nullptr;
+}
+
+int js_rtcCreateDataChannel(int pc, const char *label, bool unordered, int maxRetransmits,
+                            int maxPacketLifeTime, const char *protocol, bool negotiated,
+                            int stream) {
+	Connection *c = findConnection(pc);
+	if (!c || c->signalingState == SignalingState::Closed)
+		return 0;
+
+	int dc = createChannel(c, label, unordered, maxRetransmits, maxPacketLifeTime,
+	                       protocol ? protocol : "", negotiated, stream);
+	if (!dc)
+		return 0;
+
+	if (!c->negotiated)
+		negotiationNeeded(c);
+	else if (isAssociated(c))
+		linkChannels(c);
+
+	return dc;
+}
+
+int js_rtcCreateDataChannels(int pc, int count, const char **pLabels, const char **pProtocols,
+                             const int *pParams, void **pUserPointers,
+                             void (*openCallback)(void *),
+                             void (*errorCallback)(const char *, void *),
+                             void (*messageCallback)(const char *, int, void *),
+                             void (*bufferedAmountLowCallback)(void *), int *pIds) {
+	Connection *c = findConnection(pc);
+	if (!c || c->signalingState == SignalingState::Closed)
+		return 0;
+
+	std::vector<int> created;
+	for (int i = 0; i < count; ++i) {
+		// Parameters are unordered, maxRetransmits, maxPacketLifeTime, negotiated, stream
+		const int *p = pParams + 5 * i;
+		int dc = createChannel(c, pLabels[i], p[0] != 0, p[1], p[2], pProtocols[i], p[3] != 0,
+		                       p[4]);
+		if (!dc) {
+			// All or nothing
+			for (int id : created)
+				eraseChannel(id);
+			return 0;
+		}
+		created.push_back(dc);
+	}
+
+	for (int i = 0; i < count; ++i) {
+		Channel *ch = findChannel(created[i]);
+		ch->userPointer = pUserPointers[i];
+		ch->openCallback = openCallback;
+		ch->errorCallback = errorCallback;
+		ch->messageCallback = messageCallback;
+		ch->bufferedAmountLowCallback = bufferedAmountLowCallback;
+		pIds[i] = created[i];
+	}
+
+	if (!c->negotiated)
+		negotiationNeeded(c);
+	else if (isAssociated(c))
+		linkChannels(c);
+
+	return count;
+}
+
+void js_rtcDeleteDataChannel(int dc) { unregisterChannel(dc); }
+
+void js_rtcSetDataChannelCallback(int pc, void (*dataChannelCallback)(int, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->dataChannelCallback = dataChannelCallback;
+}
+
+void js_rtcSetLocalDescriptionCallback(int pc, void (*descriptionCallback)(const char *,
+                                                                           const char *, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->descriptionCallback = descriptionCallback;
+}
+
+void js_rtcSetLocalCandidateCallback(int pc,
+                                     void (*candidateCallback)(const char *, const char *, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->candidateCallback = candidateCallback;
+}
+
+void js_rtcSetLocalCandidatesCallback(int pc,
+                                      void (*candidatesCallback)(const char *, int, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->candidatesCallback = candidatesCallback;
+}
+
+void js_rtcSetStateChangeCallback(int pc, void (*stateChangeCallback)(int, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->stateChangeCallback = stateChangeCallback;
+}
+
+void js_rtcSetIceStateChangeCallback(int pc, void (*iceStateChangeCallback)(int, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->iceStateChangeCallback = iceStateChangeCallback;
+}
+
+void js_rtcSetGatheringStateChangeCallback(int pc,
+                                           void (*gatheringStateChangeCallback)(int, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->gatheringStateChangeCallback = gatheringStateChangeCallback;
+}
+
+void js_rtcSetSignalingStateChangeCallback(int pc,
+                                           void (*signalingStateChangeCallback)(int, void *)) {
+	if (Connection *c = findConnection(pc))
+		c->signalingStateChangeCallback = signalingStateChangeCallback;
+}
+
+void js_rtcSetSelectedCandidatePairChangeCallback(
+    int pc, void (*selectedCandidatePairChangeCallback)(void *)) {
+	if (Connection *c = findConnection(pc))
+		c->selectedCandidatePairChangeCallback = selectedCandidatePairChangeCallback;
+}
+
+void js_rtcSetLocalDescription(int pc, const char *type, const char *iceUfrag, const char *icePwd) {
+	negotiate(pc, type ? type : "", iceUfrag ? iceUfrag : "", icePwd ? icePwd : "");
+}
+
+int js_rtcIsNegotiationNeeded(int pc) {
+	Connection *c = findConnection(pc);
+	return c && c->negotiationNeeded ? 1 : 0;
+}
+
+void js_rtcSetRemoteDescription(int pc, const char *sdp, const char *type) {
+	// setRemoteDescription() is asynchronous in browsers
+	post([pc, description = SessionDescription{type, sdp}]() mutable {
+		bool offer = description.type == "offer";
+		setRemoteDescription(pc, std::move(description));
+		Connection *c = findConnection(pc);
+		if (c && !c->userDeleted && offer && c->autoNegotiation &&
+		    c->signalingState == SignalingState::HaveRemoteOffer)
+			negotiate(pc, "answer", "", "");
+	});
+}
+
+void js_rtcAddRemoteCandidate(int pc, const char *candidate, const char *) {
+	post([pc, candidate = string(candidate)]() {
+		Connection *c = findConnection(pc);
+		if (!c)
+			return;
+		if (!c->remoteDescription) {
+			logError("Cannot add a candidate without a remote description");
+			return;
+		}
+		if (candidate.empty())
+			return; // end of candidates
+
+		c->remoteCandidates++;
+		tryConnect(pc);
+	});
+}
+
+void js_rtcRestartIce(int pc) {
+	if (Connection *c = findConnection(pc)) {
+		c->iceRestart = true;
+		negotiationNeeded(c);
+	}
+}
+
+void js_rtcStartStats(int pc, double *pBuffer, int interval) {
+	Connection *c = findConnection(pc);
+	if (!c)
+		return;
+
+	c->statsBuffer = pBuffer;
+	if (c->statsInterval)
+		emscripten_clear_interval(c->statsInterval);
+
+	c->statsInterval = emscripten_set_interval(
+	    [](void *ptr) {
+		    if (Connection *c = findConnection(int(reinterpret_cast<intptr_t>(ptr))))
+			    writeStats(c);
+	    },
+	    interval, reinterpret_cast<void *>(intptr_t(pc)));
+	writeStats(c);
+}
+
+int js_rtcGetSelectedCandidatePair(int pc, char *local, int localSize, char *remote,
+                                   int remoteSize) {
+	Connection *c = findConnection(pc);
+	if (!c || !c->remote)
+		return 0;
+
+	copyString(hostCandidate(c->id), local, localSize);
+	copyString(hostCandidate(c->remote), remote, remoteSize);
+	return 1;
+}
+
+int js_rtcGetLocalAddress(int pc, char *buffer, int size) {
+	Connection *c = findConnection(pc);
+	if (!c || !c->remote)
+		return 0;
+
+	return copyString("127.0.0.1:" + std::to_string(10000 + c->id), buffer, size);
+}
+
+int js_rtcGetRemoteAddress(int pc, char *buffer, int size) {
+	Connection *c = findConnection(pc);
+	if (!c || !c->remote)
+		return 0;
+
+	return copyString("127.0.0.1:" + std::to_string(10000 + c->remote), buffer, size);
+}
+
+int js_rtcGetDataChannelLabel(int dc, char *buffer, int size) {
+	Channel *ch = findChannel(dc);
+	return ch ? copyString(ch->label, buffer, size) : 0;
+}
+
+int js_rtcGetDataChannelProtocol(int dc, char *buffer, int size) {
+	Channel *ch = findChannel(dc);
+	return ch ? copyString(ch->protocol, buffer, size) : 0;
+}
+
+int js_rtcGetDataChannelStream(int dc) {
+	Channel *ch = findChannel(dc);
+	return ch ? ch->stream : -1;
+}
+
+int js_rtcGetDataChannelUnordered(int dc) {
+	Channel *ch = findChannel(dc);
+	return ch && ch->unordered ? 1 : 0;
+}
+
+int js_rtcGetDataChannelMaxPacketLifeTime(int dc) {
+	Channel *ch = findChannel(dc);
+	return ch ? ch->maxPacketLifeTime : -1;
+}
+
+int js_rtcGetDataChannelMaxRetransmits(int dc) {
+	Channel *ch = findChannel(dc);
+	return ch ? ch->maxRetransmits : -1;
+}
+
+void js_rtcSetOpenCallback(int dc, void (*openCallback)(void *)) {
+	Channel *ch = findChannel(dc);
+	if (!ch)
+		return;
+
+	ch->openCallback = openCallback;
+	if (ch->state == ChannelState::Open)
+		post([dc]() {
+			Channel *ch = findChannel(dc);
+			if (ch && !ch->userDeleted && ch->openCallback)
+				ch->openCallback(ch->userPointer);
+		});
+}
+
+void js_rtcSetErrorCallback(int dc, void (*errorCallback)(const char *, void *)) {
+	if (Channel *ch = findChannel(dc))
+		ch->errorCallback = errorCallback;
+}
+
+void js_rtcSetMessageCallback(int dc, void (*messageCallback)(const char *, int, void *)) {
+	if (Channel *ch = findChannel(dc))
+		ch->messageCallback = messageCallback;
+}
+
+void js_rtcSetBufferedAmountLowCallback(int dc, void (*bufferedAmountLowCallback)(void *)) {
+	if (Channel *ch = findChannel(dc))
+		ch->bufferedAmountLowCallback = bufferedAmountLowCallback;
+}
+
+int js_rtcGetBufferedAmount(int dc) {
+	Channel *ch = findChannel(dc);
+	return ch ? int(ch->bufferedAmount) : -1;
+}
+
+void js_rtcSetBufferedAmountLowThreshold(int dc, int threshold) {
+	if (Channel *ch = findChannel(dc))
+		ch->bufferedAmountLowThreshold = size_t(std::max(threshold, 0));
+}
+
+int js_rtcSendMessage(int dc, const char *buffer, int size) {
+	Channel *ch = findChannel(dc);
+	if (!ch)
+		return -1;
+
+	// The JS library copies the message out of the heap, so does the stub
+	auto data = std::make_shared<const string>(size >= 0 ? string(buffer, size_t(size))
+	                                                     : string(buffer));
+	return sendMessage(ch, std::move(data), size >= 0);
+}
+
+int js_rtcSendMessageMulti(const int *pIds, int count, const char *buffer, int size,
+                           int *pBufferedAmounts) {
+	// Copy once for all channels
+	auto data = std::make_shared<const string>(size >= 0 ? string(buffer, size_t(size))
+	                                                     : string(buffer));
+	int sent = 0;
+	for (int i = 0; i < count; ++i) {
+		Channel *ch = findChannel(pIds[i]);
+		int bufferedAmount = ch ? sendMessage(ch, data, size >= 0) : -1;
+		if (bufferedAmount >= 0)
+			++sent;
+		pBufferedAmounts[i] = bufferedAmount;
+	}
+	return sent;
+}
+
+void js_rtcSetUserPointer(int i, void *ptr) {
+	if (Connection *c = findConnection(i))
+		c->userPointer = ptr;
+	if (Channel *ch = findChannel(i))
+		ch->userPointer = ptr;
+}
+
+// WebSocketStream is not emulated
+
+int js_rtcIsWebSocketStreamSupported() { return 0; }
+
+int js_rtcCreateWebSocketStream(const char *, const char *, void *, void (*)(void *),
+                                void (*)(const char *, void *), void (*)(const char *, int, void *),
+                                void (*)(void *), void (*)(void *)) {
+	return 0;
+}
+
+void js_rtcDeleteWebSocketStream(int) {}
+
+int js_rtcSendWebSocketStream(int, const char *, int) { return -1; }
+
+int js_rtcGetWebSocketStreamBufferedAmount(int) { return 0; }
+
+void js_rtcSetWebSocketStreamBufferedAmountLowThreshold(int, int) {}
+
+void js_rtcSetWebSocketStreamPaused(int, int) {}
+
+#ifdef RTC_ENABLE_TRACE
+void js_rtcTraceMeasure(const char *, double) {}
+#endif
+
+} // extern "C"
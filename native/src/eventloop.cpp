@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "eventloop.hpp"
+#include "rtcstub.hpp"
+
+#include <emscripten/emscripten.h>
+#include <emscripten/eventloop.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace rtc::stub {
+
+namespace {
+
+struct Timer {
+	double due;
+	double interval; // 0 for a timeout
+	void (*callback)(void *);
+	void *userData;
+};
+
+std::vector<std::function<void()>> tasks;
+std::map<long, Timer> timers;
+long nextTimerId = 1;
+
+long addTimer(void (*callback)(void *), double msecs, double interval, void *userData) {
+	long id = nextTimerId++;
+	timers.emplace(id, Timer{emscripten_get_now() + std::max(msecs, 0.0), interval, callback,
+	                         userData});
+	return id;
+}
+
+// Runs the timers due at the time of the call, in order of expiration
+size_t runTimers() {
+	double now = emscripten_get_now();
+	std::vector<std::pair<double, long>> due;
+	for (const auto &[id, timer] : timers)
+		if (timer.due <= now)
+			due.emplace_back(timer.due, id);
+
+	std::sort(due.begin(), due.end());
+	size_t count = 0;
+	for (const auto &[time, id] : due) {
+		auto it = timers.find(id);
+		if (it == timers.end())
+			continue; // cleared by a previous callback
+
+		Timer timer = it->second;
+		if (timer.interval > 0)
+			it->second.due = now + timer.interval;
+		else
+			timers.erase(it);
+
+		timer.callback(timer.userData);
+		++count;
+	}
+	return count;
+}
+
+} // namespace
+
+void post(std::function<void()> task) { tasks.push_back(std::move(task)); }
+
+size_t runPending() {
+	size_t total = 0;
+	while (true) {
+		size_t count = 0;
+		auto current = std::move(tasks);
+		tasks.clear();
+		for (auto &task : current) {
+			task();
+			++count;
+		}
+		count += runTimers();
+		if (count == 0)
+			break;
+
+		total += count;
+	}
+	return total;
+}
+
+bool runUntil(const std::function<bool()> &predicate, std::chrono::milliseconds timeout) {
+	double deadline = emscripten_get_now() + double(timeout.count());
+	while (true) {
+		runPending();
+		if (predicate())
+			return true;
+
+		double now = emscripten_get_now();
+		if (now >= deadline)
+			return false;
+
+		// Nothing is runnable, so sleep until the next timer or the deadline
+		double next = deadline;
+		for (const auto &[id, timer] : timers)
+			next = std::min(next, timer.due);
+
+		if (next > now)
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(next - now));
+	}
+}
+
+size_t pendingCount() { return tasks.size() + timers.size(); }
+
+} // namespace rtc::stub
+
+using namespace rtc::stub;
+
+extern "C" {
+
+double emscripten_get_now(void) {
+	using clock = std::chrono::steady_clock;
+	static const auto origin = clock::now();
+	return std::chrono::duration<double, std::milli>(clock::now() - origin).count();
+}
+
+float emscripten_random(void) {
+	static std::mt19937 generator{std::random_device{}()};
+	return std::uniform_real_distribution<float>(0.f, 1.f)(generator);
+}
+
+int emscripten_set_timeout(void (*cb)(void *userData), double msecs, void *userData) {
+	return int(addTimer(cb, msecs, 0, userData));
+}
+
+void emscripten_clear_timeout(int id) { timers.erase(id); }
+
+long emscripten_set_interval(void (*cb)(void *userData), double intervalMsecs, void *userData) {
+	// Like browsers, clamp the interval so that a zero interval does not spin
+	double interval = std::max(intervalMsecs, 1.0);
+	return addTimer(cb, interval, interval, userData);
+}
+
+void emscripten_clear_interval(long id) { timers.erase(id); }
+
+} // extern "C"
@@ -0,0 +1,288 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// In-memory WebSocket server for native builds with RTC_NATIVE_STUB, standing in for the
+// Emscripten WebSocket API. Every socket connects to the same server whatever the URL, and the
+// server echoes each message back. Events are delivered through the emulated event loop, so the
+// C++ layer sees them asynchronously like in a browser.
+
+#include "eventloop.hpp"
+#include "rtcstub.hpp"
+
+#include <emscripten/websocket.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using rtc::stub::post;
+
+enum class SocketState { Connecting, Open, Closing, Closed };
+
+struct Socket {
+	EMSCRIPTEN_WEBSOCKET_T id;
+	SocketState state = SocketState::Connecting;
+	size_t bufferedAmount = 0;
+
+	void *openUserData = nullptr;
+	em_websocket_open_callback_func openCallback = nullptr;
+	void *messageUserData = nullptr;
+	em_websocket_message_callback_func messageCallback = nullptr;
+	void *errorUserData = nullptr;
+	em_websocket_error_callback_func errorCallback = nullptr;
+	void *closeUserData = nullptr;
+	em_websocket_close_callback_func closeCallback = nullptr;
+};
+
+std::map<EMSCRIPTEN_WEBSOCKET_T, std::unique_ptr<Socket>> sockets;
+EMSCRIPTEN_WEBSOCKET_T nextSocketId = 1;
+bool serverUp = true;
+
+// Returns null if the socket was deleted, which also unregisters its callbacks
+Socket *findSocket(EMSCRIPTEN_WEBSOCKET_T id) {
+	auto it = sockets.find(id);
+	return it != sockets.end() ? it->second.get() : nullptr;
+}
+
+void emitError(EMSCRIPTEN_WEBSOCKET_T id) {
+	Socket *s = findSocket(id);
+	if (!s || !s->errorCallback)
+		return;
+
+	EmscriptenWebSocketErrorEvent event = {};
+	event.socket = id;
+	s->errorCallback(0, &event, s->errorUserData);
+}
+
+void emitClose(EMSCRIPTEN_WEBSOCKET_T id, bool wasClean, unsigned short code) {
+	Socket *s = findSocket(id);
+	if (!s || s->state == SocketState::Closed)
+		return;
+
+	s->state = SocketState::Closed;
+	s->bufferedAmount = 0;
+	if (!s->closeCallback)
+		return;
+
+	EmscriptenWebSocketCloseEvent event = {};
+	event.socket = id;
+	event.wasClean = wasClean ? EM_TRUE : EM_FALSE;
+	event.code = code;
+	s->closeCallback(0, &event, s->closeUserData);
+}
+
+// Abnormal closure, like a lost connection
+const unsigned short CloseAbnormal = 1006;
+
+EMSCRIPTEN_RESULT send(EMSCRIPTEN_WEBSOCKET_T id, std::string data, bool isText) {
+	Socket *s = findSocket(id);
+	if (!s)
+		return EMSCRIPTEN_RESULT_INVALID_TARGET;
+	if (s->state != SocketState::Open)
+		return EMSCRIPTEN_RESULT_FAILED;
+
+	// The echo is received on the next iteration, when the message leaves the buffer
+	s->bufferedAmount += data.size();
+	post([id, data = std::move(data), isText]() mutable {
+		Socket *s = findSocket(id);
+		if (!s || s->state != SocketState::Open)
+			return;
+
+		s->bufferedAmount -= data.size();
+		if (!s->messageCallback)
+			return;
+
+		// Like Emscripten, text messages are null-terminated and the terminator is counted
+		if (isText)
+			data.push_back('\0');
+
+		EmscriptenWebSocketMessageEvent event = {};
+		event.socket = id;
+		event.data = reinterpret_cast<uint8_t *>(data.data());
+		event.numBytes = uint32_t(data.size());
+		event.isText = isText ? EM_TRUE : EM_FALSE;
+		s->messageCallback(0, &event, s->messageUserData);
+	});
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+} // namespace
+
+namespace rtc::stub {
+
+void setWebSocketServerUp(bool up) {
+	serverUp = up;
+	if (up)
+		return;
+
+	// Open connections are lost, the ones still connecting are refused when they complete
+	for (const auto &[id, socket] : sockets) {
+		if (socket->state != SocketState::Open)
+			continue;
+
+		post([id = id]() {
+			Socket *s = findSocket(id);
+			if (!s || s->state != SocketState::Open)
+				return;
+
+			emitError(id);
+			emitClose(id, false, CloseAbnormal);
+		});
+	}
+}
+
+} // namespace rtc::stub
+
+extern "C" {
+
+EM_BOOL emscripten_websocket_is_supported(void) { return EM_TRUE; }
+
+EMSCRIPTEN_WEBSOCKET_T emscripten_websocket_new(EmscriptenWebSocketCreateAttributes *attributes) {
+	if (!attributes || !attributes->url)
+		return EMSCRIPTEN_RESULT_INVALID_PARAM;
+
+	EMSCRIPTEN_WEBSOCKET_T id = nextSocketId++;
+	auto socket = std::make_unique<Socket>();
+	socket->id = id;
+	sockets.emplace(id, std::move(socket));
+
+	// The callbacks are set after creation, so the outcome is known on the next iteration
+	post([id]() {
+		Socket *s = findSocket(id);
+		if (!s || s->state != SocketState::Connecting)
+			return;
+
+		if (!serverUp) {
+			emitError(id);
+			emitClose(id, false, CloseAbnormal);
+			return;
+		}
+
+		s->state = SocketState::Open;
+		if (s->openCallback) {
+			EmscriptenWebSocketOpenEvent event = {};
+			event.socket = id;
+			s->openCallback(0, &event, s->openUserData);
+		}
+	});
+	return id;
+}
+
+EMSCRIPTEN_RESULT
+emscripten_websocket_set_onopen_callback(EMSCRIPTEN_WEBSOCKET_T socket, void *userData,
+                                         em_websocket_open_callback_func callback) {
+	Socket *s = findSocket(socket);
+	if (!s)
+		return EMSCRIPTEN_RESULT_INVALID_TARGET;
+
+	s->openUserData = userData;
+	s->openCallback = callback;
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+EMSCRIPTEN_RESULT
+emscripten_websocket_set_onmessage_callback(EMSCRIPTEN_WEBSOCKET_T socket, void *userData,
+                                            em_websocket_message_callback_func callback) {
+	Socket *s = findSocket(socket);
+	if (!s)
+		return EMSCRIPTEN_RESULT_INVALID_TARGET;
+
+	s->messageUserData = userData;
+	s->messageCallback = callback;
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+EMSCRIPTEN_RESULT
+emscripten_websocket_set_onerror_callback(EMSCRIPTEN_WEBSOCKET_T socket, void *userData,
+                                          em_websocket_error_callback_func callback) {
+	Socket *s = findSocket(socket);
+	if (!s)
+		return EMSCRIPTEN_RESULT_INVALID_TARGET;
+
+	s->errorUserData = userData;
+	s->errorCallback = callback;
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+EMSCRIPTEN_RESULT
+emscripten_websocket_set_onclose_callback(EMSCRIPTEN_WEBSOCKET_T socket, void *userData,
+                                          em_websocket_close_callback_func callback) {
+	Socket *s = findSocket(socket);
+	if (!s)
+		return EMSCRIPTEN_RESULT_INVALID_TARGET;
+
+	s->closeUserData = userData;
+	s->closeCallback = callback;
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+EMSCRIPTEN_RESULT emscripten_websocket_send_utf8_text(EMSCRIPTEN_WEBSOCKET_T socket,
+                                                      const char *textData) {
+	if (!textData)
+		return EMSCRIPTEN_RESULT_INVALID_PARAM;
+
+	return send(socket, std::string(textData), true);
+}
+
+EMSCRIPTEN_RESULT emscripten_websocket_send_binary(EMSCRIPTEN_WEBSOCKET_T socket, void *binaryData,
+                                                   uint32_t dataLength) {
+	if (!binaryData && dataLength > 0)
+		return EMSCRIPTEN_RESULT_INVALID_PARAM;
+
+	return send(socket, std::string(static_cast<const char *>(binaryData), dataLength), false);
+}
+
+EMSCRIPTEN_RESULT emscripten_websocket_get_buffered_amount(EMSCRIPTEN_WEBSOCKET_T socket,
+                                                           size_t *bufferedAmount) {
+	Socket *s = findSocket(socket);
+	if (!s)
+		return EMSCRIPTEN_RESULT_INVALID_TARGET;
+	if (!bufferedAmount)
+		return EMSCRIPTEN_RESULT_INVALID_PARAM;
+
+	*bufferedAmount = s->bufferedAmount;
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+EMSCRIPTEN_RESULT emscripten_websocket_close(EMSCRIPTEN_WEBSOCKET_T socket, unsigned short code,
+                                             const char *) {
+	Socket *s = findSocket(socket);
+	if (!s)
+		return EMSCRIPTEN_RESULT_INVALID_TARGET;
+
+	if (s->state == SocketState::Closed || s->state == SocketState::Closing)
+		return EMSCRIPTEN_RESULT_SUCCESS;
+
+	s->state = SocketState::Closing;
+	post([socket, code]() { emitClose(socket, true, code ? code : 1005); });
+	return EMSCRIPTEN_RESULT_SUCCESS;
+}
+
+EMSCRIPTEN_RESULT emscripten_websocket_delete(EMSCRIPTEN_WEBSOCKET_T socket) {
+	return sockets.erase(socket) ? EMSCRIPTEN_RESULT_SUCCESS : EMSCRIPTEN_RESULT_INVALID_TARGET;
+}
+
+} // extern "C"
@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test.hpp"
+
+#include "rtc/rtc.hpp"
+
+using namespace rtc;
+
+TEST(host) {
+	Candidate candidate("candidate:842163049 1 udp 2122260223 192.168.1.2 50000 typ host "
+	                    "generation 0 ufrag Xq3v network-id 1",
+	                    "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.mid() == "0");
+	CHECK(candidate.foundation() == "842163049");
+	CHECK(candidate.component() == 1);
+	CHECK(candidate.transport() == "udp");
+	CHECK(candidate.transportType() == Candidate::TransportType::Udp);
+	CHECK(candidate.priority() == 2122260223);
+	CHECK(candidate.address() == "192.168.1.2");
+	CHECK(candidate.port() == 50000);
+	CHECK(candidate.type() == Candidate::Type::Host);
+	CHECK(candidate.typeString() == "host");
+	CHECK(!candidate.relatedAddress());
+	CHECK(!candidate.relatedPort());
+}
+
+TEST(serverReflexive) {
+	Candidate candidate("candidate:2 1 udp 1686052607 203.0.113.7 50001 typ srflx raddr "
+	                    "192.168.1.2 rport 50000 generation 0",
+	                    "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.type() == Candidate::Type::ServerReflexive);
+	CHECK(candidate.typeString() == "srflx");
+	CHECK(candidate.address() == "203.0.113.7");
+	CHECK(candidate.port() == 50001);
+	CHECK(candidate.relatedAddress() == std::string_view("192.168.1.2"));
+	CHECK(candidate.relatedPort() == uint16_t(50000));
+}
+
+TEST(relayed) {
+	Candidate candidate("candidate:4 1 udp 41885439 198.51.100.9 3478 typ relay raddr "
+	                    "203.0.113.7 rport 50001",
+	                    "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.type() == Candidate::Type::Relayed);
+	CHECK(candidate.address() == "198.51.100.9");
+	CHECK(candidate.port() == 3478);
+	CHECK(candidate.relatedAddress() == std::string_view("203.0.113.7"));
+	CHECK(candidate.relatedPort() == uint16_t(50001));
+}
+
+TEST(peerReflexiveWithPrefix) {
+	// The a= prefix is accepted and kept
+	Candidate candidate("a=candidate:3 1 UDP 1853824767 198.51.100.4 50002 typ prflx", "1");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.type() == Candidate::Type::PeerReflexive);
+	CHECK(candidate.transport() == "UDP");
+	CHECK(candidate.transportType() == Candidate::TransportType::Udp);
+	CHECK(candidate.candidate() == "a=candidate:3 1 UDP 1853824767 198.51.100.4 50002 typ prflx");
+}
+
+TEST(tcpTypes) {
+	const string prefix = "candidate:5 1 tcp 1518280447 192.168.1.2 9 typ host";
+	CHECK(Candidate(prefix + " tcptype active", "0").transportType() ==
+	      Candidate::TransportType::TcpActive);
+	CHECK(Candidate(prefix + " tcptype passive", "0").transportType() ==
+	      Candidate::TransportType::TcpPassive);
+	CHECK(Candidate(prefix + " tcptype so", "0").transportType() ==
+	      Candidate::TransportType::TcpSo);
+	CHECK(Candidate(prefix, "0").transportType() == Candidate::TransportType::TcpUnknown);
+
+	Candidate candidate(prefix + " tcptype passive generation 0", "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.transport() == "tcp");
+	CHECK(candidate.port() == 9);
+}
+
+TEST(unknownTransportAndType) {
+	Candidate candidate("candidate:6 1 sctp 100 192.168.1.2 5000 typ other", "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.transportType() == Candidate::TransportType::Unknown);
+	CHECK(candidate.type() == Candidate::Type::Unknown);
+	CHECK(candidate.typeString() == "other");
+}
+
+TEST(ipv6) {
+	Candidate candidate("candidate:7 1 udp 2122262783 2001:db8::1 50003 typ srflx raddr "
+	                    "fe80::1c2a:3bff:fe4d:5e6f rport 50004",
+	                    "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.address() == "2001:db8::1");
+	CHECK(candidate.port() == 50003);
+	CHECK(candidate.relatedAddress() == std::string_view("fe80::1c2a:3bff:fe4d:5e6f"));
+	CHECK(candidate.relatedPort() == uint16_t(50004));
+}
+
+TEST(mdns) {
+	Candidate candidate("candidate:8 1 udp 2122260223 "
+	                    "3c9b1e6a-2f4d-4c1b-9a55-7d1e0f2b8c3a.local 50005 typ host",
+	                    "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.address() == "3c9b1e6a-2f4d-4c1b-9a55-7d1e0f2b8c3a.local");
+	CHECK(candidate.port() == 50005);
+	CHECK(candidate.type() == Candidate::Type::Host);
+}
+
+TEST(extraSpaces) {
+	Candidate candidate("candidate:1  1 udp 2122260223 192.168.1.2  50000 typ host ", "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.address() == "192.168.1.2");
+	CHECK(candidate.port() == 50000);
+	CHECK(candidate.type() == Candidate::Type::Host);
+}
+
+TEST(viewsFollowCopies) {
+	// Fields are stored as offsets, so a copy must not point into the original
+	auto copy = std::make_unique<Candidate>(
+	    "candidate:2 1 udp 1686052607 203.0.113.7 50001 typ srflx raddr 192.168.1.2 rport 50000",
+	    "0");
+	Candidate candidate = *copy;
+	copy.reset();
+	CHECK(candidate.address() == "203.0.113.7");
+	CHECK(candidate.relatedAddress() == std::string_view("192.168.1.2"));
+}
+
+TEST(malformed) {
+	// Malformed candidates are kept as-is but not parsed
+	for (const char *line : {
+	         "",
+	         "candidate:",
+	         "not a candidate",
+	         "candidate:1 1 udp 2122260223 192.168.1.2 50000",               // no type
+	         "candidate:1 1 udp 2122260223 192.168.1.2 50000 typ",           // missing type value
+	         "candidate:1 x udp 2122260223 192.168.1.2 50000 typ host",      // invalid component
+	         "candidate:1 1 udp -5 192.168.1.2 50000 typ host",              // invalid priority
+	         "candidate:1 1 udp 4294967296 192.168.1.2 50000 typ host",      // priority overflow
+	         "candidate:1 1 udp 2122260223 192.168.1.2 65536 typ host",      // port overflow
+	         "candidate:1 1 udp 2122260223 192.168.1.2 http typ host",       // invalid port
+	         "candidate:1 1 udp 2122260223 192.168.1.2 50000 raddr 1.2.3.4", // typ after raddr
+	     }) {
+		Candidate candidate(line, "0");
+		CHECK(!candidate.isParsed());
+		CHECK(candidate.candidate() == line);
+		CHECK(candidate.type() == Candidate::Type::Unknown);
+		CHECK(candidate.transportType() == Candidate::TransportType::Unknown);
+	}
+
+	// An invalid related port is ignored, the rest is still parsed
+	Candidate candidate("candidate:2 1 udp 1686052607 203.0.113.7 50001 typ srflx raddr "
+	                    "192.168.1.2 rport none",
+	                    "0");
+	CHECK(candidate.isParsed());
+	CHECK(candidate.relatedAddress() == std::string_view("192.168.1.2"));
+	CHECK(!candidate.relatedPort());
+}
+
+int main() { return rtc::test::runAll(); }
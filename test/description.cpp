@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test.hpp"
+
+#include "rtc/rtc.hpp"
+
+using namespace rtc;
+
+namespace {
+
+const string Offer = "v=0\r\n"
+                     "o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+                     "s=-\r\n"
+                     "t=0 0\r\n"
+                     "a=group:BUNDLE 0\r\n"
+                     "a=msid-semantic: WMS\r\n"
+                     "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+                     "c=IN IP4 0.0.0.0\r\n"
+                     "a=candidate:1 1 udp 2122260223 192.168.1.2 50000 typ host\r\n"
+                     "a=candidate:2 1 udp 1686052607 203.0.113.7 50001 typ srflx raddr "
+                     "192.168.1.2 rport 50000\r\n"
+                     "a=end-of-candidates\r\n"
+                     "a=ice-ufrag:Xq3v\r\n"
+                     "a=ice-pwd:0rVJ4bJ7y2GXkQ1Oe2DpW8mZ\r\n"
+                     "a=ice-options:trickle\r\n"
+                     "a=fingerprint:sha-256 "
+                     "6B:8B:5D:EA:59:04:20:23:29:C8:87:1C:CB:71:5E:0F:"
+                     "0A:B6:7A:DB:2F:2C:E2:F4:11:43:B9:4C:CB:1E:1F:11\r\n"
+                     "a=setup:actpass\r\n"
+                     "a=mid:0\r\n"
+                     "a=sctp-port:5000\r\n"
+                     "a=max-message-size:262144\r\n";
+
+string replace(string sdp, const string &from, const string &to) {
+	size_t pos = sdp.find(from);
+	if (pos == string::npos)
+		throw std::logic_error("Test SDP does not contain " + from);
+	return sdp.replace(pos, from.size(), to);
+}
+
+// Origin line without the address, which the compact form does not keep
+string origin(const string &sdp) {
+	size_t begin = sdp.find("o=");
+	return sdp.substr(begin, sdp.find(" IN ", begin) - begin);
+}
+
+// SDP -> compact -> SDP, then checks that everything the compact form keeps is unchanged
+void checkRoundTrip(const Description &description) {
+	Description decoded = Description::decodeCompact(description.encodeCompact());
+	CHECK(decoded.type() == description.type());
+	CHECK(decoded.typeString() == description.typeString());
+	CHECK(decoded.iceUfrag() == description.iceUfrag());
+	CHECK(decoded.icePwd() == description.icePwd());
+	CHECK(decoded.fingerprint() == description.fingerprint());
+	CHECK(decoded.sctpPort() == description.sctpPort());
+	CHECK(decoded.maxMessageSize() == description.maxMessageSize());
+	CHECK(decoded.candidateCount() == description.candidateCount());
+
+	auto candidates = description.candidates();
+	auto decodedCandidates = decoded.candidates();
+	CHECK(decodedCandidates.size() == candidates.size());
+	for (size_t i = 0; i < candidates.size(); ++i)
+		CHECK(decodedCandidates[i].candidate() == candidates[i].candidate());
+
+	// The reconstructed SDP must be stable, so that it encodes to the same compact form
+	CHECK(string(Description::decodeCompact(decoded.encodeCompact())) == string(decoded));
+	CHECK(origin(string(decoded)) == origin(string(description)));
+}
+
+} // namespace
+
+TEST(roundTripOffer) { checkRoundTrip(Description(Offer, Description::Type::Offer)); }
+
+TEST(roundTripAnswer) {
+	for (const char *setup : {"active", "passive"})
+		checkRoundTrip(Description(replace(Offer, "a=setup:actpass", string("a=setup:") + setup),
+		                           Description::Type::Answer));
+}
+
+TEST(roundTripWithoutCandidates) {
+	string sdp = replace(Offer, "a=candidate:1 1 udp 2122260223 192.168.1.2 50000 typ host\r\n", "");
+	sdp = replace(sdp,
+	              "a=candidate:2 1 udp 1686052607 203.0.113.7 50001 typ srflx raddr "
+	              "192.168.1.2 rport 50000\r\n",
+	              "");
+	sdp = replace(sdp, "a=end-of-candidates\r\n", "");
+	checkRoundTrip(Description(sdp, "offer"));
+}
+
+TEST(roundTripOtherFingerprintAlgorithm) {
+	checkRoundTrip(Description(
+	    replace(Offer, "a=fingerprint:sha-256 6B:8B:5D:EA:59:04:20:23:29:C8:87:1C:CB:71:5E:0F:"
+	                   "0A:B6:7A:DB:2F:2C:E2:F4:11:43:B9:4C:CB:1E:1F:11",
+	            "a=fingerprint:sha-1 6B:8B:5D:EA:59:04:20:23:29:C8:87:1C:CB:71:5E:0F:0A:B6:7A:DB"),
+	    Description::Type::Offer));
+}
+
+TEST(roundTripOriginUsername) {
+	checkRoundTrip(Description(
+	    replace(Offer, "o=- ", "o=mozilla...THIS_IS_SDPARTA-99.0 "), Description::Type::Offer));
+}
+
+TEST(rejectUnknownSetup) {
+	Description description(replace(Offer, "a=setup:actpass", "a=setup:holdconn"), "offer");
+	CHECK_THROWS(description.encodeCompact());
+}
+
+TEST(rejectMissingSetup) {
+	Description description(replace(Offer, "a=setup:actpass\r\n", ""), "offer");
+	CHECK_THROWS(description.encodeCompact());
+}
+
+TEST(rejectMultipleFingerprints) {
+	Description description(replace(Offer, "a=setup:actpass",
+	                                "a=fingerprint:sha-1 "
+	                                "6B:8B:5D:EA:59:04:20:23:29:C8:87:1C:CB:71:5E:0F:0A:B6:7A:DB\r\n"
+	                                "a=setup:actpass"),
+	                        "offer");
+	CHECK_THROWS(description.encodeCompact());
+}
+
+TEST(rejectMalformedFingerprint) {
+	const string fingerprint = "6B:8B:5D:EA:59:04:20:23:29:C8:87:1C:CB:71:5E:0F:"
+	                           "0A:B6:7A:DB:2F:2C:E2:F4:11:43:B9:4C:CB:1E:1F:11";
+	for (const string &malformed :
+	     {replace(fingerprint, "6B:8B", "6B-8B"), fingerprint.substr(0, fingerprint.size() - 1),
+	      fingerprint + ":", replace(fingerprint, "1F:11", "1F:1G"), string()}) {
+		Description description(replace(Offer, fingerprint, malformed), "offer");
+		CHECK_THROWS(description.encodeCompact());
+	}
+}
+
+TEST(rejectMissingIceCredentials) {
+	for (const char *line : {"a=ice-ufrag:Xq3v\r\n", "a=ice-pwd:0rVJ4bJ7y2GXkQ1Oe2DpW8mZ\r\n"}) {
+		Description description(replace(Offer, line, ""), "offer");
+		CHECK_THROWS(description.encodeCompact());
+	}
+}
+
+TEST(rejectUnknownType) {
+	Description description(Offer, "provisional");
+	CHECK(description.typeString() == "provisional");
+	CHECK_THROWS(description.encodeCompact());
+}
+
+TEST(rejectIceOptions) {
+	Description description(
+	    replace(Offer, "a=ice-options:trickle", "a=ice-options:trickle renomination"), "offer");
+	CHECK_THROWS(description.encodeCompact());
+}
+
+TEST(rejectMediaDescription) {
+	Description description(
+	    replace(Offer, "m=application 9 UDP/DTLS/SCTP webrtc-datachannel",
+	            "m=audio 9 UDP/TLS/RTP/SAVPF 111"),
+	    "offer");
+	CHECK_THROWS(description.encodeCompact());
+}
+
+TEST(rejectTruncatedCompact) {
+	binary compact = Description(Offer, Description::Type::Offer).encodeCompact();
+	compact.resize(compact.size() / 2);
+	CHECK_THROWS(Description::decodeCompact(compact));
+}
+
+int main() { return rtc::test::runAll(); }
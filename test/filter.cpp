@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pair.hpp"
+
+#include "rtc/rtc.hpp"
+
+using namespace rtc;
+using rtc::test::waitUntil;
+
+namespace {
+
+const Candidate Host("candidate:1 1 udp 2122260223 192.168.1.2 50000 typ host", "0");
+const Candidate ServerReflexive("candidate:2 1 udp 1686052607 203.0.113.7 50001 typ srflx raddr "
+                                "192.168.1.2 rport 50000",
+                                "0");
+const Candidate PeerReflexive("candidate:3 1 udp 1853824767 198.51.100.4 50002 typ prflx", "0");
+const Candidate Relayed("candidate:4 1 udp 41885439 198.51.100.9 3478 typ relay raddr "
+                        "203.0.113.7 rport 50001",
+                        "0");
+const Candidate Tcp("candidate:5 1 tcp 1518280447 192.168.1.2 9 typ host tcptype active", "0");
+const Candidate Ipv6("candidate:6 1 udp 2122262783 2001:db8::1 50003 typ host", "0");
+const Candidate LinkLocal4("candidate:7 1 udp 2122260223 169.254.10.20 50004 typ host", "0");
+const Candidate LinkLocal6("candidate:8 1 udp 2122262783 fe80::1c2a:3bff:fe4d:5e6f 50005 typ host",
+                           "0");
+
+// Connects two peers embedding candidates in their descriptions, without waiting for the
+// connection since the filters may leave no candidate pair
+void negotiate(PeerConnection &local, PeerConnection &remote) {
+	rtc::test::signal(&local, &remote);
+	auto channel = local.createDataChannel("filter");
+	CHECK(waitUntil([&]() { return local.remoteDescription() && remote.localDescription(); }));
+}
+
+Configuration nonTrickle(CandidateFilter filter = {}) {
+	Configuration config;
+	config.candidateSignaling = Configuration::CandidateSignaling::NonTrickle;
+	config.candidateFilter = std::move(filter);
+	return config;
+}
+
+} // namespace
+
+TEST(acceptAllByDefault) {
+	CandidateFilter filter;
+	CHECK(filter.acceptsAll());
+	for (const Candidate *candidate : {&Host, &ServerReflexive, &PeerReflexive, &Relayed, &Tcp,
+	                                   &Ipv6, &LinkLocal4, &LinkLocal6})
+		CHECK(filter.accept(*candidate));
+}
+
+TEST(relayOnly) {
+	CandidateFilter filter;
+	filter.host = false;
+	filter.serverReflexive = false;
+	filter.peerReflexive = false;
+	CHECK(!filter.acceptsAll());
+	CHECK(!filter.accept(Host));
+	CHECK(!filter.accept(ServerReflexive));
+	CHECK(!filter.accept(PeerReflexive));
+	CHECK(filter.accept(Relayed));
+	CHECK(!filter.accept(Tcp));
+}
+
+TEST(noPrivateAddresses) {
+	// Private addresses are only exposed by host candidates, the others carry them as raddr
+	CandidateFilter filter;
+	filter.host = false;
+	CHECK(!filter.accept(Host));
+	CHECK(!filter.accept(Tcp));
+	CHECK(!filter.accept(LinkLocal4));
+	CHECK(filter.accept(ServerReflexive));
+	CHECK(filter.accept(Relayed));
+}
+
+TEST(noLinkLocal) {
+	CandidateFilter filter;
+	filter.linkLocal = false;
+	CHECK(!filter.accept(LinkLocal4));
+	CHECK(!filter.accept(LinkLocal6));
+	CHECK(!filter.accept(Candidate(
+	    "candidate:9 1 udp 2122262783 FEBF::1 50006 typ host", "0"))); // upper end of fe80::/10
+	CHECK(filter.accept(Candidate("candidate:10 1 udp 2122262783 fec0::1 50007 typ host", "0")));
+	CHECK(filter.accept(Candidate("candidate:11 1 udp 2122260223 169.25.1.1 50008 typ host", "0")));
+	CHECK(filter.accept(Host));
+	CHECK(filter.accept(Ipv6));
+}
+
+TEST(transportsAndIpv6) {
+	CandidateFilter filter;
+	filter.tcp = false;
+	filter.ipv6 = false;
+	CHECK(!filter.accept(Tcp));
+	CHECK(!filter.accept(Ipv6));
+	CHECK(!filter.accept(LinkLocal6));
+	CHECK(filter.accept(Host));
+
+	filter = CandidateFilter();
+	filter.udp = false;
+	CHECK(!filter.accept(Host));
+	CHECK(filter.accept(Tcp));
+}
+
+TEST(customCallback) {
+	CandidateFilter filter;
+	filter.host = false;
+	int calls = 0;
+	filter.custom = [&calls](const Candidate &candidate) {
+		++calls;
+		return candidate.port() != 3478;
+	};
+	CHECK(!filter.acceptsAll());
+	CHECK(!filter.accept(Host)); // rejected by the flags first
+	CHECK(calls == 0);
+	CHECK(filter.accept(ServerReflexive));
+	CHECK(!filter.accept(Relayed));
+	CHECK(calls == 2);
+
+	// Unparsed candidates are kept, unless the callback decides otherwise
+	Candidate malformed("candidate:garbage", "0");
+	CHECK(filter.accept(malformed));
+	filter.custom = nullptr;
+	filter.udp = false;
+	CHECK(filter.accept(malformed));
+}
+
+TEST(dropCountsWhenTrickling) {
+	// The stub gathers a single host candidate for each peer
+	Configuration config;
+	config.candidateFilter.host = false;
+	PeerConnection local;
+	PeerConnection remote(config);
+	rtc::test::signal(&local, &remote);
+	auto channel = local.createDataChannel("filter");
+
+	CHECK(waitUntil([&]() {
+		return remote.localCandidatesDropped() == 1 && remote.remoteCandidatesDropped() == 1;
+	}));
+	CHECK(local.localCandidatesDropped() == 0);
+	CHECK(local.remoteCandidatesDropped() == 0);
+
+	// The candidates in the local description were already counted when trickled
+	CHECK(waitUntil(
+	    [&]() { return remote.gatheringState() == PeerConnection::GatheringState::Complete; }));
+	CHECK(remote.localCandidatesDropped() == 1);
+}
+
+TEST(dropCountsWhenEmbedded) {
+	CandidateFilter filter;
+	filter.host = false;
+	PeerConnection local(nonTrickle());
+	PeerConnection remote(nonTrickle(filter));
+	negotiate(local, remote);
+
+	// The answerer drops its own candidate from the answer and the one embedded in the offer
+	CHECK(remote.localCandidatesDropped() == 1);
+	CHECK(remote.remoteCandidatesDropped() == 1);
+	CHECK(local.localCandidatesDropped() == 0);
+	CHECK(local.remoteCandidatesDropped() == 0);
+
+	// Only the signaled descriptions are filtered
+	CHECK(local.remoteDescription()->candidateCount() == 0);
+	CHECK(remote.remoteDescription()->candidateCount() == 0);
+}
+
+TEST(noDropsWithoutFilter) {
+	PeerConnection local(nonTrickle());
+	PeerConnection remote(nonTrickle());
+	negotiate(local, remote);
+
+	CHECK(local.localCandidatesDropped() == 0);
+	CHECK(remote.remoteCandidatesDropped() == 0);
+	CHECK(local.localDescription()->candidateCount() == 1);
+	CHECK(remote.remoteDescription()->candidateCount() == 1);
+}
+
+int main() { return rtc::test::runAll(); }
@@ -0,0 +1,370 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pair.hpp"
+
+#include "rtc/rtc.h"
+#include "rtc/rtc.hpp"
+
+#include <cstring>
+#include <map>
+#include <set>
+
+using namespace rtc;
+using rtc::test::connectPair;
+using rtc::test::Pair;
+using rtc::test::waitUntil;
+
+namespace {
+
+int incomingChannels = 0;
+
+// Incoming channels are kept by the C API once the callback is set
+void RTC_API countDataChannel(int, int, void *) { ++incomingChannels; }
+
+} // namespace
+
+TEST(pairing) {
+	Pair pair = connectPair("pairing");
+	CHECK(pair.receiver->label() == "pairing");
+	CHECK(pair.local->state() == PeerConnection::State::Connected);
+	CHECK(pair.remote->state() == PeerConnection::State::Connected);
+	CHECK(pair.local->signalingState() == PeerConnection::SignalingState::Stable);
+	CHECK(pair.remote->signalingState() == PeerConnection::SignalingState::Stable);
+
+	auto local = pair.local->localDescription();
+	auto remote = pair.remote->remoteDescription();
+	CHECK(local && remote);
+	CHECK(local->type() == Description::Type::Offer);
+	CHECK(local->iceUfrag() == remote->iceUfrag());
+}
+
+TEST(orderedDelivery) {
+	Pair pair = connectPair();
+	const int count = 1000;
+	std::vector<int> received;
+	received.reserve(count);
+	pair.receiver->onMessage([&received](message_variant message) {
+		if (auto str = std::get_if<string>(&message)) {
+			received.push_back(std::stoi(*str));
+		} else {
+			const binary &bin = std::get<binary>(message);
+			int value = 0;
+			if (bin.size() == sizeof(value))
+				std::memcpy(&value, bin.data(), sizeof(value));
+			received.push_back(value);
+		}
+	});
+
+	// Alternate strings and binaries, which take different paths
+	for (int i = 0; i < count; ++i) {
+		if (i % 2 == 0) {
+			CHECK(pair.sender->send(std::to_string(i)));
+		} else {
+			binary bin(sizeof(i));
+			std::memcpy(bin.data(), &i, sizeof(i));
+			CHECK(pair.sender->send(std::move(bin)));
+		}
+	}
+
+	CHECK(waitUntil([&]() { return received.size() >= size_t(count); }));
+	CHECK(received.size() == size_t(count));
+	for (int i = 0; i < count; ++i)
+		CHECK(received[i] == i);
+}
+
+TEST(bufferedAmountLow) {
+	Pair pair = connectPair();
+	const size_t threshold = 64 * 1024;
+	const size_t messageSize = 16 * 1024;
+	pair.sender->setBufferedAmountLowThreshold(threshold);
+
+	int lowCount = 0;
+	size_t bufferedWhenLow = 0;
+	auto sender = pair.sender.get();
+	pair.sender->onBufferedAmountLow([&, sender]() {
+		++lowCount;
+		bufferedWhenLow = sender->bufferedAmount();
+	});
+
+	binary message(messageSize, byte(0x42));
+	for (int i = 0; i < 16; ++i)
+		CHECK(pair.sender->send(message));
+	CHECK(pair.sender->bufferedAmount() > threshold);
+
+	CHECK(waitUntil([&]() { return lowCount > 0; }));
+	CHECK(lowCount == 1);
+	CHECK(bufferedWhenLow <= threshold);
+}
+
+TEST(channelClose) {
+	Pair pair = connectPair();
+	bool receiverClosed = false;
+	pair.receiver->onClosed([&]() { receiverClosed = true; });
+
+	// Closing unregisters the channel at once, only the remote side gets a closed callback
+	pair.sender->close();
+	CHECK(pair.sender->isClosed());
+	CHECK(waitUntil([&]() { return receiverClosed; }));
+	CHECK(pair.receiver->isClosed());
+	CHECK(!pair.sender->send("late"));
+
+	// The connection itself stays up
+	CHECK(pair.local->state() == PeerConnection::State::Connected);
+}
+
+TEST(connectionClose) {
+	Pair pair = connectPair();
+	bool receiverClosed = false;
+	std::vector<PeerConnection::State> remoteStates;
+	pair.receiver->onClosed([&]() { receiverClosed = true; });
+	pair.remote->onStateChange(
+	    [&](PeerConnection::State state) { remoteStates.push_back(state); });
+
+	pair.local->close();
+	CHECK(pair.local->state() == PeerConnection::State::Closed);
+	CHECK(pair.sender->isClosed());
+
+	// The remote side notices the channel closing, then the connection loss
+	CHECK(waitUntil([&]() {
+		return receiverClosed && !remoteStates.empty() &&
+		       remoteStates.back() == PeerConnection::State::Failed;
+	}));
+	CHECK(remoteStates.front() == PeerConnection::State::Disconnected);
+}
+
+TEST(negotiatedChannels) {
+	// Only the local side negotiates, so that creating the channel on both sides causes no glare
+	Configuration config;
+	config.disableAutoNegotiation = true;
+	PeerConnection local;
+	PeerConnection remote(config);
+	rtc::test::signal(&local, &remote);
+	bool announced = false;
+	remote.onDataChannel([&announced](shared_ptr<DataChannel>) { announced = true; });
+
+	// Both sides create the channel with the same stream ID, nothing is announced in-band
+	DataChannelInit init;
+	init.negotiated = true;
+	init.id = 42;
+	auto sender = local.createDataChannel("negotiated", init);
+	auto receiver = remote.createDataChannel("negotiated", init);
+	CHECK(waitUntil([&]() {
+		return remote.signalingState() == PeerConnection::SignalingState::HaveRemoteOffer;
+	}));
+	remote.setLocalDescription(Description::Type::Answer);
+	CHECK(waitUntil([&]() { return sender->isOpen() && receiver->isOpen(); }));
+	CHECK(sender->stream() == uint16_t(42));
+	CHECK(receiver->stream() == uint16_t(42));
+
+	std::vector<string> received;
+	receiver->onMessage([&received](message_variant message) {
+		if (auto str = std::get_if<string>(&message))
+			received.push_back(*str);
+	});
+	sender->onMessage([&received](message_variant message) {
+		if (auto str = std::get_if<string>(&message))
+			received.push_back(*str);
+	});
+	CHECK(sender->send("ping"));
+	CHECK(waitUntil([&]() { return received.size() == 1; }));
+	CHECK(receiver->send("pong"));
+	CHECK(waitUntil([&]() { return received.size() == 2; }));
+	CHECK(received[0] == "ping" && received[1] == "pong");
+	CHECK(!announced);
+}
+
+TEST(negotiatedChannelRequiresId) {
+	PeerConnection pc;
+	DataChannelInit init;
+	init.negotiated = true;
+	CHECK_THROWS(pc.createDataChannel("negotiated", init));
+	CHECK_THROWS(pc.createDataChannels({{"first", {}}, {"second", init}}));
+
+	init.id = 65535;
+	CHECK_THROWS(pc.createDataChannel("negotiated", init));
+
+	// The C API reports the invalid argument
+	rtcConfiguration config = {};
+	int id = rtcCreatePeerConnection(&config);
+	CHECK(id > 0);
+	rtcDataChannelInit cinit = {};
+	cinit.negotiated = true;
+	CHECK(rtcCreateDataChannelEx(id, "negotiated", &cinit) == RTC_ERR_INVALID);
+	cinit.manualStream = true;
+	cinit.stream = 7;
+	int dc = rtcCreateDataChannelEx(id, "negotiated", &cinit);
+	CHECK(dc > 0);
+	CHECK(rtcGetDataChannelStream(dc) == 7);
+	CHECK(rtcDeletePeerConnection(id) == RTC_ERR_SUCCESS);
+}
+
+TEST(bulkCreation) {
+	Pair pair = connectPair();
+	std::map<string, shared_ptr<DataChannel>> received;
+	pair.remote->onDataChannel(
+	    [&received](shared_ptr<DataChannel> dc) { received.emplace(dc->label(), std::move(dc)); });
+
+	const size_t count = 16;
+	std::vector<ChannelSpec> specs;
+	for (size_t i = 0; i < count; ++i) {
+		ChannelSpec spec{"bulk-" + std::to_string(i), {}};
+		if (i % 2 == 1)
+			spec.init.reliability.unordered = true;
+		specs.push_back(std::move(spec));
+	}
+	// An explicit ID is kept
+	specs[3].init.id = 100;
+
+	auto channels = pair.local->createDataChannels(specs);
+	CHECK(channels.size() == count);
+	for (size_t i = 0; i < count; ++i)
+		CHECK(channels[i]->label() == specs[i].label);
+
+	CHECK(waitUntil([&]() {
+		if (received.size() < count)
+			return false;
+		for (const auto &channel : channels)
+			if (!channel->isOpen())
+				return false;
+		for (const auto &[label, channel] : received)
+			if (!channel->isOpen())
+				return false;
+		return true;
+	}));
+
+	// Each channel gets its own stream, the same on both sides
+	std::set<uint16_t> streams;
+	for (const auto &channel : channels) {
+		auto stream = channel->stream();
+		CHECK(stream && streams.insert(*stream).second);
+		auto it = received.find(channel->label());
+		CHECK(it != received.end() && it->second->stream() == stream);
+	}
+	CHECK(channels[3]->stream() == uint16_t(100));
+	CHECK(received["bulk-1"]->reliability().unordered);
+	CHECK(!received["bulk-2"]->reliability().unordered);
+
+	// Every channel is wired for messages
+	int messages = 0;
+	for (auto &[label, channel] : received)
+		channel->onMessage([&messages](message_variant) { ++messages; });
+	for (const auto &channel : channels)
+		CHECK(channel->send(channel->label()));
+	CHECK(waitUntil([&]() { return messages == int(count); }));
+
+	CHECK(pair.local->createDataChannels({}).empty());
+}
+
+TEST(bulkCreationCApi) {
+	rtcConfiguration config = {};
+	int local = rtcCreatePeerConnection(&config);
+	int remote = rtcCreatePeerConnection(&config);
+	CHECK(local > 0 && remote > 0);
+	rtc::test::signal(&local, &remote);
+	incomingChannels = 0;
+	CHECK(rtcSetDataChannelCallback(remote, countDataChannel) == RTC_ERR_SUCCESS);
+
+	const char *labels[] = {"first", "second", "third"};
+	rtcDataChannelInit inits[3] = {};
+	inits[1].protocol = "proto";
+	inits[2].manualStream = true;
+	inits[2].stream = 20;
+	int dcs[3] = {};
+	CHECK(rtcCreateDataChannels(local, labels, inits, 3, dcs) == 3);
+	CHECK(dcs[0] > 0 && dcs[1] > 0 && dcs[2] > 0);
+	CHECK(dcs[0] != dcs[1] && dcs[1] != dcs[2] && dcs[0] != dcs[2]);
+	CHECK(rtcGetUserPointer(dcs[0]) == &remote);
+
+	CHECK(waitUntil([&]() {
+		return incomingChannels == 3 && rtcIsOpen(dcs[0]) && rtcIsOpen(dcs[1]) && rtcIsOpen(dcs[2]);
+	}));
+	for (int i = 0; i < 3; ++i) {
+		char label[16];
+		CHECK(rtcGetDataChannelLabel(dcs[i], label, sizeof(label)) > 0);
+		CHECK(string(label) == labels[i]);
+		CHECK(rtcGetDataChannelStream(dcs[i]) >= 0);
+	}
+	char protocol[16];
+	CHECK(rtcGetDataChannelProtocol(dcs[1], protocol, sizeof(protocol)) > 0);
+	CHECK(string(protocol) == "proto");
+	CHECK(rtcGetDataChannelStream(dcs[2]) == 20);
+
+	// Without inits, the defaults are used
+	const char *moreLabels[] = {"fourth", "fifth"};
+	int moreDcs[2] = {};
+	CHECK(rtcCreateDataChannels(local, moreLabels, nullptr, 2, moreDcs) == 2);
+	CHECK(waitUntil(
+	    [&]() { return incomingChannels == 5 && rtcIsOpen(moreDcs[0]) && rtcIsOpen(moreDcs[1]); }));
+
+	// Invalid arguments are reported without creating anything
+	CHECK(rtcCreateDataChannels(local, nullptr, nullptr, 2, moreDcs) == RTC_ERR_INVALID);
+	CHECK(rtcCreateDataChannels(local, labels, nullptr, -1, dcs) == RTC_ERR_INVALID);
+	CHECK(rtcCreateDataChannels(local, labels, nullptr, 0, dcs) == 0);
+
+	CHECK(rtcDeletePeerConnection(local) == RTC_ERR_SUCCESS);
+	CHECK(rtcDeletePeerConnection(remote) == RTC_ERR_SUCCESS);
+}
+
+TEST(iceRestartLatency) {
+	Pair pair = connectPair();
+	auto localUfrag = string(*pair.local->localDescription()->iceUfrag());
+	auto remoteUfrag = string(*pair.remote->localDescription()->iceUfrag());
+
+	// Renegotiating with the same credentials is not a restart
+	int offers = 0;
+	pair.local->onSignalingStateChange([&offers](PeerConnection::SignalingState state) {
+		if (state == PeerConnection::SignalingState::HaveLocalOffer)
+			++offers;
+	});
+	pair.local->setLocalDescription(Description::Type::Offer);
+	CHECK(waitUntil([&]() {
+		return offers == 1 &&
+		       pair.local->signalingState() == PeerConnection::SignalingState::Stable &&
+		       pair.remote->signalingState() == PeerConnection::SignalingState::Stable;
+	}));
+	CHECK(pair.remote->remoteDescription()->iceUfrag() == localUfrag);
+	CHECK(!waitUntil(
+	    [&]() {
+		    return pair.local->iceRestartLatency() || pair.remote->iceRestartLatency();
+	    },
+	    std::chrono::milliseconds(100)));
+
+	// The offerer measures from restartIce(), the answerer from the offer with new credentials
+	pair.local->restartIce();
+	CHECK(waitUntil(
+	    [&]() { return pair.local->iceRestartLatency() && pair.remote->iceRestartLatency(); }));
+	CHECK(pair.local->localDescription()->iceUfrag() != localUfrag);
+	CHECK(pair.remote->localDescription()->iceUfrag() != remoteUfrag);
+	CHECK(pair.local->iceRestartLatency()->count() >= 0);
+	CHECK(pair.remote->iceRestartLatency()->count() >= 0);
+
+	// The channel survives the restart
+	CHECK(pair.sender->isOpen() && pair.receiver->isOpen());
+	bool received = false;
+	pair.receiver->onMessage([&received](message_variant) { received = true; });
+	CHECK(pair.sender->send("after restart"));
+	CHECK(waitUntil([&]() { return received; }));
+	CHECK(pair.local->state() == PeerConnection::State::Connected);
+}
+
+int main() { return rtc::test::runAll(); }
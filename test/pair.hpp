@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_TEST_PAIR_H
+#define RTC_TEST_PAIR_H
+
+#include "test.hpp"
+
+#include "rtc/rtc.h"
+#include "rtc/rtc.hpp"
+
+namespace rtc::test {
+
+// Forwards descriptions and candidates between two peers. Raw pointers are captured so that the
+// callbacks don't keep the peers alive.
+inline void signal(PeerConnection *local, PeerConnection *remote) {
+	local->onLocalDescription([remote](const Description &d) { remote->setRemoteDescription(d); });
+	local->onLocalCandidate([remote](const Candidate &c) { remote->addRemoteCandidate(c); });
+	remote->onLocalDescription([local](const Description &d) { local->setRemoteDescription(d); });
+	remote->onLocalCandidate([local](const Candidate &c) { local->addRemoteCandidate(c); });
+}
+
+inline void RTC_API forwardDescription(int, const char *sdp, const char *type, void *ptr) {
+	rtcSetRemoteDescription(*static_cast<int *>(ptr), sdp, type);
+}
+
+inline void RTC_API forwardCandidate(int, const char *cand, const char *mid, void *ptr) {
+	rtcAddRemoteCandidate(*static_cast<int *>(ptr), cand, mid);
+}
+
+// Same for peers of the C API, the user pointer of each peer is set to the ID of the other one
+inline void signal(int *local, int *remote) {
+	rtcSetUserPointer(*local, remote);
+	rtcSetUserPointer(*remote, local);
+	for (int pc : {*local, *remote}) {
+		CHECK(rtcSetLocalDescriptionCallback(pc, forwardDescription) == RTC_ERR_SUCCESS);
+		CHECK(rtcSetLocalCandidateCallback(pc, forwardCandidate) == RTC_ERR_SUCCESS);
+	}
+}
+
+// Two connected peers with a channel opened by the local side
+struct Pair {
+	shared_ptr<PeerConnection> local;
+	shared_ptr<PeerConnection> remote;
+	shared_ptr<DataChannel> sender;
+	shared_ptr<DataChannel> receiver;
+};
+
+inline Pair connectPair(const string &label = "test", const Configuration &localConfig = {},
+                        const Configuration &remoteConfig = {}) {
+	Pair pair;
+	pair.local = std::make_shared<PeerConnection>(localConfig);
+	pair.remote = std::make_shared<PeerConnection>(remoteConfig);
+	signal(pair.local.get(), pair.remote.get());
+
+	auto receiver = std::make_shared<shared_ptr<DataChannel>>();
+	pair.remote->onDataChannel(
+	    [receiver](shared_ptr<DataChannel> dc) { *receiver = std::move(dc); });
+	pair.sender = pair.local->createDataChannel(label);
+
+	CHECK(waitUntil([&]() { return pair.sender->isOpen() && *receiver && (*receiver)->isOpen(); }));
+	pair.receiver = std::move(*receiver);
+	return pair;
+}
+
+} // namespace rtc::test
+
+#endif // RTC_TEST_PAIR_H
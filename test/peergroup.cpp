@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pair.hpp"
+
+#include "rtc/rtc.hpp"
+
+using namespace rtc;
+using rtc::test::connectPair;
+using rtc::test::Pair;
+using rtc::test::waitUntil;
+
+namespace {
+
+// A group reaching the remote side of each pair, with the messages each pair received
+struct Mesh {
+	std::vector<Pair> pairs;
+	std::vector<std::vector<string>> received;
+	PeerGroup group;
+
+	explicit Mesh(size_t count, size_t laggingThreshold = DEFAULT_LAGGING_THRESHOLD)
+	    : received(count), group(laggingThreshold) {
+		for (size_t i = 0; i < count; ++i) {
+			pairs.push_back(connectPair("peer-" + std::to_string(i)));
+			pairs[i].receiver->onMessage([this, i](message_variant message) {
+				if (auto str = std::get_if<string>(&message))
+					received[i].push_back(*str);
+				else
+					received[i].push_back("binary:" +
+					                      std::to_string(std::get<binary>(message).size()));
+			});
+			group.join("peer-" + std::to_string(i), pairs[i].local, pairs[i].sender);
+		}
+	}
+
+	bool allReceived(size_t count) const {
+		for (const auto &messages : received)
+			if (messages.size() < count)
+				return false;
+		return true;
+	}
+};
+
+} // namespace
+
+TEST(broadcastToAll) {
+	Mesh mesh(4);
+	CHECK(mesh.group.size() == 4);
+	CHECK(mesh.group.contains("peer-2"));
+	CHECK(mesh.group.dataChannel("peer-2") == mesh.pairs[2].sender);
+	CHECK(mesh.group.peerConnection("peer-2") == mesh.pairs[2].local);
+
+	CHECK(mesh.group.broadcast(string("hello")) == 4);
+	CHECK(mesh.group.broadcast(binary(32, byte(0x42))) == 4);
+	const byte raw[8] = {};
+	CHECK(mesh.group.broadcast(raw, sizeof(raw)) == 4);
+	CHECK(waitUntil([&]() { return mesh.allReceived(3); }));
+	for (const auto &messages : mesh.received) {
+		CHECK(messages.size() == 3);
+		CHECK(messages[0] == "hello");
+		CHECK(messages[1] == "binary:32");
+		CHECK(messages[2] == "binary:8");
+	}
+
+	// Sends are accounted on each member channel
+	for (const auto &pair : mesh.pairs) {
+		CHECK(pair.sender->metrics().messagesSent == 3);
+		CHECK(pair.sender->metrics().bytesSent == 5 + 32 + 8);
+	}
+}
+
+TEST(joinReplacesAndLeaves) {
+	Mesh mesh(2);
+	std::vector<string> joined;
+	std::vector<string> left;
+	mesh.group.onJoin([&joined](const string &id) { joined.push_back(id); });
+	mesh.group.onLeave([&left](const string &id) { left.push_back(id); });
+
+	// Joining with an existing id replaces the member
+	Pair other = connectPair("other");
+	mesh.group.join("peer-0", other.local, other.sender);
+	CHECK(mesh.group.size() == 2);
+	CHECK(mesh.group.dataChannel("peer-0") == other.sender);
+	CHECK(joined == std::vector<string>{"peer-0"});
+	CHECK_THROWS(mesh.group.join("peer-2", other.local, nullptr));
+
+	CHECK(mesh.group.leave("peer-1"));
+	CHECK(!mesh.group.leave("peer-1"));
+	CHECK(left == std::vector<string>{"peer-1"});
+	mesh.group.clear();
+	CHECK(mesh.group.size() == 0);
+	CHECK(left == (std::vector<string>{"peer-1", "peer-0"}));
+	CHECK(mesh.group.broadcast(string("nobody")) == 0);
+}
+
+TEST(closedChannelsLeave) {
+	Mesh mesh(3);
+	std::vector<string> left;
+	mesh.group.onLeave([&left](const string &id) { left.push_back(id); });
+
+	// Closed locally, and closed by the remote peer
+	mesh.pairs[0].sender->close();
+	mesh.pairs[2].receiver->close();
+	CHECK(waitUntil([&]() { return mesh.pairs[2].sender->isClosed(); }));
+
+	CHECK(mesh.group.broadcast(string("survivor")) == 1);
+	CHECK(mesh.group.size() == 1);
+	CHECK(mesh.group.contains("peer-1"));
+	CHECK(left == (std::vector<string>{"peer-0", "peer-2"}));
+	CHECK(waitUntil([&]() { return mesh.received[1].size() == 1; }));
+	CHECK(mesh.received[1][0] == "survivor");
+}
+
+TEST(laggingHysteresis) {
+	const size_t threshold = 4096;
+	Mesh mesh(2, threshold);
+	std::vector<std::pair<string, size_t>> lagging;
+	mesh.group.onLagging([&lagging](const string &id, size_t bufferedAmount) {
+		lagging.emplace_back(id, bufferedAmount);
+	});
+
+	// Crossing the threshold reports each member once, however many broadcasts follow
+	binary large(threshold, byte(0));
+	CHECK(mesh.group.broadcast(large) == 2);
+	CHECK(lagging.empty()); // the threshold is not exceeded yet
+	CHECK(mesh.group.broadcast(large) == 2);
+	CHECK(mesh.group.broadcast(large) == 2);
+	CHECK(lagging.size() == 2);
+	CHECK(lagging[0].first == "peer-0" && lagging[1].first == "peer-1");
+	CHECK(lagging[0].second > threshold);
+	CHECK(mesh.group.lagging() == (std::vector<string>{"peer-0", "peer-1"}));
+
+	// Once drained, a member recovers, and is reported again only on the next crossing
+	CHECK(waitUntil([&]() { return mesh.allReceived(3); }));
+	CHECK(waitUntil([&]() {
+		return mesh.pairs[0].sender->bufferedAmount() == 0 &&
+		       mesh.pairs[1].sender->bufferedAmount() == 0;
+	}));
+	CHECK(mesh.group.broadcast(string("small")) == 2);
+	CHECK(mesh.group.lagging().empty());
+	CHECK(lagging.size() == 2);
+
+	CHECK(mesh.group.broadcast(large) == 2);
+	CHECK(mesh.group.broadcast(large) == 2);
+	CHECK(lagging.size() == 4);
+
+	// Lowering the threshold applies on the next broadcast
+	CHECK(waitUntil([&]() { return mesh.allReceived(6); }));
+	mesh.group.setLaggingThreshold(0);
+	CHECK(mesh.group.broadcast(string("tiny")) == 2);
+	CHECK(mesh.group.lagging().size() == 2);
+}
+
+TEST(rejectedSends) {
+	Mesh mesh(2);
+	std::vector<string> lagging;
+	mesh.group.onLagging([&lagging](const string &id, size_t) { lagging.push_back(id); });
+
+	// The stub refuses messages over the maximum size, reported as a -1 buffered amount
+	binary oversized(262144 + 1, byte(0));
+	CHECK(mesh.group.broadcast(oversized) == 0);
+	for (const auto &pair : mesh.pairs) {
+		CHECK(pair.sender->metrics().sendRejected == 1);
+		CHECK(pair.sender->metrics().messagesSent == 0);
+	}
+	CHECK(mesh.group.size() == 2); // a rejected send does not make a member leave
+	CHECK(mesh.group.lagging().empty());
+	CHECK(lagging.empty());
+}
+
+int main() { return rtc::test::runAll(); }
@@ -0,0 +1,136 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "pair.hpp"
+
+#include "rtc/rtc.h"
+#include "rtc/rtc.hpp"
+
+#include <type_traits>
+
+using namespace rtc;
+using rtc::test::connectPair;
+using rtc::test::Pair;
+using rtc::test::waitUntil;
+
+static_assert(!std::is_copy_constructible_v<RttProbe> && !std::is_copy_assignable_v<RttProbe>,
+              "RttProbe callbacks capture this");
+
+namespace {
+
+// Incoming channels are kept by the C API once the callback is set
+void RTC_API keepDataChannel(int, int, void *) {}
+
+void checkStats(const RttProbe &probe) {
+	auto stats = probe.stats();
+	CHECK(stats.pongsReceived > 0);
+	CHECK(stats.pingsSent >= stats.pongsReceived);
+	CHECK(stats.last && stats.smoothed && stats.jitter && stats.min && stats.max);
+	CHECK(*stats.min >= 0);
+	CHECK(*stats.min <= *stats.smoothed && *stats.smoothed <= *stats.max);
+	CHECK(*stats.min <= *stats.last && *stats.last <= *stats.max);
+	CHECK(*stats.jitter >= 0);
+
+	auto p50 = probe.percentile(0.5);
+	auto p99 = probe.percentile(0.99);
+	CHECK(p50 && *p50 >= *stats.min && *p50 <= *stats.max);
+	CHECK(p99 && *p99 >= *p50 && *p99 <= *stats.max);
+	CHECK(probe.percentile(0) >= stats.min);
+	CHECK(probe.percentile(1) <= stats.max);
+}
+
+} // namespace
+
+TEST(measuresBothWays) {
+	Pair pair = connectPair();
+	const auto interval = std::chrono::milliseconds(5);
+	RttProbe localProbe(pair.local, RttProbe::DEFAULT_STREAM, interval);
+	RttProbe remoteProbe(pair.remote, RttProbe::DEFAULT_STREAM, interval);
+	CHECK(!localProbe.percentile(0.5));
+	CHECK(!localProbe.stats().smoothed);
+
+	// Each side answers the pings of the other and measures its own round trips
+	CHECK(waitUntil([&]() {
+		return localProbe.stats().pongsReceived >= 10 && remoteProbe.stats().pongsReceived >= 10;
+	}));
+	checkStats(localProbe);
+	checkStats(remoteProbe);
+
+	// The probe channel does not disturb the application channel
+	bool received = false;
+	pair.receiver->onMessage([&received](message_variant) { received = true; });
+	CHECK(pair.sender->send("data"));
+	CHECK(waitUntil([&]() { return received; }));
+}
+
+TEST(stopsWhenDestroyed) {
+	Pair pair = connectPair();
+	auto remoteProbe = std::make_unique<RttProbe>(pair.remote, uint16_t(100),
+	                                              std::chrono::milliseconds(5));
+	RttProbe localProbe(pair.local, uint16_t(100), std::chrono::milliseconds(5));
+	CHECK(waitUntil([&]() { return localProbe.stats().pongsReceived > 0; }));
+
+	// Without the remote probe, pings are not answered anymore
+	remoteProbe.reset();
+	waitUntil([]() { return false; }, std::chrono::milliseconds(20));
+	uint64_t pongs = localProbe.stats().pongsReceived;
+	waitUntil([]() { return false; }, std::chrono::milliseconds(50));
+	CHECK(localProbe.stats().pongsReceived == pongs);
+	CHECK(pair.sender->isOpen());
+}
+
+TEST(cApi) {
+	rtcConfiguration config = {};
+	int local = rtcCreatePeerConnection(&config);
+	int remote = rtcCreatePeerConnection(&config);
+	CHECK(local > 0 && remote > 0);
+	rtc::test::signal(&local, &remote);
+
+	// Connect first, so that the probes don't negotiate from both sides
+	CHECK(rtcSetDataChannelCallback(remote, keepDataChannel) == RTC_ERR_SUCCESS);
+	int dc = rtcCreateDataChannel(local, "test");
+	CHECK(waitUntil([&]() { return rtcIsOpen(dc); }));
+
+	rtcRttStats stats = {};
+	CHECK(rtcGetRttStats(local, &stats) == RTC_ERR_INVALID);
+	CHECK(rtcStartRttProbe(local, 65535, 5) == RTC_ERR_INVALID);
+	CHECK(rtcStartRttProbe(local, -1, 5) == RTC_ERR_SUCCESS);
+	CHECK(rtcStartRttProbe(remote, -1, 5) == RTC_ERR_SUCCESS);
+	CHECK(rtcGetRttStats(local, nullptr) == RTC_ERR_INVALID);
+
+	CHECK(waitUntil([&]() {
+		return rtcGetRttStats(local, &stats) == RTC_ERR_SUCCESS && stats.pongsReceived >= 10;
+	}));
+	CHECK(stats.pingsSent >= stats.pongsReceived);
+	CHECK(stats.min >= 0 && stats.min <= stats.smoothed && stats.smoothed <= stats.max);
+	CHECK(stats.p50 >= stats.min && stats.p50 <= stats.p90 && stats.p90 <= stats.p99 &&
+	      stats.p99 <= stats.max);
+
+	CHECK(rtcStopRttProbe(local) == RTC_ERR_SUCCESS);
+	CHECK(rtcGetRttStats(local, &stats) == RTC_ERR_INVALID);
+	CHECK(rtcDeletePeerConnection(local) == RTC_ERR_SUCCESS);
+	CHECK(rtcDeletePeerConnection(remote) == RTC_ERR_SUCCESS);
+}
+
+TEST(requiresPeerConnection) { CHECK_THROWS(RttProbe(nullptr)); }
+
+int main() { return rtc::test::runAll(); }
@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_TEST_H
+#define RTC_TEST_H
+
+// Minimal harness for the tests registered with ctest: each test is a function, and a failed check
+// aborts the test, is reported, and makes the executable exit with a non-zero status. Tests run
+// natively against the stub backend, or under Node with the mock WebRTC implementation.
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#include "rtcstub.hpp"
+#endif
+
+namespace rtc::test {
+
+struct Failure : std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+inline std::vector<std::pair<std::string, std::function<void()>>> &registry() {
+	static std::vector<std::pair<std::string, std::function<void()>>> tests;
+	return tests;
+}
+
+struct Register {
+	Register(std::string name, std::function<void()> func) {
+		registry().emplace_back(std::move(name), std::move(func));
+	}
+};
+
+// Lets the event loop run until the predicate returns true or the timeout expires, returns the
+// last result of the predicate
+inline bool waitUntil(const std::function<bool()> &predicate,
+                      std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+#ifdef __EMSCRIPTEN__
+	// Yields to the JS event loop, which requires ASYNCIFY
+	double deadline = emscripten_get_now() + double(timeout.count());
+	while (!predicate()) {
+		if (emscripten_get_now() >= deadline)
+			return false;
+		emscripten_sleep(1);
+	}
+	return true;
+#else
+	return stub::runUntil(predicate, timeout);
+#endif
+}
+
+inline int runAll() {
+	int failed = 0;
+	for (const auto &[name, func] : registry()) {
+		try {
+			func();
+			std::cout << "[ OK ] " << name << std::endl;
+		} catch (const std::exception &e) {
+			std::cout << "[FAIL] " << name << ": " << e.what() << std::endl;
+			++failed;
+		}
+	}
+	std::cout << registry().size() - failed << "/" << registry().size() << " passed" << std::endl;
+	return failed == 0 ? 0 : 1;
+}
+
+} // namespace rtc::test
+
+#define RTC_TEST_CONCAT_(a, b) a##b
+#define RTC_TEST_CONCAT(a, b) RTC_TEST_CONCAT_(a, b)
+
+#define TEST(name)                                                                                 \
+	static void name();                                                                            \
+	static rtc::test::Register RTC_TEST_CONCAT(name, Registration)(#name, name);                   \
+	static void name()
+
+#define CHECK(cond)                                                                                \
+	do {                                                                                           \
+		if (!(cond))                                                                               \
+			throw rtc::test::Failure(std::string(__FILE__ ":") + std::to_string(__LINE__) +        \
+			                         ": CHECK(" #cond ") failed");                                 \
+	} while (0)
+
+#define CHECK_THROWS(expr)                                                                         \
+	do {                                                                                           \
+		bool thrown = false;                                                                       \
+		try {                                                                                      \
+			(void)(expr);                                                                          \
+		} catch (const std::exception &) {                                                         \
+			thrown = true;                                                                         \
+		}                                                                                          \
+		if (!thrown)                                                                               \
+			throw rtc::test::Failure(std::string(__FILE__ ":") + std::to_string(__LINE__) +        \
+			                         ": " #expr " did not throw");                                 \
+	} while (0)
+
+#endif // RTC_TEST_H
@@ -0,0 +1,252 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "test.hpp"
+
+#include "rtc/rtc.h"
+#include "rtc/rtc.hpp"
+
+using namespace rtc;
+using rtc::test::waitUntil;
+
+namespace {
+
+const string Url = "ws://localhost:8080/echo";
+
+// Takes the in-memory server of the stub down for the scope
+struct ServerDown {
+	ServerDown() { stub::setWebSocketServerUp(false); }
+	~ServerDown() { stub::setWebSocketServerUp(true); }
+	void up() { stub::setWebSocketServerUp(true); }
+};
+
+WebSocket::Configuration reconnecting() {
+	WebSocket::Configuration config;
+	config.autoReconnect = true;
+	config.reconnectInitialDelay = std::chrono::milliseconds(4);
+	config.reconnectMaxDelay = std::chrono::milliseconds(32);
+	return config;
+}
+
+// Records the text messages and the events of a WebSocket
+struct Recorder {
+	std::vector<string> messages;
+	int opened = 0;
+	int closed = 0;
+
+	explicit Recorder(WebSocket &ws) {
+		ws.onOpen([this]() { ++opened; });
+		ws.onClosed([this]() { ++closed; });
+		ws.onMessage([this](message_variant message) {
+			if (auto str = std::get_if<string>(&message))
+				messages.push_back(*str);
+			else
+				messages.push_back("binary:" + std::to_string(std::get<binary>(message).size()));
+		});
+	}
+};
+
+int openedCount = 0;
+std::vector<string> cMessages;
+
+void RTC_API countOpen(int, void *) { ++openedCount; }
+
+void RTC_API recordMessage(int, const char *message, int size, void *) {
+	// A negative size is a null-terminated string
+	cMessages.push_back(size < 0 ? string(message) : "binary:" + std::to_string(size));
+}
+
+} // namespace
+
+TEST(echo) {
+	WebSocket ws;
+	Recorder recorder(ws);
+	ws.open(Url);
+	CHECK(!ws.isOpen() && !ws.isClosed());
+	CHECK(waitUntil([&]() { return ws.isOpen(); }));
+	CHECK(recorder.opened == 1);
+
+	CHECK(ws.send("hello"));
+	CHECK(ws.send(binary(16, byte(1))));
+	CHECK(ws.bufferedAmount() == 5 + 16);
+	CHECK(waitUntil([&]() { return recorder.messages.size() == 2; }));
+	CHECK(recorder.messages[0] == "hello");
+	CHECK(recorder.messages[1] == "binary:16");
+	CHECK(ws.bufferedAmount() == 0);
+
+	ws.close();
+	CHECK(ws.isClosed());
+	CHECK(!ws.send("late"));
+}
+
+TEST(closedWithoutReconnect) {
+	WebSocket ws;
+	Recorder recorder(ws);
+	ws.open(Url);
+	CHECK(waitUntil([&]() { return ws.isOpen(); }));
+
+	ServerDown down;
+	CHECK(waitUntil([&]() { return recorder.closed == 1; }));
+	CHECK(ws.isClosed());
+	CHECK(!ws.send("lost"));
+	CHECK(ws.reconnectMetrics().attempts == 0);
+}
+
+TEST(reconnectReplaysInOrder) {
+	WebSocket ws(reconnecting());
+	Recorder recorder(ws);
+	ws.open(Url);
+	CHECK(waitUntil([&]() { return ws.isOpen(); }));
+	CHECK(ws.send("before"));
+	CHECK(waitUntil([&]() { return recorder.messages.size() == 1; }));
+
+	ServerDown down;
+	CHECK(waitUntil([&]() { return !ws.isOpen(); }));
+	CHECK(!ws.isClosed()); // reconnecting
+
+	// Messages sent meanwhile are queued
+	const int count = 10;
+	size_t queued = 0;
+	for (int i = 0; i < count; ++i) {
+		string message = "queued-" + std::to_string(i);
+		queued += message.size();
+		CHECK(ws.send(message));
+	}
+	CHECK(ws.bufferedAmount() == queued);
+
+	// Attempts keep failing while the server is down
+	CHECK(waitUntil([&]() { return ws.reconnectMetrics().attempts >= 4; }));
+	auto metrics = ws.reconnectMetrics();
+	CHECK(metrics.reconnections == 0);
+	CHECK(recorder.closed == 0);
+	CHECK(recorder.messages.size() == 1);
+
+	// The queue is flushed once reopened, before any newer message
+	down.up();
+	CHECK(waitUntil([&]() { return ws.isOpen(); }));
+	CHECK(ws.send("after"));
+	CHECK(waitUntil([&]() { return recorder.messages.size() == size_t(count) + 2; }));
+	CHECK(recorder.messages.front() == "before");
+	for (int i = 0; i < count; ++i)
+		CHECK(recorder.messages[i + 1] == "queued-" + std::to_string(i));
+	CHECK(recorder.messages.back() == "after");
+	CHECK(recorder.opened == 2);
+
+	metrics = ws.reconnectMetrics();
+	CHECK(metrics.attempts >= 4);
+	CHECK(metrics.reconnections == 1);
+	CHECK(metrics.droppedMessages == 0);
+	CHECK(metrics.lastLatency.count() > 0);
+	CHECK(metrics.maxLatency == metrics.lastLatency);
+	CHECK(metrics.totalLatency == metrics.lastLatency);
+
+	// A second loss starts over from the initial delay
+	{
+		ServerDown again;
+		CHECK(waitUntil([&]() { return !ws.isOpen(); }));
+	}
+	CHECK(waitUntil([&]() { return ws.isOpen(); }));
+	metrics = ws.reconnectMetrics();
+	CHECK(metrics.reconnections == 2);
+	CHECK(metrics.totalLatency >= metrics.lastLatency);
+	CHECK(metrics.maxLatency >= metrics.lastLatency);
+}
+
+TEST(reconnectQueueLimit) {
+	auto config = reconnecting();
+	config.reconnectBufferSize = 16;
+	WebSocket ws(config);
+	ws.open(Url);
+	CHECK(waitUntil([&]() { return ws.isOpen(); }));
+
+	ServerDown down;
+	CHECK(waitUntil([&]() { return !ws.isOpen(); }));
+	CHECK(ws.send(string(10, 'a')));
+	CHECK(!ws.send(string(10, 'b')));
+	CHECK(ws.send(string(6, 'c')));
+	CHECK(ws.reconnectMetrics().droppedMessages == 1);
+	CHECK(ws.metrics().sendRejected == 1);
+}
+
+TEST(reconnectGivesUp) {
+	auto config = reconnecting();
+	config.maxReconnectAttempts = 3;
+	WebSocket ws(config);
+	Recorder recorder(ws);
+	ws.open(Url);
+	CHECK(waitUntil([&]() { return ws.isOpen(); }));
+
+	ServerDown down;
+	CHECK(waitUntil([&]() { return !ws.isOpen(); }));
+	CHECK(ws.send("pending"));
+	CHECK(waitUntil([&]() { return recorder.closed == 1; }));
+	CHECK(ws.isClosed());
+	CHECK(ws.reconnectMetrics().attempts == 3);
+	CHECK(ws.reconnectMetrics().reconnections == 0);
+	CHECK(ws.bufferedAmount() == 0); // the queue is dropped
+	CHECK(!ws.send("late"));
+}
+
+TEST(cApi) {
+	const char *protocols[] = {"echo"};
+	rtcWsConfiguration config = {};
+	config.protocols = protocols;
+	config.protocolsCount = 1;
+	config.autoReconnect = true;
+	config.reconnectInitialDelayMs = 4;
+	config.reconnectMaxDelayMs = 32;
+	int ws = rtcCreateWebSocketEx(Url.c_str(), &config);
+	CHECK(ws > 0);
+
+	openedCount = 0;
+	cMessages.clear();
+	rtcSetUserPointer(ws, &config);
+	CHECK(rtcSetOpenCallback(ws, countOpen) == RTC_ERR_SUCCESS);
+	CHECK(rtcSetMessageCallback(ws, recordMessage) == RTC_ERR_SUCCESS);
+	CHECK(waitUntil([&]() { return rtcIsOpen(ws); }));
+
+	rtcWsReconnectMetrics metrics = {};
+	CHECK(rtcGetWebSocketReconnectMetrics(ws, &metrics) == RTC_ERR_SUCCESS);
+	CHECK(metrics.attempts == 0 && metrics.reconnections == 0);
+	CHECK(rtcGetWebSocketReconnectMetrics(ws, nullptr) == RTC_ERR_INVALID);
+	CHECK(rtcGetWebSocketReconnectMetrics(ws + 1000, &metrics) == RTC_ERR_INVALID);
+
+	{
+		ServerDown down;
+		CHECK(waitUntil([&]() { return !rtcIsOpen(ws); }));
+		CHECK(rtcSendMessage(ws, "queued", -1) >= 0);
+		CHECK(waitUntil([&]() {
+			return rtcGetWebSocketReconnectMetrics(ws, &metrics) == RTC_ERR_SUCCESS &&
+			       metrics.attempts >= 2;
+		}));
+	}
+	CHECK(waitUntil([&]() { return cMessages.size() == 1; }));
+	CHECK(cMessages[0] == "queued");
+	CHECK(openedCount == 2);
+	CHECK(rtcGetWebSocketReconnectMetrics(ws, &metrics) == RTC_ERR_SUCCESS);
+	CHECK(metrics.reconnections == 1);
+	CHECK(metrics.lastLatencyMs > 0 && metrics.totalLatencyMs == metrics.lastLatencyMs);
+
+	CHECK(rtcDeleteWebSocket(ws) == RTC_ERR_SUCCESS);
+}
+
+int main() { return rtc::test::runAll(); }
@@ -26,19 +26,55 @@
 #include "common.hpp"
 
 #include <iostream>
+#include <string_view>
 
 namespace rtc {
 
 class Candidate {
 public:
+	enum class Type { Unknown, Host, ServerReflexive, PeerReflexive, Relayed };
+	enum class TransportType { Unknown, Udp, TcpActive, TcpPassive, TcpSo, TcpUnknown };
+
 	Candidate(const string &candidate, const string &mid);
-	string candidate() const;
-	string mid() const;
+
+	const string &candidate() const;
+	const string &mid() const;
 	operator string() const;
 
+	// Fields are parsed once on construction, views point into the candidate and share its
+	// lifetime. isParsed() is false if the candidate line is malformed.
+	bool isParsed() const;
+	std::string_view foundation() const;
+	uint16_t component() const;
+	std::string_view transport() const; // "udp" or "tcp"
+	TransportType transportType() const;
+	uint32_t priority() const;
+	std::string_view address() const;
+	uint16_t port() const;
+	Type type() const;
+	std::string_view typeString() const; // "host", "srflx", "prflx" or "relay"
+	optional<std::string_view> relatedAddress() const;
+	optional<uint16_t> relatedPort() const;
+
 private:
+	struct Field {
+		size_t pos = string::npos;
+		size_t len = 0;
+	};
+
+	void parse();
+	std::string_view field(const Field &f) const;
+
 	string mCandidate;
 	string mMid;
+
+	bool mParsed = false;
+	Field mFoundation, mTransport, mAddress, mType, mRelatedAddress;
+	uint16_t mComponent = 0;
+	uint32_t mPriority = 0;
+	uint16_t mPort = 0;
+	optional<uint16_t> mRelatedPort;
+	TransportType mTransportType = TransportType::Unknown;
 };
 
 } // namespace rtc
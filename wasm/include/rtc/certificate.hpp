@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_CERTIFICATE_H
+#define RTC_CERTIFICATE_H
+
+#include "common.hpp"
+#include "configuration.hpp"
+
+namespace rtc {
+
+// Handle on a DTLS certificate generated by the browser, which may be shared by many
+// PeerConnections instead of generating a new one for each connection
+class Certificate final {
+public:
+	// Generation is asynchronous, the certificate is only used once it is ready
+	static shared_ptr<Certificate> Generate(CertificateType type = CertificateType::Default);
+
+	// Warm the shared cache used by PeerConnections which have no explicit certificate
+	static void Preload(CertificateType type = CertificateType::Default);
+
+	~Certificate();
+
+	CertificateType type() const;
+	bool isReady() const; // generated and not expired
+
+private:
+	friend class PeerConnection;
+
+	Certificate(int id, CertificateType type);
+
+	int mId;
+	CertificateType mType;
+};
+
+} // namespace rtc
+
+#endif // RTC_CERTIFICATE_H
@@ -25,10 +25,27 @@
 
 #include "common.hpp"
 
+#include <array>
 #include <functional>
 
 namespace rtc {
 
+struct ChannelMetrics {
+	// Upper bounds in microseconds of the dispatch latency buckets, the last one is unbounded
+	static constexpr std::array<uint32_t, 7> DispatchLatencyBounds = {10,   50,   100,  500,
+	                                                                  1000, 5000, 16000};
+
+	uint64_t messagesSent = 0;
+	uint64_t bytesSent = 0;
+	uint64_t messagesReceived = 0;
+	uint64_t bytesReceived = 0;
+	uint64_t sendRejected = 0; // messages refused by send()
+	uint64_t peakBufferedAmount = 0;
+
+	// Time spent in the message callback
+	std::array<uint64_t, DispatchLatencyBounds.size() + 1> dispatchLatency = {};
+};
+
 class Channel {
 public:
 	virtual ~Channel() = default;
@@ -40,6 +57,7 @@ public:
 	virtual bool isOpen() const = 0;
 	virtual bool isClosed() const = 0;
 	virtual size_t bufferedAmount() const;
+	virtual size_t maxMessageSize() const;
 
 	void onOpen(std::function<void()> callback);
 	void onClosed(std::function<void()> callback);
@@ -51,6 +69,9 @@ public:
 
 	virtual void setBufferedAmountLowThreshold(size_t amount);
 
+	const ChannelMetrics &metrics() const;
+	void resetMetrics();
+
 protected:
 	virtual void triggerOpen();
 	virtual void triggerClosed();
@@ -58,7 +79,13 @@ protected:
 	virtual void triggerMessage(message_variant data);
 	virtual void triggerBufferedAmountLow();
 
+	void recordSent(size_t size);
+	void recordSendRejected();
+	void recordBufferedAmount(size_t amount);
+
 private:
+	ChannelMetrics mMetrics;
+
 	std::function<void()> mOpenCallback;
 	std::function<void()> mClosedCallback;
 	std::function<void(string error)> mErrorCallback;
@@ -52,6 +52,10 @@ using std::uint32_t;
 using std::uint64_t;
 using std::uint8_t;
 
+const size_t DEFAULT_MAX_MESSAGE_SIZE = 65536;     // Remote max message size if not specified
+const size_t DEFAULT_WS_MAX_MESSAGE_SIZE = 262144; // Default WebSocket max message size
+const size_t DEFAULT_LAGGING_THRESHOLD = 262144;   // Default PeerGroup lagging threshold
+
 template <class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
 template <class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 
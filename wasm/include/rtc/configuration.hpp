@@ -23,8 +23,11 @@
 #ifndef RTC_CONFIGURATION_H
 #define RTC_CONFIGURATION_H
 
+#include "candidate.hpp"
 #include "common.hpp"
 
+#include <chrono>
+#include <functional>
 #include <vector>
 
 namespace rtc {
@@ -55,8 +58,76 @@ struct IceServer {
 	RelayType relayType;
 };
 
+enum class CertificateType { Default = 0, Ecdsa = 1, Rsa = 2 };
+
+enum class TransportPolicy { All = 0, Relay = 1 };
+
+enum class BundlePolicy { Balanced = 0, MaxCompat = 1, MaxBundle = 2 };
+
+enum class RtcpMuxPolicy { Require = 0, Negotiate = 1 };
+
+// Candidates rejected by the filter are neither signaled to nor accepted from the remote peer
+struct CandidateFilter {
+	bool udp = true;
+	bool tcp = true;
+	bool host = true;
+	bool serverReflexive = true;
+	bool peerReflexive = true;
+	bool relayed = true;
+	bool ipv6 = true;
+	bool linkLocal = true; // 169.254.0.0/16 and fe80::/10
+
+	// Called last for candidates allowed by the flags above, returns false to drop the candidate
+	std::function<bool(const Candidate &candidate)> custom;
+
+	bool acceptsAll() const;
+	bool accept(const Candidate &candidate) const;
+};
+
+class Certificate;
+
 struct Configuration {
+	enum class CandidateSignaling : int {
+		Trickle = 0,   // each local candidate is emitted as soon as it is gathered
+		Batch = 1,     // local candidates are emitted in batches
+		NonTrickle = 2 // candidates are embedded in the local description
+	};
+
 	std::vector<IceServer> iceServers;
+	TransportPolicy iceTransportPolicy = TransportPolicy::All;
+	BundlePolicy bundlePolicy = BundlePolicy::Balanced;
+	RtcpMuxPolicy rtcpMuxPolicy = RtcpMuxPolicy::Require;
+	uint16_t iceCandidatePoolSize = 0; // candidates pre-gathered before setLocalDescription
+
+	// Without an explicit certificate, a preloaded certificate of the given type is reused if
+	// available, otherwise the browser generates a new one for the connection.
+	CertificateType certificateType = CertificateType::Default;
+	shared_ptr<Certificate> certificate;
+
+	CandidateSignaling candidateSignaling = CandidateSignaling::Trickle;
+	std::chrono::milliseconds candidateBatchInterval{50}; // max delay of a candidate in Batch mode
+	// In NonTrickle mode, emit the description after this delay even if gathering is incomplete
+	optional<std::chrono::milliseconds> maxGatheringDelay;
+
+	// If disabled, the user must call setLocalDescription() to negotiate
+	bool disableAutoNegotiation = false;
+
+	CandidateFilter candidateFilter;
+};
+
+struct WebSocketConfiguration {
+	std::vector<string> protocols;
+	optional<size_t> maxMessageSize; // in bytes, applies to both directions
+
+	// Use WebSocketStream when the browser supports it, which provides backpressure
+	bool preferWebSocketStream = false;
+
+	// Automatic reconnection with jittered exponential backoff
+	bool autoReconnect = false;
+	std::chrono::milliseconds reconnectInitialDelay{250};
+	std::chrono::milliseconds reconnectMaxDelay{30000};
+	optional<unsigned int> maxReconnectAttempts; // unlimited if unset
+	size_t reconnectBufferSize = 1024 * 1024;    // in bytes, queued while reconnecting
 };
 
 } // namespace rtc
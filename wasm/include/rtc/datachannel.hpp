@@ -41,13 +41,23 @@ public:
 	bool isOpen() const override;
 	bool isClosed() const override;
 	size_t bufferedAmount() const override;
+	optional<uint16_t> stream() const;
+	optional<uint16_t> id() const;
 	string label() const;
+	string protocol() const;
 	Reliability reliability() const;
 
 	void setBufferedAmountLowThreshold(size_t amount) override;
 
 private:
+	friend class PeerConnection;
+	friend class PeerGroup;
+
+	// Unbound DataChannel, used by PeerConnection to create several channels in one go
+	explicit DataChannel(string label);
+
 	void triggerOpen() override;
+	bool sendMessage(const char *data, int size, size_t length);
 
 	int mId;
 	string mLabel;
@@ -23,9 +23,11 @@
 #ifndef RTC_DESCRIPTION_H
 #define RTC_DESCRIPTION_H
 
+#include "candidate.hpp"
 #include "common.hpp"
 
 #include <iostream>
+#include <string_view>
 
 namespace rtc {
 
@@ -39,14 +41,56 @@ public:
 	Type type() const;
 	string typeString() const;
 
+	// Parsed on first access, views point into the description and share its lifetime
+	optional<std::string_view> iceUfrag() const;
+	optional<std::string_view> icePwd() const;
+	optional<std::string_view> fingerprint() const; // algorithm and hash, like "sha-256 AB:CD:..."
+	optional<uint16_t> sctpPort() const;
+	optional<size_t> maxMessageSize() const;
+	size_t candidateCount() const;
+	std::vector<Candidate> candidates() const;
+
 	operator string() const;
 
+	// Compact binary form of a data channel only description, keeping only its variable parts
+	// (origin, ICE credentials, fingerprint, setup role, SCTP parameters and candidates) for
+	// signaling. Decoding reconstructs an equivalent SDP. Encoding throws std::invalid_argument if
+	// the description has anything the compact form can't represent, like missing ICE credentials,
+	// several or malformed fingerprints, or an unknown setup role or type.
+	binary encodeCompact() const;
+	static Description decodeCompact(const binary &data);
+
 	static Type stringToType(const string &typeString);
 	static string typeToString(Type type);
 
 private:
+	// Location of a value as an offset into mSdp, so that copies stay valid
+	struct Field {
+		size_t pos = string::npos;
+		size_t len = 0;
+	};
+
+	struct Parsed {
+		Field username, ufrag, pwd, fingerprint, setup, mid, iceOptions;
+		uint64_t sessionId = 0;
+		uint64_t sessionVersion = 0;
+		optional<uint16_t> sctpPort;
+		optional<size_t> maxMessageSize;
+		size_t candidateCount = 0;
+		int fingerprintCount = 0;
+		bool trickle = false;
+		bool endOfCandidates = false;
+		int applicationCount = 0;
+		int otherMediaCount = 0;
+	};
+
+	const Parsed &parsed() const;
+	optional<std::string_view> field(const Field &f) const;
+
 	string mSdp;
-	string mType;
+	Type mType;
+	string mUnknownType; // Original type string, only kept when it does not map to a Type
+	mutable optional<Parsed> mParsed;
 };
 
 } // namespace rtc
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_GLOBAL_H
+#define RTC_GLOBAL_H
+
+#include "common.hpp"
+
+namespace rtc {
+
+// Optional, warms up the default certificate cache
+void Preload();
+void Cleanup();
+
+// Number of browser objects still registered by the library, for leak checks
+size_t LiveObjectCount();
+
+// Wasm heap allocated by the JS glue, for instance to pass messages and descriptions. Only
+// accounted when built with RTC_ENABLE_HEAP_STATS, stats are zero otherwise.
+enum class HeapSource { Messages = 0, Sdp = 1, Candidates = 2, Errors = 3, Other = 4, Total = -1 };
+
+struct HeapStats {
+	uint64_t liveBytes = 0;
+	uint64_t allocations = 0; // cumulative
+	uint64_t peakBytes = 0;
+};
+
+HeapStats GetHeapStats(HeapSource source = HeapSource::Total);
+
+} // namespace rtc
+
+#endif // RTC_GLOBAL_H
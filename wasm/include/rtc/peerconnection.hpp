@@ -30,14 +30,25 @@
 #include "description.hpp"
 #include "reliability.hpp"
 
+#include <array>
+#include <chrono>
 #include <functional>
 #include <optional>
 #include <variant>
+#include <vector>
 
 namespace rtc {
 
 struct DataChannelInit {
 	Reliability reliability = {};
+	bool negotiated = false;         // if true, the channel is negotiated out-of-band
+	optional<uint16_t> id = nullopt; // stream ID, required for negotiated channels
+	string protocol = "";
+};
+
+struct ChannelSpec {
+	string label;
+	DataChannelInit init = {};
 };
 
 struct LocalDescriptionInit {
@@ -76,6 +87,16 @@ public:
 		HaveRemotePranswer = 4,
 	};
 
+	// Sampled asynchronously from RTCPeerConnection.getStats()
+	struct Stats {
+		double timestamp = 0; // in milliseconds, 0 if not sampled yet
+		optional<double> rtt; // in milliseconds, of the selected candidate pair
+		uint64_t bytesSent = 0;
+		uint64_t bytesReceived = 0;
+		uint64_t messagesSent = 0; // on all data channels
+		uint64_t messagesReceived = 0;
+	};
+
 	PeerConnection();
 	PeerConnection(const Configuration &config);
 	~PeerConnection();
@@ -88,16 +109,46 @@ public:
 	SignalingState signalingState() const;
 	optional<Description> localDescription() const;
 	optional<Description> remoteDescription() const;
+	bool negotiationNeeded() const;
+
+	// The first call starts sampling, subsequent calls read the cached sample
+	Stats stats() const;
+	void setStatsInterval(std::chrono::milliseconds interval);
+	optional<double> rtt() const; // in milliseconds
+	uint64_t bytesSent() const;
+	uint64_t bytesReceived() const;
+	bool getSelectedCandidatePair(Candidate *local, Candidate *remote) const;
+	optional<string> localAddress() const;
+	optional<string> remoteAddress() const;
+
+	// Applies to local candidates before they are signaled and to remote candidates, including
+	// those embedded in descriptions
+	void setCandidateFilter(CandidateFilter filter);
+	uint64_t localCandidatesDropped() const;
+	uint64_t remoteCandidatesDropped() const;
 
 	shared_ptr<DataChannel> createDataChannel(const string &label, DataChannelInit init = {});
 
+	// Create, register and wire all channels with a single call into the browser
+	std::vector<shared_ptr<DataChannel>> createDataChannels(const std::vector<ChannelSpec> &specs);
+
 	void setLocalDescription(Description::Type type = Description::Type::Unspec, LocalDescriptionInit init = {});
+
+	// Restart ICE while keeping the transport and open channels. The new offer is emitted through
+	// onLocalDescription, automatically unless auto-negotiation is disabled.
+	void restartIce();
+	// Time from the last ICE restart until connectivity was restored, if it was. It is measured
+	// from restartIce() on the offering side, and from receiving an offer with new ICE credentials
+	// on the answering side.
+	optional<std::chrono::milliseconds> iceRestartLatency() const;
 	void setRemoteDescription(const Description &description);
 	void addRemoteCandidate(const Candidate &candidate);
 
 	void onDataChannel(std::function<void(shared_ptr<DataChannel>)> callback);
 	void onLocalDescription(std::function<void(const Description &description)> callback);
 	void onLocalCandidate(std::function<void(const Candidate &candidate)> callback);
+	// In Batch mode, receive each batch at once instead of calling onLocalCandidate repeatedly
+	void onLocalCandidates(std::function<void(const std::vector<Candidate> &candidates)> callback);
 	void onStateChange(std::function<void(State state)> callback);
 	void onIceStateChange(std::function<void(IceState state)> callback);
 	void onGatheringStateChange(std::function<void(GatheringState state)> callback);
@@ -107,6 +158,7 @@ protected:
 	void triggerDataChannel(shared_ptr<DataChannel> dataChannel);
 	void triggerLocalDescription(const Description &description);
 	void triggerLocalCandidate(const Candidate &candidate);
+	void triggerLocalCandidates(const std::vector<Candidate> &candidates);
 	void triggerStateChange(State state);
 	void triggerIceStateChange(IceState state);
 	void triggerGatheringStateChange(GatheringState state);
@@ -115,25 +167,56 @@ protected:
 	std::function<void(shared_ptr<DataChannel>)> mDataChannelCallback;
 	std::function<void(const Description &description)> mLocalDescriptionCallback;
 	std::function<void(const Candidate &candidate)> mLocalCandidateCallback;
+	std::function<void(const std::vector<Candidate> &candidates)> mLocalCandidatesCallback;
 	std::function<void(State state)> mStateChangeCallback;
 	std::function<void(IceState state)> mIceStateChangeCallback;
 	std::function<void(GatheringState state)> mGatheringStateChangeCallback;
 	std::function<void(SignalingState state)> mSignalingStateChangeCallback;
 
 private:
+	void startStats() const;
+
 	int mId;
 	State mState = State::New;
 	IceState mIceState = IceState::New;
 	GatheringState mGatheringState = GatheringState::New;
 	SignalingState mSignalingState = SignalingState::Stable;
 
+	void startIceRestart();
+	void checkIceRestart();
+	void completeIceRestart();
+	// Counts removed candidates in dropped unless it is null
+	Description filterCandidates(const Description &description, uint64_t *dropped) const;
+
+	CandidateFilter mCandidateFilter;
+	Configuration::CandidateSignaling mCandidateSignaling;
+	uint64_t mLocalCandidatesDropped = 0;
+	uint64_t mRemoteCandidatesDropped = 0;
+
+	// The restart completes when ICE goes through Checking to Connected or Completed again, or
+	// when a new candidate pair is selected while connected
+	bool mIceRestarting = false;
+	bool mIceRestartChecking = false;
+	double mIceRestartTime = 0;
+	string mRemoteIceUfrag;
+	string mRemoteIcePwd;
+	optional<std::chrono::milliseconds> mIceRestartLatency;
+
+	// Written by the browser side: timestamp, rtt, bytes sent and received, messages sent and
+	// received. The rtt is negative if unknown.
+	mutable std::array<double, 6> mStatsBuffer = {};
+	mutable bool mStatsStarted = false;
+	std::chrono::milliseconds mStatsInterval{1000};
+
 	static void DataChannelCallback(int dc, void *ptr);
 	static void DescriptionCallback(const char *sdp, const char *type, void *ptr);
 	static void CandidateCallback(const char *candidate, const char *mid, void *ptr);
+	static void CandidatesCallback(const char *buffer, int count, void *ptr);
 	static void StateChangeCallback(int state, void *ptr);
 	static void IceStateChangeCallback(int state, void *ptr);
 	static void GatheringStateChangeCallback(int state, void *ptr);
 	static void SignalingStateChangeCallback(int state, void *ptr);
+	static void SelectedCandidatePairChangeCallback(void *ptr);
 };
 
 } // namespace rtc
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_PEERCONNECTIONPOOL_H
+#define RTC_PEERCONNECTIONPOOL_H
+
+#include "common.hpp"
+#include "configuration.hpp"
+#include "peerconnection.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace rtc {
+
+// Keeps PeerConnections constructed in advance so that a session can start without waiting for
+// the browser to create the connection and generate its certificate
+class PeerConnectionPool final {
+public:
+	// If preGather is true, each pooled connection starts gathering candidates immediately
+	PeerConnectionPool(Configuration config, size_t size, bool preGather = false);
+	~PeerConnectionPool();
+
+	// Never blocks: if the pool is empty, a new PeerConnection is created on the spot
+	shared_ptr<PeerConnection> acquire();
+
+	// Give back a used or failed PeerConnection, which is destroyed and replaced asynchronously
+	void release(shared_ptr<PeerConnection> peerConnection);
+
+	void resize(size_t size);
+	size_t size() const;
+	size_t available() const;
+
+private:
+	shared_ptr<PeerConnection> create();
+	void schedule();
+	void process();
+
+	Configuration mConfig;
+	size_t mSize;
+	std::deque<shared_ptr<PeerConnection>> mIdle;
+	std::vector<shared_ptr<PeerConnection>> mRetired;
+	int mTimeout;
+
+	static void ProcessCallback(void *ptr);
+};
+
+} // namespace rtc
+
+#endif // RTC_PEERCONNECTIONPOOL_H
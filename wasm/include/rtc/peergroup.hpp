@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_PEERGROUP_H
+#define RTC_PEERGROUP_H
+
+#include "common.hpp"
+#include "datachannel.hpp"
+#include "peerconnection.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace rtc {
+
+// Set of peers, each with a PeerConnection and the DataChannel used to reach it, typically a
+// full mesh in a room. Broadcasting copies the payload once and sends it with a single call into
+// the browser, instead of one call per peer.
+class PeerGroup final {
+public:
+	struct Member {
+		string id;
+		shared_ptr<PeerConnection> peerConnection;
+		shared_ptr<DataChannel> dataChannel;
+	};
+
+	// Members with more than laggingThreshold bytes buffered after a broadcast are lagging
+	explicit PeerGroup(size_t laggingThreshold = DEFAULT_LAGGING_THRESHOLD);
+	~PeerGroup();
+
+	// Replaces any member with the same id
+	void join(string id, shared_ptr<PeerConnection> peerConnection,
+	          shared_ptr<DataChannel> dataChannel);
+	bool leave(const string &id);
+	void clear();
+
+	bool contains(const string &id) const;
+	size_t size() const;
+	const std::vector<Member> &members() const;
+	shared_ptr<DataChannel> dataChannel(const string &id) const;
+	shared_ptr<PeerConnection> peerConnection(const string &id) const;
+
+	// Returns the number of members the message was sent to. Members whose channel is closed
+	// leave the group.
+	size_t broadcast(message_variant data);
+	size_t broadcast(const byte *data, size_t size);
+
+	// Members lagging after the last broadcast
+	std::vector<string> lagging() const;
+	void setLaggingThreshold(size_t threshold);
+
+	void onJoin(std::function<void(const string &id)> callback);
+	void onLeave(std::function<void(const string &id)> callback);
+	void onLagging(std::function<void(const string &id, size_t bufferedAmount)> callback);
+
+private:
+	size_t broadcast(const char *data, int size, size_t length);
+	void remove(std::vector<Member>::iterator it);
+
+	std::vector<Member> mMembers;
+	size_t mLaggingThreshold;
+	std::vector<bool> mLagging; // parallel to mMembers
+
+	// Reused across broadcasts to avoid allocating for each message
+	std::vector<int> mIds;
+	std::vector<int> mBufferedAmounts;
+
+	std::function<void(const string &id)> mJoinCallback;
+	std::function<void(const string &id)> mLeaveCallback;
+	std::function<void(const string &id, size_t bufferedAmount)> mLaggingCallback;
+};
+
+} // namespace rtc
+
+#endif // RTC_PEERGROUP_H
@@ -119,6 +119,20 @@ typedef enum {
 
 typedef enum { RTC_TRANSPORT_POLICY_ALL = 0, RTC_TRANSPORT_POLICY_RELAY = 1 } rtcTransportPolicy;
 
+typedef enum {
+	RTC_BUNDLE_POLICY_BALANCED = 0,
+	RTC_BUNDLE_POLICY_MAX_COMPAT = 1,
+	RTC_BUNDLE_POLICY_MAX_BUNDLE = 2
+} rtcBundlePolicy;
+
+typedef enum { RTC_RTCP_MUX_POLICY_REQUIRE = 0, RTC_RTCP_MUX_POLICY_NEGOTIATE = 1 } rtcRtcpMuxPolicy;
+
+typedef enum {
+	RTC_CANDIDATE_SIGNALING_TRICKLE = 0,
+	RTC_CANDIDATE_SIGNALING_BATCH = 1,
+	RTC_CANDIDATE_SIGNALING_NON_TRICKLE = 2
+} rtcCandidateSignaling;
+
 #define RTC_ERR_SUCCESS 0
 #define RTC_ERR_INVALID -1   // invalid argument
 #define RTC_ERR_FAILURE -2   // runtime error
@@ -156,6 +170,15 @@ RTC_C_EXPORT void *rtcGetUserPointer(int i);
 typedef struct {
 	const char **iceServers;
 	int iceServersCount;
+	rtcCertificateType certificateType; // a preloaded certificate of this type is reused
+	rtcTransportPolicy iceTransportPolicy;
+	rtcBundlePolicy bundlePolicy;
+	rtcRtcpMuxPolicy rtcpMuxPolicy;
+	int iceCandidatePoolSize; // number of candidates to pre-gather, 0 means none
+	bool disableAutoNegotiation; // if true, the user is responsible for calling rtcSetLocalDescription
+	rtcCandidateSignaling candidateSignaling;
+	int candidateBatchIntervalMs; // in milliseconds, <= 0 means default
+	int maxGatheringDelayMs;      // in milliseconds, <= 0 means unlimited
 } rtcConfiguration;
 
 RTC_C_EXPORT int rtcCreatePeerConnection(const rtcConfiguration *config); // returns pc id
@@ -187,6 +210,23 @@ RTC_C_EXPORT int rtcGetSelectedCandidatePair(int pc, char *local, int localSize,
 
 RTC_C_EXPORT bool rtcIsNegotiationNeeded(int pc);
 
+RTC_C_EXPORT int rtcRestartIce(int pc);
+RTC_C_EXPORT int rtcGetIceRestartLatency(int pc); // in milliseconds
+
+// Statistics, sampled asynchronously from the browser
+
+typedef struct {
+	double timestamp; // in milliseconds, 0 if not sampled yet
+	double rtt;       // in milliseconds, negative if unknown
+	uint64_t bytesSent;
+	uint64_t bytesReceived;
+	uint64_t messagesSent;
+	uint64_t messagesReceived;
+} rtcStats;
+
+RTC_C_EXPORT int rtcGetStats(int pc, rtcStats *stats);
+RTC_C_EXPORT int rtcSetStatsInterval(int pc, int intervalMs);
+
 RTC_C_EXPORT int rtcGetMaxDataChannelStream(int pc);
 RTC_C_EXPORT int rtcGetRemoteMaxMessageSize(int pc);
 
@@ -207,6 +247,22 @@ RTC_C_EXPORT int rtcGetBufferedAmount(int id); // total size buffered to send
 RTC_C_EXPORT int rtcSetBufferedAmountLowThreshold(int id, int amount);
 RTC_C_EXPORT int rtcSetBufferedAmountLowCallback(int id, rtcBufferedAmountLowCallbackFunc cb);
 
+#define RTC_DISPATCH_LATENCY_BUCKETS 8
+
+typedef struct {
+	uint64_t messagesSent;
+	uint64_t bytesSent;
+	uint64_t messagesReceived;
+	uint64_t bytesReceived;
+	uint64_t sendRejected;
+	uint64_t peakBufferedAmount;
+	// Message callback durations, in buckets bounded by 10, 50, 100, 500, 1000, 5000 and 16000 us
+	uint64_t dispatchLatency[RTC_DISPATCH_LATENCY_BUCKETS];
+} rtcChannelMetrics;
+
+RTC_C_EXPORT int rtcGetChannelMetrics(int id, rtcChannelMetrics *metrics);
+RTC_C_EXPORT int rtcResetChannelMetrics(int id);
+
 // DataChannel, and WebSocket common extended API
 
 RTC_C_EXPORT int rtcGetAvailableAmount(int id); // total size available to receive
@@ -234,6 +290,29 @@ RTC_C_EXPORT int rtcSetDataChannelCallback(int pc, rtcDataChannelCallbackFunc cb
 RTC_C_EXPORT int rtcCreateDataChannel(int pc, const char *label); // returns dc id
 RTC_C_EXPORT int rtcCreateDataChannelEx(int pc, const char *label,
                                         const rtcDataChannelInit *init); // returns dc id
+// Create count channels at once, inits may be NULL, ids are written to dcs, returns count
+RTC_C_EXPORT int rtcCreateDataChannels(int pc, const char **labels, const rtcDataChannelInit *inits,
+                                       int count, int *dcs);
+
+// Round-trip time probe on a dedicated negotiated channel, to be started on both peers
+
+typedef struct {
+	uint64_t pingsSent;
+	uint64_t pongsReceived;
+	// In milliseconds, negative if no sample yet
+	double last;
+	double smoothed;
+	double jitter;
+	double min;
+	double max;
+	double p50;
+	double p90;
+	double p99;
+} rtcRttStats;
+
+RTC_C_EXPORT int rtcStartRttProbe(int pc, int stream, int intervalMs); // stream < 0 means default
+RTC_C_EXPORT int rtcStopRttProbe(int pc);
+RTC_C_EXPORT int rtcGetRttStats(int pc, rtcRttStats *stats);
 RTC_C_EXPORT int rtcDeleteDataChannel(int dc);
 
 RTC_C_EXPORT int rtcGetDataChannelStream(int dc);
@@ -254,14 +333,30 @@ typedef struct {
 	int pingIntervalMs;      // in milliseconds, 0 means default, < 0 means disabled
 	int maxOutstandingPings; // 0 means default, < 0 means disabled
 	int maxMessageSize;      // <= 0 means default
+	bool autoReconnect;          // reconnect with jittered exponential backoff, queuing messages
+	int reconnectInitialDelayMs; // in milliseconds, <= 0 means default
+	int reconnectMaxDelayMs;     // in milliseconds, <= 0 means default
+	int maxReconnectAttempts;    // <= 0 means unlimited
+	int reconnectBufferSize;     // in bytes, <= 0 means default
 } rtcWsConfiguration;
 
+typedef struct {
+	unsigned int attempts;      // reconnection attempts
+	unsigned int reconnections; // successful reconnections
+	uint64_t droppedMessages;   // messages rejected because the queue was full
+	// In milliseconds, from disconnection to reopening
+	int64_t lastLatencyMs;
+	int64_t maxLatencyMs;
+	int64_t totalLatencyMs;
+} rtcWsReconnectMetrics;
+
 RTC_C_EXPORT int rtcCreateWebSocket(const char *url); // returns ws id
 RTC_C_EXPORT int rtcCreateWebSocketEx(const char *url, const rtcWsConfiguration *config);
 RTC_C_EXPORT int rtcDeleteWebSocket(int ws);
 
 RTC_C_EXPORT int rtcGetWebSocketRemoteAddress(int ws, char *buffer, int size);
 RTC_C_EXPORT int rtcGetWebSocketPath(int ws, char *buffer, int size);
+RTC_C_EXPORT int rtcGetWebSocketReconnectMetrics(int ws, rtcWsReconnectMetrics *metrics);
 
 #endif
 
@@ -269,6 +364,26 @@ RTC_C_EXPORT int rtcGetWebSocketPath(int ws, char *buffer, int size);
 
 RTC_C_EXPORT void rtcPreload(void);
 RTC_C_EXPORT void rtcCleanup(void);
+RTC_C_EXPORT int rtcGetLiveObjectCount(void); // browser objects still registered
+
+// Wasm heap allocated by the JS glue, zero unless built with RTC_ENABLE_HEAP_STATS
+
+typedef enum {
+	RTC_HEAP_MESSAGES = 0,
+	RTC_HEAP_SDP = 1,
+	RTC_HEAP_CANDIDATES = 2,
+	RTC_HEAP_ERRORS = 3,
+	RTC_HEAP_OTHER = 4,
+	RTC_HEAP_TOTAL = -1
+} rtcHeapSource;
+
+typedef struct {
+	uint64_t liveBytes;
+	uint64_t allocations; // cumulative
+	uint64_t peakBytes;
+} rtcHeapStats;
+
+RTC_C_EXPORT int rtcGetHeapStats(rtcHeapSource source, rtcHeapStats *stats);
 
 // SCTP global settings
 
@@ -25,16 +25,13 @@
 
 #include "common.hpp"
 
+#include "certificate.hpp"
 #include "datachannel.hpp"
+#include "global.hpp"
 #include "peerconnection.hpp"
+#include "peerconnectionpool.hpp"
+#include "peergroup.hpp"
+#include "rttprobe.hpp"
 #include "websocket.hpp"
 
-namespace rtc {
-
-// Dummy functions
-inline void Preload() {}
-inline void Cleanup() {}
-
-} // namespace rtc
-
 #endif // RTC_H
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_RTTPROBE_H
+#define RTC_RTTPROBE_H
+
+#include "common.hpp"
+#include "datachannel.hpp"
+#include "peerconnection.hpp"
+
+#include <array>
+#include <chrono>
+
+namespace rtc {
+
+// Application-level round-trip time measurement on the data path. Pings and pongs are exchanged on
+// a dedicated negotiated channel, so both peers must create a probe with the same stream ID. Each
+// side answers the pings of the other and measures its own round trips.
+class RttProbe final {
+public:
+	static const uint16_t DEFAULT_STREAM = 1023;
+
+	struct Stats {
+		uint64_t pingsSent = 0;
+		uint64_t pongsReceived = 0;
+		// Round-trip times in milliseconds
+		optional<double> last;
+		optional<double> smoothed; // EWMA with gain 1/8
+		optional<double> jitter;   // EWMA of the deviation with gain 1/4
+		optional<double> min;
+		optional<double> max;
+	};
+
+	RttProbe(shared_ptr<PeerConnection> peerConnection, uint16_t stream = DEFAULT_STREAM,
+	         std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+	~RttProbe();
+
+	// Not copyable, the channel callbacks point to this probe
+	RttProbe(const RttProbe &) = delete;
+	RttProbe &operator=(const RttProbe &) = delete;
+
+	void setInterval(std::chrono::milliseconds interval);
+
+	Stats stats() const;
+	// Estimated from a histogram with buckets 25% wide, p between 0 and 1
+	optional<double> percentile(double p) const;
+
+private:
+	static const size_t HistogramSize = 64;
+	static constexpr double HistogramBase = 0.1; // lower bound of the second bucket in ms
+	static constexpr double HistogramFactor = 1.25;
+
+	void start();
+	void stop();
+	void ping();
+	void handleMessage(const binary &message);
+	void addSample(double rtt);
+
+	shared_ptr<DataChannel> mDataChannel;
+	std::chrono::milliseconds mInterval;
+	long mIntervalId;
+	Stats mStats;
+	std::array<uint64_t, HistogramSize> mHistogram = {};
+
+	static void PingCallback(void *ptr);
+};
+
+} // namespace rtc
+
+#endif // RTC_RTTPROBE_H
@@ -25,14 +25,31 @@
 
 #include "channel.hpp"
 #include "common.hpp"
+#include "configuration.hpp"
+
 #include <emscripten/websocket.h>
 
+#include <chrono>
+#include <queue>
+
 namespace rtc {
 
 // WebSocket wrapper for emscripten
 class WebSocket final : public Channel {
 public:
+	using Configuration = WebSocketConfiguration;
+
+	struct ReconnectMetrics {
+		unsigned int attempts = 0;      // reconnection attempts
+		unsigned int reconnections = 0; // successful reconnections
+		uint64_t droppedMessages = 0;   // messages rejected because the queue was full
+		std::chrono::milliseconds lastLatency{0}; // from disconnection to reopening
+		std::chrono::milliseconds maxLatency{0};
+		std::chrono::milliseconds totalLatency{0};
+	};
+
 	WebSocket();
+	WebSocket(Configuration config);
 	~WebSocket();
 
 	void open(const string &url);
@@ -42,12 +59,60 @@ public:
 
 	bool isOpen() const override;
 	bool isClosed() const override;
+	size_t bufferedAmount() const override;
+	size_t maxMessageSize() const override;
+
+	void setBufferedAmountLowThreshold(size_t amount) override;
+
+	ReconnectMetrics reconnectMetrics() const;
+
+	// Stop and restart reading incoming messages. With the WebSocketStream backend, the sender is
+	// then slowed down by backpressure. The classic WebSocket API can't pause, so it has no effect.
+	void pauseReading();
+	void resumeReading();
+	bool isReadingPaused() const;
+	bool isStream() const;
 
 private:
 	void triggerOpen() override;
 
+	void connect();
+	void closeSocket();
+	void handleClose();
+	void scheduleReconnect();
+	bool enqueue(message_variant message);
+	void flushQueue();
+	bool sendNow(const message_variant &message);
+	bool sendBinary(const byte *data, size_t size);
+	bool sendText(const string &text);
+
+	// Browsers have no bufferedamountlow event for WebSockets, so the buffered amount is polled
+	// after a send leaves it above the threshold, until it drains back to the threshold.
+	void pollBufferedAmount();
+	void cancelBufferedAmountPoll();
+
+	const Configuration mConfig;
+	string mUrl;
+	string mProtocols;
 	int mId;
+	bool mStream; // mId is a WebSocketStream
 	bool mConnected;
+	bool mReadingPaused;
+	size_t mBufferedAmountLowThreshold;
+	int mBufferedAmountPollTimeout;
+	bool mBufferedAmountWasHigh;
+
+	// While reconnecting, the WebSocket is neither open nor closed and outgoing messages are queued
+	bool mReconnecting;
+	int mReconnectTimeout;
+	unsigned int mReconnectAttempt;
+	double mDisconnectTime;
+	std::queue<message_variant> mQueue;
+	size_t mQueuedBytes;
+	ReconnectMetrics mReconnectMetrics;
+
+	static void BufferedAmountPollCallback(void *userData);
+	static void ReconnectCallback(void *userData);
 
 	static EM_BOOL OpenCallback(int eventType, const EmscriptenWebSocketOpenEvent *websocketEvent,
 	                            void *userData);
@@ -56,6 +121,14 @@ private:
 	static EM_BOOL MessageCallback(int eventType,
 	                               const EmscriptenWebSocketMessageEvent *websocketEvent,
 	                               void *userData);
+	static EM_BOOL CloseCallback(int eventType, const EmscriptenWebSocketCloseEvent *websocketEvent,
+	                             void *userData);
+
+	static void StreamOpenCallback(void *ptr);
+	static void StreamErrorCallback(const char *error, void *ptr);
+	static void StreamMessageCallback(const char *data, int size, void *ptr);
+	static void StreamClosedCallback(void *ptr);
+	static void StreamBufferedAmountLowCallback(void *ptr);
 };
 
 } // namespace rtc
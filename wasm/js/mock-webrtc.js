@@ -0,0 +1,703 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// In-process loopback implementation of RTCPeerConnection and RTCDataChannel, for running the
+// library headless, for instance under Node. It is installed only if the environment does not
+// provide WebRTC. Peers are paired through a session ID carried in the SDP, so descriptions and
+// candidates must still be exchanged by the application. Messages are delivered through the event
+// loop without loss, whatever the reliability parameters.
+
+(function() {
+	if(typeof globalThis.RTCPeerConnection != 'undefined') return;
+
+	var MAX_MESSAGE_SIZE = 262144;
+
+	var schedule = typeof setImmediate == 'function' ? setImmediate : function(fn) {
+		setTimeout(fn, 0);
+	};
+
+	var textEncoder = new TextEncoder();
+
+	var nextSessionId = 1;
+	var sessions = {};
+
+	// Messages in flight for all channels, delivered in order by a single task
+	var messageQueue = [];
+	var messageFlushScheduled = false;
+
+	function domException(name, message) {
+		var err = new Error(message);
+		err.name = name;
+		return err;
+	}
+
+	function randomString(length) {
+		var chars = 'abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789';
+		var str = '';
+		for(var i = 0; i < length; ++i) str += chars[Math.floor(Math.random() * chars.length)];
+		return str;
+	}
+
+	function fingerprint(sessionId) {
+		var bytes = [];
+		for(var i = 0; i < 32; ++i) {
+			var b = (sessionId * 31 + i * 17) & 0xFF;
+			bytes.push((b < 16 ? '0' : '') + b.toString(16).toUpperCase());
+		}
+		return bytes.join(':');
+	}
+
+	function iceUfrag(sdp) {
+		var ufrag = /^a=ice-ufrag:(.*)$/m.exec(sdp);
+		return ufrag ? ufrag[1].trim() : '';
+	}
+
+	function dispatch(target, type, evt) {
+		evt = evt || {};
+		evt.type = type;
+		evt.target = target;
+		var handler = target['on' + type];
+		if(handler) handler.call(target, evt);
+		var listeners = target.mListeners[type];
+		if(listeners) {
+			listeners = listeners.slice();
+			for(var i = 0; i < listeners.length; ++i) listeners[i].call(target, evt);
+		}
+	}
+
+	function EventTargetMixin(proto) {
+		proto.addEventListener = function(type, listener) {
+			var listeners = this.mListeners[type] || (this.mListeners[type] = []);
+			if(listeners.indexOf(listener) < 0) listeners.push(listener);
+		};
+		proto.removeEventListener = function(type, listener) {
+			var listeners = this.mListeners[type];
+			if(!listeners) return;
+			var i = listeners.indexOf(listener);
+			if(i >= 0) listeners.splice(i, 1);
+		};
+	}
+
+	function flushMessages() {
+		messageFlushScheduled = false;
+		// Only deliver what was queued before this task, new sends wait for the next one
+		var queue = messageQueue;
+		messageQueue = [];
+		for(var i = 0; i < queue.length; ++i) {
+			var item = queue[i];
+			var source = item.source;
+			var wasAbove = source.bufferedAmount > source.bufferedAmountLowThreshold;
+			source.bufferedAmount -= item.size;
+			if(wasAbove && source.bufferedAmount <= source.bufferedAmountLowThreshold)
+				dispatch(source, 'bufferedamountlow');
+
+			var sink = item.sink;
+			if(sink.readyState != 'open') continue;
+			sink.mMessagesReceived++;
+			sink.mPeerConnection.mBytesReceived += item.size;
+			var data = item.data;
+			if(typeof data != 'string' && sink.binaryType == 'blob' && typeof Blob != 'undefined')
+				data = new Blob([data]);
+			dispatch(sink, 'message', { data: data });
+		}
+	}
+
+	function RTCSessionDescription(init) {
+		this.type = init.type;
+		this.sdp = init.sdp || '';
+	}
+
+	RTCSessionDescription.prototype.toJSON = function() {
+		return { type: this.type, sdp: this.sdp };
+	};
+
+	function RTCIceCandidate(init) {
+		this.candidate = init.candidate || '';
+		this.sdpMid = init.sdpMid !== undefined ? init.sdpMid : null;
+		this.sdpMLineIndex = init.sdpMLineIndex !== undefined ? init.sdpMLineIndex : null;
+		this.usernameFragment = init.usernameFragment || null;
+	}
+
+	RTCIceCandidate.prototype.toJSON = function() {
+		return {
+			candidate: this.candidate,
+			sdpMid: this.sdpMid,
+			sdpMLineIndex: this.sdpMLineIndex,
+			usernameFragment: this.usernameFragment,
+		};
+	};
+
+	function RTCDataChannel(peerConnection, label, init) {
+		init = init || {};
+		this.mListeners = {};
+		this.mPeerConnection = peerConnection;
+		this.mRemote = null;
+		this.label = label;
+		this.ordered = init.ordered !== undefined ? !!init.ordered : true;
+		this.maxRetransmits = init.maxRetransmits !== undefined ? init.maxRetransmits : null;
+		this.maxPacketLifeTime = init.maxPacketLifeTime !== undefined ? init.maxPacketLifeTime : null;
+		this.protocol = init.protocol || '';
+		this.negotiated = !!init.negotiated;
+		this.id = init.id !== undefined ? init.id : null;
+		this.readyState = 'connecting';
+		this.bufferedAmount = 0;
+		this.bufferedAmountLowThreshold = 0;
+		this.binaryType = 'blob';
+		this.mMessagesSent = 0;
+		this.mMessagesReceived = 0;
+		this.onopen = null;
+		this.onmessage = null;
+		this.onerror = null;
+		this.onclose = null;
+		this.onclosing = null;
+		this.onbufferedamountlow = null;
+	}
+
+	EventTargetMixin(RTCDataChannel.prototype);
+
+	RTCDataChannel.prototype.send = function(data) {
+		if(this.readyState != 'open') throw domException('InvalidStateError', 'DataChannel is not open');
+
+		var payload, size;
+		if(typeof data == 'string') {
+			payload = data;
+			size = textEncoder.encode(data).length;
+		} else if(data instanceof ArrayBuffer) {
+			payload = data.slice(0);
+			size = payload.byteLength;
+		} else if(ArrayBuffer.isView(data)) {
+			// Copy since the view might be on memory that is reused after the call, like the heap
+			payload = data.buffer.slice(data.byteOffset, data.byteOffset + data.byteLength);
+			size = payload.byteLength;
+		} else {
+			throw new TypeError('Unsupported message type');
+		}
+
+		if(size > MAX_MESSAGE_SIZE) throw new TypeError('Message size exceeds the maximum');
+
+		this.bufferedAmount += size;
+		this.mMessagesSent++;
+		this.mPeerConnection.mBytesSent += size;
+		messageQueue.push({ source: this, sink: this.mRemote, data: payload, size: size });
+		if(!messageFlushScheduled) {
+			messageFlushScheduled = true;
+			schedule(flushMessages);
+		}
+	};
+
+	RTCDataChannel.prototype.close = function() {
+		if(this.readyState == 'closing' || this.readyState == 'closed') return;
+		var remote = this.mRemote;
+		this.readyState = 'closing';
+		if(remote && remote.readyState == 'open') remote.readyState = 'closing';
+		var self = this;
+		schedule(function() {
+			self.mPeerConnection.releaseChannel(self);
+			self.closed();
+			if(remote) {
+				remote.mPeerConnection.releaseChannel(remote);
+				remote.closed();
+			}
+		});
+	};
+
+	RTCDataChannel.prototype.open = function() {
+		if(this.readyState != 'connecting') return;
+		this.readyState = 'open';
+		dispatch(this, 'open');
+	};
+
+	RTCDataChannel.prototype.closed = function() {
+		if(this.readyState == 'closed') return;
+		this.readyState = 'closed';
+		dispatch(this, 'close');
+	};
+
+	function RTCPeerConnection(config) {
+		this.mListeners = {};
+		this.mConfig = config || {};
+		this.mSessionId = nextSessionId++;
+		this.mRemote = null;
+		this.mConnectedUfrag = null; // remote ICE ufrag the pair was selected with
+		this.mRemoteSessionId = 0;
+		this.mRemoteCandidates = 0;
+		this.mChannels = [];
+		this.mNegotiated = false; // the application m-line has been negotiated
+		this.mIsDtlsClient = null; // the answerer is the client, fixed by the first negotiation
+		this.mIceUfrag = randomString(4);
+		this.mIcePwd = randomString(24);
+		this.mGatheredUfrag = null;
+		this.mCandidates = [];
+		this.mPendingLocal = null;
+		this.mNegotiationNeeded = false;
+		this.mIceRestartPending = false;
+		this.mNegotiationNeededScheduled = false;
+		this.mBytesSent = 0;
+		this.mBytesReceived = 0;
+
+		this.localDescription = null;
+		this.remoteDescription = null;
+		this.signalingState = 'stable';
+		this.iceGatheringState = 'new';
+		this.iceConnectionState = 'new';
+		this.connectionState = 'new';
+
+		this.onnegotiationneeded = null;
+		this.onicecandidate = null;
+		this.onicegatheringstatechange = null;
+		this.oniceconnectionstatechange = null;
+		this.onconnectionstatechange = null;
+		this.onsignalingstatechange = null;
+		this.ondatachannel = null;
+
+		sessions[this.mSessionId] = this;
+	}
+
+	EventTargetMixin(RTCPeerConnection.prototype);
+
+	RTCPeerConnection.generateCertificate = function(keygenAlgorithm) {
+		return Promise.resolve({
+			expires: Date.now() + 30 * 24 * 3600 * 1000,
+			getFingerprints: function() {
+				return [{ algorithm: 'sha-256', value: fingerprint(0) }];
+			},
+		});
+	};
+
+	RTCPeerConnection.prototype.getConfiguration = function() {
+		return this.mConfig;
+	};
+
+	RTCPeerConnection.prototype.createDataChannel = function(label, init) {
+		if(this.signalingState == 'closed')
+			throw domException('InvalidStateError', 'PeerConnection is closed');
+		init = init || {};
+		if(init.maxRetransmits !== undefined && init.maxPacketLifeTime !== undefined)
+			throw new TypeError('maxRetransmits and maxPacketLifeTime are mutually exclusive');
+		if(init.negotiated && init.id === undefined)
+			throw new TypeError('Negotiated DataChannel requires an id');
+		if(init.id !== undefined && (init.id < 0 || init.id > 65534))
+			throw new TypeError('Invalid DataChannel id');
+
+		var channel = new RTCDataChannel(this, label, init);
+		this.mChannels.push(channel);
+		if(!this.mNegotiated) this.negotiationNeeded();
+		else if(this.isAssociated()) this.linkChannels();
+		return channel;
+	};
+
+	RTCPeerConnection.prototype.createOffer = function(options) {
+		if(this.signalingState == 'closed')
+			return Promise.reject(domException('InvalidStateError', 'PeerConnection is closed'));
+		if(options && options.iceRestart) this.restartCredentials();
+		return Promise.resolve(new RTCSessionDescription({ type: 'offer', sdp: this.buildSdp('actpass') }));
+	};
+
+	RTCPeerConnection.prototype.createAnswer = function() {
+		if(this.signalingState != 'have-remote-offer' && this.signalingState != 'have-local-pranswer')
+			return Promise.reject(domException('InvalidStateError', 'No remote offer'));
+		return Promise.resolve(new RTCSessionDescription({ type: 'answer', sdp: this.buildSdp('active') }));
+	};
+
+	RTCPeerConnection.prototype.setLocalDescription = function(description) {
+		var self = this;
+		if(!description || !description.type) {
+			var implicit = this.signalingState == 'have-remote-offer' ? this.createAnswer() : this.createOffer();
+			return implicit.then(function(desc) {
+				return self.setLocalDescription(desc);
+			});
+		}
+
+		var type = description.type;
+		var state = this.signalingState;
+		var next;
+		if(type == 'offer' && (state == 'stable' || state == 'have-local-offer')) next = 'have-local-offer';
+		else if(type == 'answer' && (state == 'have-remote-offer' || state == 'have-local-pranswer')) next = 'stable';
+		else if(type == 'pranswer' && (state == 'have-remote-offer' || state == 'have-local-pranswer')) next = 'have-local-pranswer';
+		else if(type == 'rollback' && state == 'have-local-offer') next = 'stable';
+		else return Promise.reject(domException('InvalidStateError', 'Cannot set local ' + type + ' in state ' + state));
+
+		return Promise.resolve().then(function() {
+			if(type == 'rollback') {
+				self.localDescription = self.mPendingLocal;
+			} else {
+				var ufrag = /^a=ice-ufrag:(.*)$/m.exec(description.sdp);
+				var pwd = /^a=ice-pwd:(.*)$/m.exec(description.sdp);
+				if(ufrag) self.mIceUfrag = ufrag[1].trim();
+				if(pwd) self.mIcePwd = pwd[1].trim();
+				if(type == 'offer') {
+					self.mPendingLocal = self.localDescription;
+					self.mNegotiationNeeded = false;
+					self.mIceRestartPending = false;
+				}
+				self.localDescription = new RTCSessionDescription({ type: type, sdp: description.sdp });
+			}
+			self.setSignalingState(next);
+			if(type != 'rollback') self.gather();
+			if(next == 'stable') self.completeNegotiation();
+		});
+	};
+
+	RTCPeerConnection.prototype.setRemoteDescription = function(description) {
+		var self = this;
+		var type = description.type;
+		var state = this.signalingState;
+		var next;
+		if(type == 'offer' && (state == 'stable' || state == 'have-remote-offer')) next = 'have-remote-offer';
+		else if(type == 'answer' && (state == 'have-local-offer' || state == 'have-remote-pranswer')) next = 'stable';
+		else if(type == 'pranswer' && (state == 'have-local-offer' || state == 'have-remote-pranswer')) next = 'have-remote-pranswer';
+		else if(type == 'rollback' && state == 'have-remote-offer') next = 'stable';
+		else return Promise.reject(domException('InvalidStateError', 'Cannot set remote ' + type + ' in state ' + state));
+
+		return Promise.resolve().then(function() {
+			if(type != 'rollback') {
+				var session = /^a=x-mock-session:(\d+)$/m.exec(description.sdp);
+				if(!session) throw domException('OperationError', 'Remote description is not from a mock peer');
+				var sessionId = parseInt(session[1]);
+				if(self.mRemoteSessionId && self.mRemoteSessionId != sessionId)
+					throw domException('InvalidAccessError', 'Remote peer changed');
+				self.mRemoteSessionId = sessionId;
+				self.mRemoteCandidates += (description.sdp.match(/^a=candidate:/gm) || []).length;
+				// The answer to an offer restarting ICE has new credentials too
+				if(type == 'offer' && self.remoteDescription &&
+				   iceUfrag(description.sdp) != iceUfrag(self.remoteDescription.sdp))
+					self.restartCredentials();
+				self.remoteDescription = new RTCSessionDescription({ type: type, sdp: description.sdp });
+			}
+			self.setSignalingState(next);
+			if(next == 'stable' && type != 'rollback') self.completeNegotiation();
+		});
+	};
+
+	RTCPeerConnection.prototype.addIceCandidate = function(candidate) {
+		var self = this;
+		if(!this.remoteDescription)
+			return Promise.reject(domException('InvalidStateError', 'No remote description'));
+		return Promise.resolve().then(function() {
+			if(!candidate || !candidate.candidate) return; // end of candidates
+			self.mRemoteCandidates++;
+			self.tryConnect();
+		});
+	};
+
+	RTCPeerConnection.prototype.restartIce = function() {
+		this.restartCredentials();
+		this.mIceRestartPending = true;
+		this.negotiationNeeded();
+	};
+
+	RTCPeerConnection.prototype.getStats = function() {
+		var report = new Map();
+		var now = performance.now();
+		var remote = this.mRemote;
+		if(remote) {
+			var local = { id: 'L1', type: 'local-candidate', timestamp: now, address: '127.0.0.1',
+			              port: 10000 + this.mSessionId, protocol: 'udp', candidateType: 'host',
+			              priority: 2122260223, foundation: '1' };
+			var peer = { id: 'R1', type: 'remote-candidate', timestamp: now, address: '127.0.0.1',
+			             port: 10000 + remote.mSessionId, protocol: 'udp', candidateType: 'host',
+			             priority: 2122260223, foundation: '1' };
+			report.set(local.id, local);
+			report.set(peer.id, peer);
+			report.set('CP1', { id: 'CP1', type: 'candidate-pair', timestamp: now, state: 'succeeded',
+			                    nominated: true, selected: true, localCandidateId: 'L1',
+			                    remoteCandidateId: 'R1', currentRoundTripTime: 0,
+			                    bytesSent: this.mBytesSent, bytesReceived: this.mBytesReceived });
+			report.set('T1', { id: 'T1', type: 'transport', timestamp: now,
+			                   selectedCandidatePairId: 'CP1' });
+		}
+		for(var i = 0; i < this.mChannels.length; ++i) {
+			var channel = this.mChannels[i];
+			report.set('D' + i, { id: 'D' + i, type: 'data-channel', timestamp: now, label: channel.label,
+			                      dataChannelIdentifier: channel.id, state: channel.readyState,
+			                      messagesSent: channel.mMessagesSent,
+			                      messagesReceived: channel.mMessagesReceived });
+		}
+		return Promise.resolve(report);
+	};
+
+	RTCPeerConnection.prototype.close = function() {
+		if(this.signalingState == 'closed') return;
+		// As specified, closing the connection fires no events locally
+		this.signalingState = 'closed';
+		this.iceConnectionState = 'closed';
+		this.connectionState = 'closed';
+		var channels = this.mChannels;
+		this.mChannels = [];
+		for(var i = 0; i < channels.length; ++i) channels[i].readyState = 'closed';
+		delete sessions[this.mSessionId];
+
+		var remote = this.mRemote;
+		this.mRemote = null;
+		if(remote && remote.signalingState != 'closed') {
+			schedule(function() {
+				remote.disconnected(channels);
+			});
+		}
+	};
+
+	// Internal methods
+
+	RTCPeerConnection.prototype.setSignalingState = function(state) {
+		if(this.signalingState == state) return;
+		this.signalingState = state;
+		dispatch(this, 'signalingstatechange');
+		if(state == 'stable' && this.mNegotiationNeeded) this.negotiationNeeded();
+	};
+
+	RTCPeerConnection.prototype.setGatheringState = function(state) {
+		if(this.iceGatheringState == state) return;
+		this.iceGatheringState = state;
+		dispatch(this, 'icegatheringstatechange');
+	};
+
+	RTCPeerConnection.prototype.setConnectionStates = function(iceState, state) {
+		if(this.iceConnectionState != iceState) {
+			this.iceConnectionState = iceState;
+			dispatch(this, 'iceconnectionstatechange');
+		}
+		if(this.connectionState != state) {
+			this.connectionState = state;
+			dispatch(this, 'connectionstatechange');
+		}
+	};
+
+	RTCPeerConnection.prototype.negotiationNeeded = function() {
+		this.mNegotiationNeeded = true;
+		if(this.mNegotiationNeededScheduled) return;
+		this.mNegotiationNeededScheduled = true;
+		var self = this;
+		schedule(function() {
+			self.mNegotiationNeededScheduled = false;
+			// Like in browsers, the event is delayed until the signaling state is stable
+			if(self.mNegotiationNeeded && self.signalingState == 'stable') dispatch(self, 'negotiationneeded');
+		});
+	};
+
+	RTCPeerConnection.prototype.restartCredentials = function() {
+		this.mIceUfrag = randomString(4);
+		this.mIcePwd = randomString(24);
+	};
+
+	RTCPeerConnection.prototype.buildSdp = function(setup) {
+		var lines = [
+			'v=0',
+			'o=- ' + this.mSessionId + ' 2 IN IP4 127.0.0.1',
+			's=-',
+			't=0 0',
+			'a=group:BUNDLE 0',
+			'a=x-mock-session:' + this.mSessionId,
+			'm=application 9 UDP/DTLS/SCTP webrtc-datachannel',
+			'c=IN IP4 0.0.0.0',
+			'a=mid:0',
+			'a=ice-ufrag:' + this.mIceUfrag,
+			'a=ice-pwd:' + this.mIcePwd,
+			'a=ice-options:trickle',
+			'a=fingerprint:sha-256 ' + fingerprint(this.mSessionId),
+			'a=setup:' + setup,
+			'a=sctp-port:5000',
+			'a=max-message-size:' + MAX_MESSAGE_SIZE,
+		];
+		if(this.mGatheredUfrag == this.mIceUfrag) {
+			for(var i = 0; i < this.mCandidates.length; ++i) lines.push('a=' + this.mCandidates[i]);
+			if(this.iceGatheringState == 'complete') lines.push('a=end-of-candidates');
+		}
+		return lines.join('\r\n') + '\r\n';
+	};
+
+	RTCPeerConnection.prototype.gather = function() {
+		if(this.mGatheredUfrag == this.mIceUfrag) return;
+		this.mGatheredUfrag = this.mIceUfrag;
+		this.mCandidates = [];
+		var self = this;
+		schedule(function() {
+			if(self.signalingState == 'closed') return;
+			self.setGatheringState('gathering');
+			var candidate = 'candidate:1 1 udp 2122260223 127.0.0.1 ' + (10000 + self.mSessionId) +
+			                ' typ host';
+			self.mCandidates.push(candidate);
+			dispatch(self, 'icecandidate', {
+				candidate: new RTCIceCandidate({
+					candidate: candidate,
+					sdpMid: '0',
+					sdpMLineIndex: 0,
+					usernameFragment: self.mIceUfrag,
+				}),
+			});
+			schedule(function() {
+				if(self.signalingState == 'closed') return;
+				self.setGatheringState('complete');
+				// The local description now embeds the candidates, like in browsers
+				if(self.localDescription) {
+					self.localDescription = new RTCSessionDescription({
+						type: self.localDescription.type,
+						sdp: self.buildSdp(/^a=setup:(.*)$/m.exec(self.localDescription.sdp)[1].trim()),
+					});
+				}
+				dispatch(self, 'icecandidate', { candidate: null });
+			});
+		});
+	};
+
+	RTCPeerConnection.prototype.completeNegotiation = function() {
+		if(!this.localDescription || !this.remoteDescription) return;
+		this.mNegotiated = true;
+		if(this.mIsDtlsClient === null) this.mIsDtlsClient = this.localDescription.type == 'answer';
+		// An answer negotiates the application m-line too, but not an ICE restart
+		if(!this.mIceRestartPending) this.mNegotiationNeeded = false;
+		if(this.mRemote && iceUfrag(this.remoteDescription.sdp) != this.mConnectedUfrag) {
+			// ICE restart while connected: check the new credentials, like Firefox does
+			var self = this;
+			this.setConnectionStates('checking', 'connected');
+			schedule(function() {
+				if(self.mRemote && self.signalingState != 'closed') self.selectPair();
+			});
+			return;
+		}
+		this.tryConnect();
+	};
+
+	RTCPeerConnection.prototype.selectPair = function() {
+		this.mConnectedUfrag = iceUfrag(this.remoteDescription.sdp);
+		this.setConnectionStates('connected', 'connected');
+	};
+
+	RTCPeerConnection.prototype.tryConnect = function() {
+		if(this.mRemote || this.signalingState == 'closed') return;
+		if(!this.mNegotiated || this.mRemoteCandidates == 0) return;
+		var remote = sessions[this.mRemoteSessionId];
+		if(!remote || remote.mRemoteSessionId != this.mSessionId) return;
+
+		this.mRemote = remote;
+		var self = this;
+		this.setConnectionStates('checking', 'connecting');
+		remote.tryConnect(); // in case it was waiting for this side
+		schedule(function() {
+			if(self.signalingState == 'closed') return;
+			self.selectPair();
+			if(self.isAssociated()) {
+				self.linkChannels();
+				remote.linkChannels();
+			}
+		});
+	};
+
+	RTCPeerConnection.prototype.isAssociated = function() {
+		var remote = this.mRemote;
+		return !!remote && this.connectionState == 'connected' && remote.mRemote == this &&
+		       remote.connectionState == 'connected';
+	};
+
+	RTCPeerConnection.prototype.linkChannels = function() {
+		var remote = this.mRemote;
+		var announced = [];
+		for(var i = 0; i < this.mChannels.length; ++i) {
+			var channel = this.mChannels[i];
+			if(channel.mRemote || channel.readyState != 'connecting') continue;
+
+			if(channel.negotiated) {
+				var match = remote.findNegotiatedChannel(channel.id);
+				if(!match) continue; // wait for the remote side to create it
+				channel.mRemote = match;
+				match.mRemote = channel;
+				schedule(channel.open.bind(channel));
+				schedule(match.open.bind(match));
+				continue;
+			}
+
+			// The DTLS client uses even stream IDs and the server odd ones
+			if(channel.id === null) channel.id = this.allocateStreamId();
+			var incoming = new RTCDataChannel(remote, channel.label, {
+				ordered: channel.ordered,
+				maxRetransmits: channel.maxRetransmits !== null ? channel.maxRetransmits : undefined,
+				maxPacketLifeTime: channel.maxPacketLifeTime !== null ? channel.maxPacketLifeTime : undefined,
+				protocol: channel.protocol,
+				id: channel.id,
+			});
+			channel.mRemote = incoming;
+			incoming.mRemote = channel;
+			remote.mChannels.push(incoming);
+			announced.push(incoming);
+			schedule(channel.open.bind(channel));
+		}
+
+		if(announced.length) {
+			schedule(function() {
+				for(var i = 0; i < announced.length; ++i) {
+					var incoming = announced[i];
+					if(remote.signalingState == 'closed') return;
+					dispatch(remote, 'datachannel', { channel: incoming });
+					incoming.open();
+				}
+			});
+		}
+	};
+
+	RTCPeerConnection.prototype.findNegotiatedChannel = function(id) {
+		for(var i = 0; i < this.mChannels.length; ++i) {
+			var channel = this.mChannels[i];
+			if(channel.negotiated && channel.id == id && !channel.mRemote &&
+			   channel.readyState == 'connecting')
+				return channel;
+		}
+		return null;
+	};
+
+	RTCPeerConnection.prototype.allocateStreamId = function() {
+		var used = {};
+		var lists = [this.mChannels, this.mRemote ? this.mRemote.mChannels : []];
+		for(var l = 0; l < lists.length; ++l)
+			for(var i = 0; i < lists[l].length; ++i)
+				if(lists[l][i].id !== null) used[lists[l][i].id] = true;
+		var id = this.mIsDtlsClient ? 0 : 1;
+		while(used[id]) id += 2;
+		return id;
+	};
+
+	RTCPeerConnection.prototype.releaseChannel = function(channel) {
+		var i = this.mChannels.indexOf(channel);
+		if(i >= 0) this.mChannels.splice(i, 1);
+	};
+
+	RTCPeerConnection.prototype.disconnected = function(remoteChannels) {
+		if(this.signalingState == 'closed') return;
+		this.mRemote = null;
+		for(var i = 0; i < remoteChannels.length; ++i) {
+			var channel = remoteChannels[i].mRemote;
+			if(channel) {
+				this.releaseChannel(channel);
+				channel.closed();
+			}
+		}
+		this.setConnectionStates('disconnected', 'disconnected');
+		var self = this;
+		schedule(function() {
+			if(self.signalingState == 'closed') return;
+			self.setConnectionStates('failed', 'failed');
+		});
+	};
+
+	globalThis.RTCPeerConnection = RTCPeerConnection;
+	globalThis.RTCDataChannel = RTCDataChannel;
+	globalThis.RTCSessionDescription = RTCSessionDescription;
+	globalThis.RTCIceCandidate = RTCIceCandidate;
+})();
@@ -25,30 +25,140 @@
 		$WEBRTC: {
 			peerConnectionsMap: {},
 			dataChannelsMap: {},
+			webSocketStreamsMap: {},
+			certificatesMap: {},
+			certificateCache: {},
 			nextId: 1,
 
-			allocUTF8FromString: function(str) {
-				var strLen = lengthBytesUTF8(str);
-				var strOnHeap = _malloc(strLen+1);
-				stringToUTF8(str, strOnHeap, strLen+1);
+			// Accounting of the heap allocated by the glue, by source
+			HEAP_MESSAGES: 0,
+			HEAP_SDP: 1,
+			HEAP_CANDIDATES: 2,
+			HEAP_ERRORS: 3,
+			HEAP_OTHER: 4,
+			heapSourceNames: ['messages', 'sdp', 'candidates', 'errors', 'other'],
+#if RTC_HEAP_STATS
+			heapLive: [0, 0, 0, 0, 0],
+			heapAllocations: [0, 0, 0, 0, 0],
+			heapPeak: [0, 0, 0, 0, 0],
+			heapTotalLive: 0,
+			heapTotalPeak: 0,
+			// Size and source of the buffers freed by C++ with js_rtcFree, packed as size * 8 + source.
+			// Buffers freed by the glue are accounted with the size known at the call site instead.
+			heapEntries: {},
+
+			recordMalloc: function(size, source) {
+				WEBRTC.heapAllocations[source]++;
+				WEBRTC.heapLive[source] += size;
+				if(WEBRTC.heapLive[source] > WEBRTC.heapPeak[source])
+					WEBRTC.heapPeak[source] = WEBRTC.heapLive[source];
+				WEBRTC.heapTotalLive += size;
+				if(WEBRTC.heapTotalLive > WEBRTC.heapTotalPeak)
+					WEBRTC.heapTotalPeak = WEBRTC.heapTotalLive;
+			},
+
+			recordFree: function(size, source) {
+				WEBRTC.heapLive[source] -= size;
+				WEBRTC.heapTotalLive -= size;
+			},
+
+#endif
+
+#if RTC_TRACE
+			// Trace entries are emitted through the User Timing API, the application is
+			// responsible for collecting and clearing them
+			traceMeasure: function(name, start) {
+				performance.measure('rtc:' + name, { start: start, end: performance.now() });
+			},
+
+			traceMalloc: function(source, size) {
+				var name = WEBRTC.heapSourceNames[source];
+				performance.mark('rtc:malloc', { detail: { source: name, size: size } });
+			},
+
+#endif
+			// Buffers freed by the glue in the same scope are released with the size and source they
+			// were allocated with
+			malloc: function(size, source) {
+				var ptr = _malloc(size);
+				if(!ptr) return 0;
+#if RTC_HEAP_STATS
+				WEBRTC.recordMalloc(size, source);
+#endif
+#if RTC_TRACE
+				WEBRTC.traceMalloc(source, size);
+#endif
+				return ptr;
+			},
+
+			free: function(ptr, size, source) {
+				if(!ptr) return;
+#if RTC_HEAP_STATS
+				WEBRTC.recordFree(size, source);
+#endif
+				_free(ptr);
+			},
+
+			// The size must be lengthBytesUTF8(str) + 1
+			allocUTF8: function(str, size, source) {
+				var strOnHeap = WEBRTC.malloc(size, source);
+				if(strOnHeap) stringToUTF8(str, strOnHeap, size);
+				return strOnHeap;
+			},
+
+			// For strings whose ownership moves to C++, which frees them with js_rtcFree
+			allocUTF8FromString: function(str, source) {
+				var size = lengthBytesUTF8(str) + 1;
+				var strOnHeap = WEBRTC.allocUTF8(str, size, source);
+#if RTC_HEAP_STATS
+				if(strOnHeap) WEBRTC.heapEntries[strOnHeap] = size * 8 + source;
+#endif
 				return strOnHeap;
 			},
 
+			generateCertificate: function(type) {
+				var keygenAlgorithm = type == 2 ? {
+					name: 'RSASSA-PKCS1-v1_5',
+					modulusLength: 2048,
+					publicExponent: new Uint8Array([1, 0, 1]),
+					hash: 'SHA-256',
+				} : {
+					name: 'ECDSA',
+					namedCurve: 'P-256',
+				};
+				var entry = {
+					certificate: null,
+				};
+				RTCPeerConnection.generateCertificate(keygenAlgorithm)
+					.then(function(certificate) {
+						entry.certificate = certificate;
+					})
+					.catch(function(err) {
+						entry.failed = true;
+						console.error(err);
+					});
+				return entry;
+			},
+
+			readyCertificate: function(entry) {
+				if(!entry || !entry.certificate) return null;
+				var expires = entry.certificate.expires;
+				if(expires && expires <= Date.now()) return null;
+				return entry.certificate;
+			},
+
 			registerPeerConnection: function(peerConnection) {
 				var pc = WEBRTC.nextId++;
 				WEBRTC.peerConnectionsMap[pc] = peerConnection;
 				peerConnection.onnegotiationneeded = function() {
-					peerConnection.createOffer()
-						.then(function(offer) {
-							return WEBRTC.handleDescription(peerConnection, offer);
-						})
-						.catch(function(err) {
-							console.error(err);
-						});
+					peerConnection.rtcNegotiationNeeded = true;
+					if(peerConnection.rtcAutoNegotiation) WEBRTC.scheduleNegotiation(peerConnection);
 				};
 				peerConnection.onicecandidate = function(evt) {
 					if(evt.candidate && evt.candidate.candidate)
 					  WEBRTC.handleCandidate(peerConnection, evt.candidate);
+					else if(!evt.candidate)
+					  WEBRTC.handleGatheringComplete(peerConnection);
 				};
 				peerConnection.onconnectionstatechange = function() {
 					WEBRTC.handleConnectionStateChange(peerConnection, peerConnection.connectionState)
@@ -65,39 +175,474 @@
 				return pc;
 			},
 
-			registerDataChannel: function(dataChannel) {
+			registerDataChannel: function(dataChannel, peerConnection) {
 				var dc = WEBRTC.nextId++;
 				WEBRTC.dataChannelsMap[dc] = dataChannel;
 				dataChannel.binaryType = 'arraybuffer';
+				// Track channels per connection so that closing it tears them down
+				dataChannel.rtcPeerConnection = peerConnection;
+				peerConnection.rtcDataChannels[dc] = true;
 				return dc;
 			},
 
+			unregisterDataChannel: function(dc) {
+				var dataChannel = WEBRTC.dataChannelsMap[dc];
+				if(!dataChannel) return;
+				dataChannel.rtcUserDeleted = true;
+				// Drop handlers so closures don't keep the channel and user pointers alive
+				dataChannel.onopen = null;
+				dataChannel.onerror = null;
+				dataChannel.onmessage = null;
+				dataChannel.onclose = null;
+				dataChannel.onbufferedamountlow = null;
+				if(dataChannel.readyState != 'closed') dataChannel.close();
+				if(dataChannel.rtcPeerConnection) {
+					delete dataChannel.rtcPeerConnection.rtcDataChannels[dc];
+					dataChannel.rtcPeerConnection = null;
+				}
+				delete WEBRTC.dataChannelsMap[dc];
+			},
+
+			closePeerConnection: function(peerConnection) {
+				if(peerConnection.rtcNegotiationTimeout) clearTimeout(peerConnection.rtcNegotiationTimeout);
+				if(peerConnection.rtcStatsInterval) clearInterval(peerConnection.rtcStatsInterval);
+				if(peerConnection.rtcCandidateTimeout) clearTimeout(peerConnection.rtcCandidateTimeout);
+				if(peerConnection.rtcGatheringTimeout) clearTimeout(peerConnection.rtcGatheringTimeout);
+				peerConnection.rtcNegotiationTimeout = null;
+				peerConnection.rtcStatsInterval = null;
+				peerConnection.rtcCandidateTimeout = null;
+				peerConnection.rtcGatheringTimeout = null;
+				peerConnection.rtcCandidateQueue = [];
+				peerConnection.onnegotiationneeded = null;
+				peerConnection.onicecandidate = null;
+				peerConnection.onconnectionstatechange = null;
+				peerConnection.oniceconnectionstatechange = null;
+				peerConnection.onicegatheringstatechange = null;
+				peerConnection.onsignalingstatechange = null;
+				peerConnection.ondatachannel = null;
+				if(peerConnection.rtcIceTransport) {
+					peerConnection.rtcIceTransport.onselectedcandidatepairchange = null;
+					peerConnection.rtcIceTransport = null;
+				}
+				peerConnection.close();
+				// Browsers don't fire close events on channels when the connection is closed, so
+				// notify them here, then unregister them in case the user did not delete them
+				var channels = Object.keys(peerConnection.rtcDataChannels);
+				for(var i = 0; i < channels.length; ++i) {
+					var dataChannel = WEBRTC.dataChannelsMap[channels[i]];
+					if(dataChannel && !dataChannel.rtcUserDeleted && dataChannel.onclose)
+						dataChannel.onclose();
+					WEBRTC.unregisterDataChannel(channels[i]);
+				}
+			},
+
+			readWebSocketStream: function(webSocket) {
+				if(webSocket.rtcUserDeleted || webSocket.rtcPaused || webSocket.rtcReading) return;
+				webSocket.rtcReading = true;
+				webSocket.rtcReader.read()
+					.then(function(result) {
+						webSocket.rtcReading = false;
+						if(webSocket.rtcUserDeleted || result.done) return;
+						var messageCallback = webSocket.rtcMessageCallback;
+						var userPointer = webSocket.rtcUserPointer || 0;
+						if(typeof result.value == 'string') {
+							var strSize = lengthBytesUTF8(result.value) + 1;
+							var pStr = WEBRTC.allocUTF8(result.value, strSize, WEBRTC.HEAP_MESSAGES);
+#if RTC_TRACE
+							var traceStart = performance.now();
+#endif
+							{{{ makeDynCall('viii', 'messageCallback') }}} (pStr, -1, userPointer);
+#if RTC_TRACE
+							WEBRTC.traceMeasure('messageCallback', traceStart);
+#endif
+							WEBRTC.free(pStr, strSize, WEBRTC.HEAP_MESSAGES);
+						} else {
+							var byteArray = new Uint8Array(result.value);
+							var size = byteArray.length;
+							var pBuffer = WEBRTC.malloc(size, WEBRTC.HEAP_MESSAGES);
+							var heapBytes = new Uint8Array(Module['HEAPU8'].buffer, pBuffer, size);
+							heapBytes.set(byteArray);
+#if RTC_TRACE
+							var traceStart = performance.now();
+#endif
+							{{{ makeDynCall('viii', 'messageCallback') }}} (pBuffer, size, userPointer);
+#if RTC_TRACE
+							WEBRTC.traceMeasure('messageCallback', traceStart);
+#endif
+							WEBRTC.free(pBuffer, size, WEBRTC.HEAP_MESSAGES);
+						}
+						// Reading is not resumed while the receiver is paused, so the stream applies
+						// backpressure to the sender instead of buffering in memory
+						WEBRTC.readWebSocketStream(webSocket);
+					})
+					.catch(function(err) {
+						webSocket.rtcReading = false;
+						// The stream can't be read anymore, so it is dead even if closed does not settle
+						WEBRTC.handleWebSocketStreamError(webSocket, err);
+						try {
+							webSocket.rtcStream.close();
+						} catch(e) {}
+						WEBRTC.handleWebSocketStreamClosed(webSocket);
+					});
+			},
+
+			// Each failure is reported exactly once, followed by a single close notification
+			handleWebSocketStreamError: function(webSocket, err) {
+				if(webSocket.rtcUserDeleted || webSocket.rtcErrorReported || webSocket.rtcClosedReported)
+					return;
+				webSocket.rtcErrorReported = true;
+				var errorCallback = webSocket.rtcErrorCallback;
+				var error = String(err && err.message ? err.message : err);
+				var errorSize = lengthBytesUTF8(error) + 1;
+				var pError = WEBRTC.allocUTF8(error, errorSize, WEBRTC.HEAP_ERRORS);
+#if RTC_TRACE
+				var traceStart = performance.now();
+#endif
+				{{{ makeDynCall('vii', 'errorCallback') }}} (pError, webSocket.rtcUserPointer || 0);
+#if RTC_TRACE
+				WEBRTC.traceMeasure('errorCallback', traceStart);
+#endif
+				WEBRTC.free(pError, errorSize, WEBRTC.HEAP_ERRORS);
+			},
+
+			handleWebSocketStreamClosed: function(webSocket) {
+				if(webSocket.rtcUserDeleted || webSocket.rtcClosedReported) return;
+				webSocket.rtcClosedReported = true;
+				var closedCallback = webSocket.rtcClosedCallback;
+#if RTC_TRACE
+				var traceStart = performance.now();
+#endif
+				{{{ makeDynCall('vi', 'closedCallback') }}} (webSocket.rtcUserPointer || 0);
+#if RTC_TRACE
+				WEBRTC.traceMeasure('closedCallback', traceStart);
+#endif
+			},
+
+			setOpenCallback: function(dataChannel, openCallback) {
+				var cb = function() {
+					if(dataChannel.rtcUserDeleted) return;
+					var userPointer = dataChannel.rtcUserPointer || 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
+					{{{ makeDynCall('vi', 'openCallback') }}} (userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('openCallback', traceStart);
+#endif
+				};
+				dataChannel.onopen = cb;
+				if(dataChannel.readyState == 'open') setTimeout(cb, 0);
+			},
+
+			setErrorCallback: function(dataChannel, errorCallback) {
+				var cb = function(evt) {
+					if(dataChannel.rtcUserDeleted) return;
+					var userPointer = dataChannel.rtcUserPointer || 0;
+					var errorSize = evt.message ? lengthBytesUTF8(evt.message) + 1 : 0;
+					var pError = evt.message ? WEBRTC.allocUTF8(evt.message, errorSize, WEBRTC.HEAP_ERRORS) : 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
+					{{{ makeDynCall('vii', 'errorCallback') }}} (pError, userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('errorCallback', traceStart);
+#endif
+					WEBRTC.free(pError, errorSize, WEBRTC.HEAP_ERRORS);
+				};
+				dataChannel.onerror = cb;
+			},
+
+			setMessageCallback: function(dataChannel, messageCallback) {
+				dataChannel.onmessage = function(evt) {
+					if(dataChannel.rtcUserDeleted) return;
+					var userPointer = dataChannel.rtcUserPointer || 0;
+					if(typeof evt.data == 'string') {
+						var strSize = lengthBytesUTF8(evt.data) + 1;
+						var pStr = WEBRTC.allocUTF8(evt.data, strSize, WEBRTC.HEAP_MESSAGES);
+#if RTC_TRACE
+						var traceStart = performance.now();
+#endif
+						{{{ makeDynCall('viii', 'messageCallback') }}} (pStr, -1, userPointer);
+#if RTC_TRACE
+						WEBRTC.traceMeasure('messageCallback', traceStart);
+#endif
+						WEBRTC.free(pStr, strSize, WEBRTC.HEAP_MESSAGES);
+					} else {
+						var byteArray = new Uint8Array(evt.data);
+						var size = byteArray.length;
+						var pBuffer = WEBRTC.malloc(size, WEBRTC.HEAP_MESSAGES);
+						var heapBytes = new Uint8Array(Module['HEAPU8'].buffer, pBuffer, size);
+						heapBytes.set(byteArray);
+#if RTC_TRACE
+						var traceStart = performance.now();
+#endif
+						{{{ makeDynCall('viii', 'messageCallback') }}} (pBuffer, size, userPointer);
+#if RTC_TRACE
+						WEBRTC.traceMeasure('messageCallback', traceStart);
+#endif
+						WEBRTC.free(pBuffer, size, WEBRTC.HEAP_MESSAGES);
+					}
+				};
+				dataChannel.onclose = function() {
+					if(dataChannel.rtcUserDeleted) return;
+					var userPointer = dataChannel.rtcUserPointer || 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
+					{{{ makeDynCall('viii', 'messageCallback') }}} (0, 0, userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('messageCallback', traceStart);
+#endif
+				};
+			},
+
+			setBufferedAmountLowCallback: function(dataChannel, bufferedAmountLowCallback) {
+				var cb = function(evt) {
+					if(dataChannel.rtcUserDeleted) return;
+					var userPointer = dataChannel.rtcUserPointer || 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
+					{{{ makeDynCall('vi', 'bufferedAmountLowCallback') }}} (userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('bufferedAmountLowCallback', traceStart);
+#endif
+				};
+				dataChannel.onbufferedamountlow = cb;
+			},
+
+			createDataChannel: function(peerConnection, label, unordered, maxRetransmits,
+			                            maxPacketLifeTime, protocol, negotiated, stream) {
+				var datachannelInit = {
+					ordered: !unordered,
+					protocol: protocol,
+					negotiated: !!negotiated,
+				};
+
+				// Browsers throw an exception when both are present (even if set to null)
+				if (maxRetransmits >= 0) datachannelInit.maxRetransmits = maxRetransmits;
+				else if (maxPacketLifeTime >= 0) datachannelInit.maxPacketLifeTime = maxPacketLifeTime;
+
+				if (stream >= 0) datachannelInit.id = stream;
+
+				try {
+					return peerConnection.createDataChannel(label, datachannelInit);
+				} catch(err) {
+					console.error(err);
+					return null;
+				}
+			},
+
+			candidateFromStats: function(stats) {
+				return 'candidate:' + (stats.foundation || '0') + ' 1 ' + (stats.protocol || 'udp') + ' ' +
+				       (stats.priority || 0) + ' ' + (stats.address || stats.ip) + ' ' + stats.port +
+				       ' typ ' + stats.candidateType;
+			},
+
+			sampleStats: function(peerConnection) {
+				if(peerConnection.rtcStatsPending) return;
+				peerConnection.rtcStatsPending = true;
+				peerConnection.getStats()
+					.then(function(report) {
+						peerConnection.rtcStatsPending = false;
+						if(peerConnection.rtcUserDeleted || !peerConnection.rtcStatsBuffer) return;
+						var pair = null;
+						var messagesSent = 0;
+						var messagesReceived = 0;
+						report.forEach(function(stats) {
+							if(stats.type == 'transport' && stats.selectedCandidatePairId) {
+								pair = report.get(stats.selectedCandidatePairId) || pair;
+							} else if(stats.type == 'candidate-pair' && !pair &&
+							          (stats.selected || (stats.nominated && stats.state == 'succeeded'))) {
+								pair = stats; // Firefox does not expose selectedCandidatePairId
+							} else if(stats.type == 'data-channel') {
+								messagesSent += stats.messagesSent || 0;
+								messagesReceived += stats.messagesReceived || 0;
+							}
+						});
+						var heap = Module['HEAPF64'];
+						var p = peerConnection.rtcStatsBuffer/heap.BYTES_PER_ELEMENT;
+						heap[p] = performance.now();
+						heap[p+1] = pair && pair.currentRoundTripTime !== undefined ?
+						            pair.currentRoundTripTime * 1000 : -1;
+						heap[p+2] = pair ? pair.bytesSent || 0 : 0;
+						heap[p+3] = pair ? pair.bytesReceived || 0 : 0;
+						heap[p+4] = messagesSent;
+						heap[p+5] = messagesReceived;
+						var local = pair ? report.get(pair.localCandidateId) : null;
+						var remote = pair ? report.get(pair.remoteCandidateId) : null;
+						peerConnection.rtcSelectedLocalCandidate = local || null;
+						peerConnection.rtcSelectedRemoteCandidate = remote || null;
+					})
+					.catch(function(err) {
+						peerConnection.rtcStatsPending = false;
+					});
+			},
+
+			scheduleNegotiation: function(peerConnection) {
+				// Coalesce negotiation requests, for instance when many channels are created at once,
+				// so that a single offer is generated
+				if(peerConnection.rtcNegotiationTimeout) return;
+				peerConnection.rtcNegotiationTimeout = setTimeout(function() {
+					peerConnection.rtcNegotiationTimeout = null;
+					if(peerConnection.rtcUserDeleted) return;
+					if(!peerConnection.rtcNegotiationNeeded) return;
+					// negotiationneeded fires again once back in stable state
+					if(peerConnection.signalingState != 'stable') return;
+					WEBRTC.negotiate(peerConnection, 'offer');
+				}, 0);
+			},
+
+			negotiate: function(peerConnection, type, iceUfrag, icePwd) {
+				if(!type) {
+					type = peerConnection.signalingState == 'have-remote-offer' ||
+					       peerConnection.signalingState == 'have-local-pranswer' ? 'answer' : 'offer';
+				}
+				if(type == 'rollback') {
+					return peerConnection.setLocalDescription({ type: 'rollback' })
+						.catch(function(err) {
+							console.error(err);
+						});
+				}
+				var options = {};
+				if(type == 'offer') {
+					peerConnection.rtcNegotiationNeeded = false;
+					if(peerConnection.rtcIceRestart) options.iceRestart = true;
+					peerConnection.rtcIceRestart = false;
+				}
+				var promise = type == 'offer' ? peerConnection.createOffer(options) : peerConnection.createAnswer();
+				return promise
+					.then(function(description) {
+						var sdp = description.sdp;
+						if(iceUfrag) sdp = sdp.replace(/^a=ice-ufrag:.*$/gm, 'a=ice-ufrag:' + iceUfrag);
+						if(icePwd) sdp = sdp.replace(/^a=ice-pwd:.*$/gm, 'a=ice-pwd:' + icePwd);
+						return WEBRTC.handleDescription(peerConnection, {
+							type: type == 'pranswer' ? 'pranswer' : description.type,
+							sdp: sdp,
+						});
+					})
+					.catch(function(err) {
+						console.error(err);
+					});
+			},
+
 			handleDescription: function(peerConnection, description) {
 				return peerConnection.setLocalDescription(description)
 					.then(function() {
 						if(peerConnection.rtcUserDeleted) return;
-						if(!peerConnection.rtcDescriptionCallback) return;
-						var desc = peerConnection.localDescription;
-						var pSdp = WEBRTC.allocUTF8FromString(desc.sdp);
-						var pType = WEBRTC.allocUTF8FromString(desc.type);
-						var callback =  peerConnection.rtcDescriptionCallback;
-						var userPointer = peerConnection.rtcUserPointer || 0;
-						{{{ makeDynCall('viii', 'callback') }}} (pSdp, pType, userPointer);
-						_free(pSdp);
-						_free(pType);
+						if(peerConnection.rtcCandidateSignaling == 2 &&
+						   peerConnection.iceGatheringState != 'complete') {
+							// Non-trickle: wait for candidates to be embedded in the description
+							WEBRTC.deferDescription(peerConnection);
+							return;
+						}
+						WEBRTC.emitDescription(peerConnection);
 					});
 			},
 
+			deferDescription: function(peerConnection) {
+				peerConnection.rtcDescriptionPending = true;
+				if(peerConnection.rtcMaxGatheringDelay > 0 && !peerConnection.rtcGatheringTimeout) {
+					peerConnection.rtcGatheringTimeout = setTimeout(function() {
+						peerConnection.rtcGatheringTimeout = null;
+						if(peerConnection.rtcUserDeleted) return;
+						if(peerConnection.rtcDescriptionPending) WEBRTC.emitDescription(peerConnection);
+					}, peerConnection.rtcMaxGatheringDelay);
+				}
+			},
+
+			emitDescription: function(peerConnection) {
+				peerConnection.rtcDescriptionPending = false;
+				if(peerConnection.rtcGatheringTimeout) {
+					clearTimeout(peerConnection.rtcGatheringTimeout);
+					peerConnection.rtcGatheringTimeout = null;
+				}
+				if(!peerConnection.rtcDescriptionCallback) return;
+				var desc = peerConnection.localDescription;
+				if(!desc) return;
+				var sdpSize = lengthBytesUTF8(desc.sdp) + 1;
+				var typeSize = lengthBytesUTF8(desc.type) + 1;
+				var pSdp = WEBRTC.allocUTF8(desc.sdp, sdpSize, WEBRTC.HEAP_SDP);
+				var pType = WEBRTC.allocUTF8(desc.type, typeSize, WEBRTC.HEAP_SDP);
+				var callback =  peerConnection.rtcDescriptionCallback;
+				var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+				var traceStart = performance.now();
+#endif
+				{{{ makeDynCall('viii', 'callback') }}} (pSdp, pType, userPointer);
+#if RTC_TRACE
+				WEBRTC.traceMeasure('callback', traceStart);
+#endif
+				WEBRTC.free(pSdp, sdpSize, WEBRTC.HEAP_SDP);
+				WEBRTC.free(pType, typeSize, WEBRTC.HEAP_SDP);
+			},
+
 			handleCandidate: function(peerConnection, candidate) {
 				if(peerConnection.rtcUserDeleted) return;
+				if(peerConnection.rtcCandidateSignaling == 2) return; // embedded in the description
+				if(peerConnection.rtcCandidateSignaling == 1) {
+					peerConnection.rtcCandidateQueue.push(candidate);
+					if(!peerConnection.rtcCandidateTimeout) {
+						peerConnection.rtcCandidateTimeout = setTimeout(function() {
+							peerConnection.rtcCandidateTimeout = null;
+							WEBRTC.flushCandidates(peerConnection);
+						}, peerConnection.rtcCandidateBatchInterval);
+					}
+					return;
+				}
 				if(!peerConnection.rtcCandidateCallback) return;
-				var pCandidate = WEBRTC.allocUTF8FromString(candidate.candidate);
-				var pSdpMid = WEBRTC.allocUTF8FromString(candidate.sdpMid);
+				var candidateSize = lengthBytesUTF8(candidate.candidate) + 1;
+				var sdpMidSize = lengthBytesUTF8(candidate.sdpMid) + 1;
+				var pCandidate = WEBRTC.allocUTF8(candidate.candidate, candidateSize, WEBRTC.HEAP_CANDIDATES);
+				var pSdpMid = WEBRTC.allocUTF8(candidate.sdpMid, sdpMidSize, WEBRTC.HEAP_CANDIDATES);
 				var candidateCallback =  peerConnection.rtcCandidateCallback;
 				var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+				var traceStart = performance.now();
+#endif
 				{{{ makeDynCall('viii', 'candidateCallback') }}} (pCandidate, pSdpMid, userPointer);
-				_free(pCandidate);
-				_free(pSdpMid);
+#if RTC_TRACE
+				WEBRTC.traceMeasure('candidateCallback', traceStart);
+#endif
+				WEBRTC.free(pCandidate, candidateSize, WEBRTC.HEAP_CANDIDATES);
+				WEBRTC.free(pSdpMid, sdpMidSize, WEBRTC.HEAP_CANDIDATES);
+			},
+
+			flushCandidates: function(peerConnection) {
+				if(peerConnection.rtcCandidateTimeout) {
+					clearTimeout(peerConnection.rtcCandidateTimeout);
+					peerConnection.rtcCandidateTimeout = null;
+				}
+				var candidates = peerConnection.rtcCandidateQueue;
+				peerConnection.rtcCandidateQueue = [];
+				if(peerConnection.rtcUserDeleted) return;
+				if(!peerConnection.rtcCandidatesCallback || !candidates.length) return;
+				// Candidates are packed as consecutive null-terminated candidate and mid strings
+				var size = 0;
+				for(var i = 0; i < candidates.length; ++i)
+					size += lengthBytesUTF8(candidates[i].candidate) + lengthBytesUTF8(candidates[i].sdpMid) + 2;
+				var pBuffer = WEBRTC.malloc(size, WEBRTC.HEAP_CANDIDATES);
+				var p = pBuffer;
+				for(var i = 0; i < candidates.length; ++i) {
+					p += stringToUTF8(candidates[i].candidate, p, size - (p - pBuffer)) + 1;
+					p += stringToUTF8(candidates[i].sdpMid, p, size - (p - pBuffer)) + 1;
+				}
+				var candidatesCallback = peerConnection.rtcCandidatesCallback;
+				var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+				var traceStart = performance.now();
+#endif
+				{{{ makeDynCall('viii', 'candidatesCallback') }}} (pBuffer, candidates.length, userPointer);
+#if RTC_TRACE
+				WEBRTC.traceMeasure('candidatesCallback', traceStart);
+#endif
+				WEBRTC.free(pBuffer, size, WEBRTC.HEAP_CANDIDATES);
+			},
+
+			handleGatheringComplete: function(peerConnection) {
+				if(peerConnection.rtcUserDeleted) return;
+				if(peerConnection.rtcCandidateSignaling == 1) WEBRTC.flushCandidates(peerConnection);
+				if(peerConnection.rtcDescriptionPending) WEBRTC.emitDescription(peerConnection);
 			},
 
 			handleConnectionStateChange: function(peerConnection, connectionState) {
@@ -114,12 +659,19 @@
 				if(connectionState in map) {
 					var stateChangeCallback = peerConnection.rtcStateChangeCallback;
 					var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
 					{{{ makeDynCall('vii', 'stateChangeCallback') }}} (map[connectionState], userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('stateChangeCallback', traceStart);
+#endif
 				}
 			},
 
       handleIceStateChange: function(peerConnection, iceConnectionState) {
 				if(peerConnection.rtcUserDeleted) return;
+				WEBRTC.watchSelectedCandidatePair(peerConnection);
 				if(!peerConnection.rtcIceStateChangeCallback) return;
 				var map = {
 					'new': 0,
@@ -133,10 +685,41 @@
 				if(iceConnectionState in map) {
 					var iceStateChangeCallback = peerConnection.rtcIceStateChangeCallback;
 					var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
 					{{{ makeDynCall('vii', 'iceStateChangeCallback') }}} (map[iceConnectionState], userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('iceStateChangeCallback', traceStart);
+#endif
 				}
 			},
 
+			// Chrome keeps reporting connected during an ICE restart and only changes the selected pair
+			watchSelectedCandidatePair: function(peerConnection) {
+				var sctp = peerConnection.sctp;
+				var iceTransport = sctp && sctp.transport && sctp.transport.iceTransport;
+				if(!iceTransport || peerConnection.rtcIceTransport == iceTransport) return;
+				peerConnection.rtcIceTransport = iceTransport;
+				iceTransport.onselectedcandidatepairchange = function() {
+					WEBRTC.handleSelectedCandidatePairChange(peerConnection);
+				};
+			},
+
+			handleSelectedCandidatePairChange: function(peerConnection) {
+				if(peerConnection.rtcUserDeleted) return;
+				if(!peerConnection.rtcSelectedCandidatePairChangeCallback) return;
+				var selectedCandidatePairChangeCallback = peerConnection.rtcSelectedCandidatePairChangeCallback;
+				var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+				var traceStart = performance.now();
+#endif
+				{{{ makeDynCall('vi', 'selectedCandidatePairChangeCallback') }}} (userPointer);
+#if RTC_TRACE
+				WEBRTC.traceMeasure('selectedCandidatePairChangeCallback', traceStart);
+#endif
+			},
+
 			handleGatheringStateChange: function(peerConnection, iceGatheringState) {
 				if(peerConnection.rtcUserDeleted) return;
 				if(!peerConnection.rtcGatheringStateChangeCallback) return;
@@ -148,7 +731,13 @@
 				if(iceGatheringState in map) {
 					var gatheringStateChangeCallback = peerConnection.rtcGatheringStateChangeCallback;
 					var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
 					{{{ makeDynCall('vii', 'gatheringStateChangeCallback') }}} (map[iceGatheringState], userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('gatheringStateChangeCallback', traceStart);
+#endif
 				}
 			},
 
@@ -165,13 +754,47 @@
 				if(signalingState in map) {
 					var signalingStateChangeCallback = peerConnection.rtcSignalingStateChangeCallback;
 					var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
 					{{{ makeDynCall('vii', 'signalingStateChangeCallback') }}} (map[signalingState], userPointer);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('signalingStateChangeCallback', traceStart);
+#endif
 				}
 			},
 		},
 
-		js_rtcCreatePeerConnection: function(pUrls, pUsernames, pPasswords, nIceServers) {
-			if(!window.RTCPeerConnection) return 0;
+		js_rtcGenerateCertificate: function(type) {
+			if(!globalThis.RTCPeerConnection || !RTCPeerConnection.generateCertificate) return 0;
+			var cert = WEBRTC.nextId++;
+			WEBRTC.certificatesMap[cert] = WEBRTC.generateCertificate(type);
+			return cert;
+		},
+
+		js_rtcDeleteCertificate: function(cert) {
+			delete WEBRTC.certificatesMap[cert];
+		},
+
+		js_rtcIsCertificateReady: function(cert) {
+			return WEBRTC.readyCertificate(WEBRTC.certificatesMap[cert]) ? 1 : 0;
+		},
+
+		js_rtcPreloadCertificate: function(type) {
+			if(!globalThis.RTCPeerConnection || !RTCPeerConnection.generateCertificate) return;
+			var key = type == 2 ? 2 : 1; // Default is ECDSA
+			var entry = WEBRTC.certificateCache[key];
+			if(entry && !entry.failed && (!entry.certificate || WEBRTC.readyCertificate(entry)))
+				return; // pending or still valid
+			WEBRTC.certificateCache[key] = WEBRTC.generateCertificate(key);
+		},
+
+		js_rtcCreatePeerConnection: function(pUrls, pUsernames, pPasswords, nIceServers,
+		                                     disableAutoNegotiation, candidateSignaling,
+		                                     candidateBatchInterval, maxGatheringDelay,
+		                                     iceTransportPolicy, bundlePolicy, rtcpMuxPolicy,
+		                                     iceCandidatePoolSize, certificate, certificateType) {
+			if(!globalThis.RTCPeerConnection) return 0;
 			var iceServers = [];
 			for(var i = 0; i < nIceServers; ++i) {
 				var heap = Module['HEAPU32'];
@@ -195,26 +818,53 @@
 			}
 			var config = {
 				iceServers: iceServers,
+				iceTransportPolicy: ['all', 'relay'][iceTransportPolicy] || 'all',
+				bundlePolicy: ['balanced', 'max-compat', 'max-bundle'][bundlePolicy] || 'balanced',
+				rtcpMuxPolicy: ['require', 'negotiate'][rtcpMuxPolicy] || 'require',
+				iceCandidatePoolSize: iceCandidatePoolSize,
 			};
-			return WEBRTC.registerPeerConnection(new RTCPeerConnection(config));
+			// Reuse an explicit or preloaded certificate instead of generating one per connection
+			var cert = certificate ? WEBRTC.readyCertificate(WEBRTC.certificatesMap[certificate])
+			                       : WEBRTC.readyCertificate(WEBRTC.certificateCache[certificateType == 2 ? 2 : 1]);
+			if(cert) config.certificates = [cert];
+			var peerConnection = new RTCPeerConnection(config);
+			peerConnection.rtcAutoNegotiation = !disableAutoNegotiation;
+			peerConnection.rtcCandidateSignaling = candidateSignaling;
+			peerConnection.rtcCandidateBatchInterval = candidateBatchInterval;
+			peerConnection.rtcMaxGatheringDelay = maxGatheringDelay;
+			peerConnection.rtcCandidateQueue = [];
+			peerConnection.rtcDataChannels = {};
+			return WEBRTC.registerPeerConnection(peerConnection);
+		},
+
+		js_rtcClosePeerConnection: function(pc) {
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			if(peerConnection) WEBRTC.closePeerConnection(peerConnection);
 		},
 
 		js_rtcDeletePeerConnection: function(pc) {
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
 			if(peerConnection) {
-				peerConnection.close();
 				peerConnection.rtcUserDeleted = true;
+				WEBRTC.closePeerConnection(peerConnection);
 				delete WEBRTC.peerConnectionsMap[pc];
 			}
 		},
 
+		js_rtcGetLiveObjectCount: function() {
+			return Object.keys(WEBRTC.peerConnectionsMap).length +
+			       Object.keys(WEBRTC.dataChannelsMap).length +
+			       Object.keys(WEBRTC.webSocketStreamsMap).length +
+			       Object.keys(WEBRTC.certificatesMap).length;
+		},
+
 		js_rtcGetLocalDescription: function(pc) {
 			if(!pc) return 0;
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
 			var localDescription = peerConnection.localDescription;
 			if(!localDescription) return 0;
-			var sdp = WEBRTC.allocUTF8FromString(localDescription.sdp);
-			// sdp should be freed later in c++.
+			var sdp = WEBRTC.allocUTF8FromString(localDescription.sdp, WEBRTC.HEAP_SDP);
+			// sdp should be freed later in c++ with js_rtcFree.
 			return sdp;
 		},
 
@@ -223,8 +873,8 @@
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
 			var localDescription = peerConnection.localDescription;
 			if(!localDescription) return 0;
-			var type = WEBRTC.allocUTF8FromString(localDescription.type);
-			// type should be freed later in c++.
+			var type = WEBRTC.allocUTF8FromString(localDescription.type, WEBRTC.HEAP_SDP);
+			// type should be freed later in c++ with js_rtcFree.
 			return type;
 		},
 
@@ -233,8 +883,8 @@
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
 			var remoteDescription = peerConnection.remoteDescription;
 			if(!remoteDescription) return 0;
-			var sdp = WEBRTC.allocUTF8FromString(remoteDescription.sdp);
-			// sdp should be freed later in c++.
+			var sdp = WEBRTC.allocUTF8FromString(remoteDescription.sdp, WEBRTC.HEAP_SDP);
+			// sdp should be freed later in c++ with js_rtcFree.
 			return sdp;
 		},
 
@@ -243,33 +893,61 @@
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
 			var remoteDescription = peerConnection.remoteDescription;
 			if(!remoteDescription) return 0;
-			var type = WEBRTC.allocUTF8FromString(remoteDescription.type);
-			// type should be freed later in c++.
+			var type = WEBRTC.allocUTF8FromString(remoteDescription.type, WEBRTC.HEAP_SDP);
+			// type should be freed later in c++ with js_rtcFree.
 			return type;
 		},
 
-		js_rtcCreateDataChannel: function(pc, pLabel, unordered, maxRetransmits, maxPacketLifeTime) {
+		js_rtcCreateDataChannel: function(pc, pLabel, unordered, maxRetransmits, maxPacketLifeTime,
+		                                  pProtocol, negotiated, stream) {
 			if(!pc) return 0;
-			var label = UTF8ToString(pLabel);
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
-			var datachannelInit = {
-				ordered: !unordered,
-			};
-
-			// Browsers throw an exception when both are present (even if set to null)
-			if (maxRetransmits >= 0) datachannelInit.maxRetransmits = maxRetransmits;
-			else if (maxPacketLifeTime >= 0) datachannelInit.maxPacketLifeTime = maxPacketLifeTime;
-
-			var channel = peerConnection.createDataChannel(label, datachannelInit);
-			return WEBRTC.registerDataChannel(channel);
+			var channel = WEBRTC.createDataChannel(peerConnection, UTF8ToString(pLabel), unordered,
+			                                       maxRetransmits, maxPacketLifeTime,
+			                                       pProtocol ? UTF8ToString(pProtocol) : '',
+			                                       negotiated, stream);
+			if(!channel) return 0;
+			return WEBRTC.registerDataChannel(channel, peerConnection);
 		},
 
- 		js_rtcDeleteDataChannel: function(dc) {
-			var dataChannel = WEBRTC.dataChannelsMap[dc];
-			if(dataChannel) {
-				dataChannel.rtcUserDeleted = true;
-				delete WEBRTC.dataChannelsMap[dc];
+		js_rtcCreateDataChannels: function(pc, count, pLabels, pProtocols, pParams, pUserPointers,
+		                                   openCallback, errorCallback, messageCallback,
+		                                   bufferedAmountLowCallback, pIds) {
+			if(!pc) return 0;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			var heap = Module['HEAPU32'];
+			var params = Module['HEAP32'];
+			var channels = [];
+			for(var i = 0; i < count; ++i) {
+				var pLabel = heap[pLabels/heap.BYTES_PER_ELEMENT + i];
+				var pProtocol = heap[pProtocols/heap.BYTES_PER_ELEMENT + i];
+				// Parameters are unordered, maxRetransmits, maxPacketLifeTime, negotiated, stream
+				var p = pParams/params.BYTES_PER_ELEMENT + 5*i;
+				var channel = WEBRTC.createDataChannel(peerConnection, UTF8ToString(pLabel),
+				                                       params[p], params[p+1], params[p+2],
+				                                       UTF8ToString(pProtocol), params[p+3], params[p+4]);
+				if(!channel) {
+					// All or nothing
+					for(var j = 0; j < channels.length; ++j) channels[j].close();
+					return 0;
+				}
+				channels.push(channel);
+			}
+			for(var i = 0; i < count; ++i) {
+				var channel = channels[i];
+				var dc = WEBRTC.registerDataChannel(channel, peerConnection);
+				channel.rtcUserPointer = heap[pUserPointers/heap.BYTES_PER_ELEMENT + i];
+				WEBRTC.setOpenCallback(channel, openCallback);
+				WEBRTC.setErrorCallback(channel, errorCallback);
+				WEBRTC.setMessageCallback(channel, messageCallback);
+				WEBRTC.setBufferedAmountLowCallback(channel, bufferedAmountLowCallback);
+				params[pIds/params.BYTES_PER_ELEMENT + i] = dc;
 			}
+			return count;
+		},
+
+		js_rtcDeleteDataChannel: function(dc) {
+			WEBRTC.unregisterDataChannel(dc);
 		},
 
 		js_rtcSetDataChannelCallback: function(pc, dataChannelCallback) {
@@ -277,9 +955,15 @@
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
 			peerConnection.ondatachannel = function(evt) {
 				if(peerConnection.rtcUserDeleted) return;
-				var dc = WEBRTC.registerDataChannel(evt.channel);
+				var dc = WEBRTC.registerDataChannel(evt.channel, peerConnection);
 				var userPointer = peerConnection.rtcUserPointer || 0;
+#if RTC_TRACE
+				var traceStart = performance.now();
+#endif
 				{{{ makeDynCall('vii', 'dataChannelCallback') }}} (dc, userPointer);
+#if RTC_TRACE
+				WEBRTC.traceMeasure('dataChannelCallback', traceStart);
+#endif
 			};
 		},
 
@@ -295,6 +979,12 @@
 			peerConnection.rtcCandidateCallback = candidateCallback;
 		},
 
+		js_rtcSetLocalCandidatesCallback: function(pc, candidatesCallback) {
+			if(!pc) return;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			peerConnection.rtcCandidatesCallback = candidatesCallback;
+		},
+
 		js_rtcSetStateChangeCallback: function(pc, stateChangeCallback) {
 			if(!pc) return;
 			var peerConnection = WEBRTC.peerConnectionsMap[pc];
@@ -319,6 +1009,12 @@
 			peerConnection.rtcSignalingStateChangeCallback = signalingStateChangeCallback;
 		},
 
+		js_rtcSetSelectedCandidatePairChangeCallback: function(pc, selectedCandidatePairChangeCallback) {
+			if(!pc) return;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			peerConnection.rtcSelectedCandidatePairChangeCallback = selectedCandidatePairChangeCallback;
+		},
+
 		js_rtcSetRemoteDescription: function(pc, pSdp, pType) {
 			var description = new RTCSessionDescription({
 				sdp: UTF8ToString(pSdp),
@@ -328,21 +1024,82 @@
 			peerConnection.setRemoteDescription(description)
 				.then(function() {
 					if(peerConnection.rtcUserDeleted) return;
-					if(description.type == 'offer') {
-						peerConnection.createAnswer()
-							.then(function(answer) {
-								return WEBRTC.handleDescription(peerConnection, answer);
-							})
-							.catch(function(err) {
-								console.error(err);
-							});
-					}
+					if(description.type == 'offer' && peerConnection.rtcAutoNegotiation)
+						WEBRTC.negotiate(peerConnection, 'answer');
 				})
 				.catch(function(err) {
 					console.error(err);
 				});
 		},
 
+		js_rtcSetLocalDescription: function(pc, pType, pIceUfrag, pIcePwd) {
+			if(!pc) return;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			var type = pType ? UTF8ToString(pType) : '';
+			var iceUfrag = pIceUfrag ? UTF8ToString(pIceUfrag) : '';
+			var icePwd = pIcePwd ? UTF8ToString(pIcePwd) : '';
+			WEBRTC.negotiate(peerConnection, type, iceUfrag, icePwd);
+		},
+
+		js_rtcRestartIce: function(pc) {
+			if(!pc) return;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			peerConnection.rtcIceRestart = true;
+			if(peerConnection.restartIce) {
+				// Fires negotiationneeded, which goes through the usual negotiation path
+				peerConnection.restartIce();
+			} else {
+				peerConnection.rtcNegotiationNeeded = true;
+				if(peerConnection.rtcAutoNegotiation) WEBRTC.scheduleNegotiation(peerConnection);
+			}
+		},
+
+		js_rtcIsNegotiationNeeded: function(pc) {
+			if(!pc) return 0;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			return peerConnection.rtcNegotiationNeeded ? 1 : 0;
+		},
+
+		js_rtcStartStats: function(pc, pBuffer, interval) {
+			if(!pc) return;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			peerConnection.rtcStatsBuffer = pBuffer;
+			if(peerConnection.rtcStatsInterval) clearInterval(peerConnection.rtcStatsInterval);
+			peerConnection.rtcStatsInterval = setInterval(function() {
+				WEBRTC.sampleStats(peerConnection);
+			}, interval);
+			WEBRTC.sampleStats(peerConnection);
+		},
+
+		js_rtcGetSelectedCandidatePair: function(pc, pLocal, localSize, pRemote, remoteSize) {
+			if(!pc) return 0;
+			var peerConnection = WEBRTC.peerConnectionsMap[pc];
+			var local = peerConnection.rtcSelectedLocalCandidate;
+			var remote = peerConnection.rtcSelectedRemoteCandidate;
+			if(!local || !remote) return 0;
+			stringToUTF8(WEBRTC.candidateFromStats(local), pLocal, localSize);
+			stringToUTF8(WEBRTC.candidateFromStats(remote), pRemote, remoteSize);
+			return 1;
+		},
+
+		js_rtcGetLocalAddress: function(pc, pBuffer, size) {
+			if(!pc) return 0;
+			var candidate = WEBRTC.peerConnectionsMap[pc].rtcSelectedLocalCandidate;
+			if(!candidate) return 0;
+			var address = (candidate.address || candidate.ip) + ':' + candidate.port;
+			stringToUTF8(address, pBuffer, size);
+			return lengthBytesUTF8(address);
+		},
+
+		js_rtcGetRemoteAddress: function(pc, pBuffer, size) {
+			if(!pc) return 0;
+			var candidate = WEBRTC.peerConnectionsMap[pc].rtcSelectedRemoteCandidate;
+			if(!candidate) return 0;
+			var address = (candidate.address || candidate.ip) + ':' + candidate.port;
+			stringToUTF8(address, pBuffer, size);
+			return lengthBytesUTF8(address);
+		},
+
 		js_rtcAddRemoteCandidate: function(pc, pCandidate, pSdpMid) {
 			var iceCandidate = new RTCIceCandidate({
 				candidate: UTF8ToString(pCandidate),
@@ -362,6 +1119,19 @@
 			return lengthBytesUTF8(label);
 		},
 
+		js_rtcGetDataChannelProtocol: function(dc, pBuffer, size) {
+			if(!dc) return 0;
+			var protocol = WEBRTC.dataChannelsMap[dc].protocol;
+			if(pBuffer) stringToUTF8(protocol, pBuffer, size);
+			return lengthBytesUTF8(protocol);
+		},
+
+		js_rtcGetDataChannelStream: function(dc) {
+			if(!dc) return -1;
+			var dataChannel = WEBRTC.dataChannelsMap[dc];
+			return dataChannel.id !== null ? dataChannel.id : -1;
+		},
+
 		js_rtcGetDataChannelUnordered: function(dc) {
 			if(!dc) return 0;
 			var dataChannel = WEBRTC.dataChannelsMap[dc];
@@ -382,70 +1152,28 @@
 
 		js_rtcSetOpenCallback: function(dc, openCallback) {
 			if(!dc) return;
-			var dataChannel = WEBRTC.dataChannelsMap[dc];
-			var cb = function() {
-				if(dataChannel.rtcUserDeleted) return;
-				var userPointer = dataChannel.rtcUserPointer || 0;
-				{{{ makeDynCall('vi', 'openCallback') }}} (userPointer);
-			};
-			dataChannel.onopen = cb;
-			if(dataChannel.readyState == 'open') setTimeout(cb, 0);
+			WEBRTC.setOpenCallback(WEBRTC.dataChannelsMap[dc], openCallback);
 		},
 
 		js_rtcSetErrorCallback: function(dc, errorCallback) {
 			if(!dc) return;
-			var dataChannel = WEBRTC.dataChannelsMap[dc];
-			var cb = function(evt) {
-				if(dataChannel.rtcUserDeleted) return;
-				var userPointer = dataChannel.rtcUserPointer || 0;
-				var pError = evt.message ? WEBRTC.allocUTF8FromString(evt.message) : 0;
-				{{{ makeDynCall('vii', 'errorCallback') }}} (pError, userPointer);
-				_free(pError);
-			};
-			dataChannel.onerror = cb;
+			WEBRTC.setErrorCallback(WEBRTC.dataChannelsMap[dc], errorCallback);
 		},
 
 		js_rtcSetMessageCallback: function(dc, messageCallback) {
 			if(!dc) return;
-			var dataChannel = WEBRTC.dataChannelsMap[dc];
-			dataChannel.onmessage = function(evt) {
-				if(dataChannel.rtcUserDeleted) return;
-				var userPointer = dataChannel.rtcUserPointer || 0;
-				if(typeof evt.data == 'string') {
-					var pStr = WEBRTC.allocUTF8FromString(evt.data);
-					{{{ makeDynCall('viii', 'messageCallback') }}} (pStr, -1, userPointer);
-					_free(pStr);
-				} else {
-					var byteArray = new Uint8Array(evt.data);
-					var size = byteArray.length;
-					var pBuffer = _malloc(size);
-					var heapBytes = new Uint8Array(Module['HEAPU8'].buffer, pBuffer, size);
-					heapBytes.set(byteArray);
-					{{{ makeDynCall('viii', 'messageCallback') }}} (pBuffer, size, userPointer);
-					_free(pBuffer);
-				}
-			};
-			dataChannel.onclose = function() {
-				if(dataChannel.rtcUserDeleted) return;
-				var userPointer = dataChannel.rtcUserPointer || 0;
-				{{{ makeDynCall('viii', 'messageCallback') }}} (0, 0, userPointer);
-			};
+			WEBRTC.setMessageCallback(WEBRTC.dataChannelsMap[dc], messageCallback);
 		},
 
 		js_rtcSetBufferedAmountLowCallback: function(dc, bufferedAmountLowCallback) {
 			if(!dc) return;
-			var dataChannel = WEBRTC.dataChannelsMap[dc];
-			var cb = function(evt) {
-				if(dataChannel.rtcUserDeleted) return;
-				var userPointer = dataChannel.rtcUserPointer || 0;
-				{{{ makeDynCall('vi', 'bufferedAmountLowCallback') }}} (userPointer);
-			};
-			dataChannel.onbufferedamountlow = cb;
+			WEBRTC.setBufferedAmountLowCallback(WEBRTC.dataChannelsMap[dc], bufferedAmountLowCallback);
 		},
 
 		js_rtcGetBufferedAmount: function(dc) {
 			if(!dc) return;
 			var dataChannel = WEBRTC.dataChannelsMap[dc];
+			if(!dataChannel) return -1;
 			return dataChannel.bufferedAmount;
 		},
 
@@ -458,7 +1186,10 @@
 		js_rtcSendMessage: function(dc, pBuffer, size) {
 			if(!dc) return;
 			var dataChannel = WEBRTC.dataChannelsMap[dc];
-			if(dataChannel.readyState != 'open') return -1;
+			if(!dataChannel || dataChannel.readyState != 'open') return -1;
+#if RTC_TRACE
+			var traceStart = performance.now();
+#endif
 			if(size >= 0) {
 				var heapBytes = new Uint8Array(Module['HEAPU8'].buffer, pBuffer, size);
 				if(heapBytes.buffer instanceof ArrayBuffer) {
@@ -468,12 +1199,212 @@
 					byteArray.set(heapBytes);
 					dataChannel.send(byteArray);
 				}
-				return size;
 			} else {
-				var str = UTF8ToString(pBuffer);
-				dataChannel.send(str);
-				return lengthBytesUTF8(str);
+				dataChannel.send(UTF8ToString(pBuffer));
+			}
+#if RTC_TRACE
+			WEBRTC.traceMeasure('send', traceStart);
+#endif
+			// Saves a call to read it for metrics and backpressure
+			return dataChannel.bufferedAmount;
+		},
+
+		js_rtcSendMessageMulti: function(pIds, count, pBuffer, size, pBufferedAmounts) {
+#if RTC_TRACE
+			var traceStart = performance.now();
+#endif
+			var heap = Module['HEAP32'];
+			var message;
+			if(size >= 0) {
+				// Copy once into a standalone buffer shared by all channels
+				message = new Uint8Array(new ArrayBuffer(size));
+				message.set(new Uint8Array(Module['HEAPU8'].buffer, pBuffer, size));
+			} else {
+				message = UTF8ToString(pBuffer);
+			}
+			var sent = 0;
+			for(var i = 0; i < count; ++i) {
+				var dataChannel = WEBRTC.dataChannelsMap[heap[pIds/heap.BYTES_PER_ELEMENT + i]];
+				var bufferedAmount = -1;
+				if(dataChannel && dataChannel.readyState == 'open') {
+					try {
+						dataChannel.send(message);
+						bufferedAmount = dataChannel.bufferedAmount;
+						++sent;
+					} catch(err) {
+						console.error(err);
+					}
+				}
+				heap[pBufferedAmounts/heap.BYTES_PER_ELEMENT + i] = bufferedAmount;
+			}
+#if RTC_TRACE
+			WEBRTC.traceMeasure('sendMulti', traceStart);
+#endif
+			return sent;
+		},
+
+		js_rtcIsWebSocketStreamSupported: function() {
+			return typeof WebSocketStream !== 'undefined' ? 1 : 0;
+		},
+
+		js_rtcCreateWebSocketStream: function(pUrl, pProtocols, userPointer, openCallback, errorCallback,
+		                                      messageCallback, closedCallback,
+		                                      bufferedAmountLowCallback) {
+			if(typeof WebSocketStream === 'undefined') return 0;
+			var url = UTF8ToString(pUrl);
+			var protocols = pProtocols ? UTF8ToString(pProtocols).split(',') : [];
+			var stream;
+			try {
+				// The constructor throws synchronously on an invalid URL or protocol
+				stream = new WebSocketStream(url, protocols.length ? { protocols: protocols } : {});
+			} catch(err) {
+				console.error(err);
+				return 0;
+			}
+			var webSocket = {
+				rtcStream: stream,
+				rtcUserPointer: userPointer,
+				rtcMessageCallback: messageCallback,
+				rtcErrorCallback: errorCallback,
+				rtcClosedCallback: closedCallback,
+				rtcBufferedAmount: 0,
+				rtcBufferedAmountLowThreshold: 0,
+			};
+			var ws = WEBRTC.nextId++;
+			WEBRTC.webSocketStreamsMap[ws] = webSocket;
+			webSocket.rtcStream.opened
+				.then(function(connection) {
+					if(webSocket.rtcUserDeleted) return;
+					webSocket.rtcReader = connection.readable.getReader();
+					webSocket.rtcWriter = connection.writable.getWriter();
+					webSocket.rtcBufferedAmountLow = function() {
+						if(webSocket.rtcUserDeleted) return;
+#if RTC_TRACE
+						var traceStart = performance.now();
+#endif
+						{{{ makeDynCall('vi', 'bufferedAmountLowCallback') }}} (webSocket.rtcUserPointer || 0);
+#if RTC_TRACE
+						WEBRTC.traceMeasure('bufferedAmountLowCallback', traceStart);
+#endif
+					};
+#if RTC_TRACE
+					var traceStart = performance.now();
+#endif
+					{{{ makeDynCall('vi', 'openCallback') }}} (webSocket.rtcUserPointer || 0);
+#if RTC_TRACE
+					WEBRTC.traceMeasure('openCallback', traceStart);
+#endif
+					WEBRTC.readWebSocketStream(webSocket);
+				})
+				.catch(function(err) {
+					// If opening fails, closed rejects too, so whichever settles first reports
+					WEBRTC.handleWebSocketStreamError(webSocket, err);
+					WEBRTC.handleWebSocketStreamClosed(webSocket);
+				});
+			webSocket.rtcStream.closed
+				.then(function() {
+					WEBRTC.handleWebSocketStreamClosed(webSocket);
+				}, function(err) {
+					WEBRTC.handleWebSocketStreamError(webSocket, err);
+					WEBRTC.handleWebSocketStreamClosed(webSocket);
+				});
+			return ws;
+		},
+
+		js_rtcDeleteWebSocketStream: function(ws) {
+			var webSocket = WEBRTC.webSocketStreamsMap[ws];
+			if(webSocket) {
+				webSocket.rtcUserDeleted = true;
+				try {
+					webSocket.rtcStream.close();
+				} catch(err) {}
+				delete WEBRTC.webSocketStreamsMap[ws];
+			}
+		},
+
+		js_rtcSendWebSocketStream: function(ws, pBuffer, size) {
+			var webSocket = WEBRTC.webSocketStreamsMap[ws];
+			if(!webSocket || !webSocket.rtcWriter) return -1;
+			var data;
+			if(size >= 0) {
+				// The write is asynchronous, so the message must be copied out of the heap
+				data = new Uint8Array(size);
+				data.set(new Uint8Array(Module['HEAPU8'].buffer, pBuffer, size));
+			} else {
+				data = UTF8ToString(pBuffer);
+				size = lengthBytesUTF8(data);
+			}
+			webSocket.rtcBufferedAmount += size;
+			webSocket.rtcWriter.write(data)
+				.then(function() {
+					var previous = webSocket.rtcBufferedAmount;
+					webSocket.rtcBufferedAmount -= size;
+					var threshold = webSocket.rtcBufferedAmountLowThreshold;
+					if(previous > threshold && webSocket.rtcBufferedAmount <= threshold)
+						webSocket.rtcBufferedAmountLow();
+				})
+				.catch(function(err) {
+					webSocket.rtcBufferedAmount -= size;
+				});
+			return webSocket.rtcBufferedAmount;
+		},
+
+		js_rtcGetWebSocketStreamBufferedAmount: function(ws) {
+			var webSocket = WEBRTC.webSocketStreamsMap[ws];
+			return webSocket ? webSocket.rtcBufferedAmount : 0;
+		},
+
+		js_rtcSetWebSocketStreamBufferedAmountLowThreshold: function(ws, threshold) {
+			var webSocket = WEBRTC.webSocketStreamsMap[ws];
+			if(webSocket) webSocket.rtcBufferedAmountLowThreshold = threshold;
+		},
+
+		js_rtcSetWebSocketStreamPaused: function(ws, paused) {
+			var webSocket = WEBRTC.webSocketStreamsMap[ws];
+			if(!webSocket) return;
+			webSocket.rtcPaused = paused ? true : false;
+			if(!webSocket.rtcPaused && webSocket.rtcReader) WEBRTC.readWebSocketStream(webSocket);
+		},
+
+#if RTC_TRACE
+		js_rtcTraceMeasure: function(pName, start) {
+			WEBRTC.traceMeasure(UTF8ToString(pName), start);
+		},
+
+#endif
+		js_rtcFree: function(ptr) {
+			if(!ptr) return;
+#if RTC_HEAP_STATS
+			var entry = WEBRTC.heapEntries[ptr];
+			if(entry !== undefined) {
+				var source = entry % 8;
+				WEBRTC.recordFree((entry - source) / 8, source);
+				delete WEBRTC.heapEntries[ptr];
+			}
+#endif
+			_free(ptr);
+		},
+
+		js_rtcGetHeapStats: function(source, pStats) {
+			// Writes live bytes, allocations and peak live bytes, source -1 means total
+			var heap = Module['HEAPF64'];
+			var i = pStats/heap.BYTES_PER_ELEMENT;
+#if RTC_HEAP_STATS
+			if(source < 0) {
+				var allocations = 0;
+				for(var j = 0; j < WEBRTC.heapAllocations.length; ++j)
+					allocations += WEBRTC.heapAllocations[j];
+				heap[i] = WEBRTC.heapTotalLive;
+				heap[i+1] = allocations;
+				heap[i+2] = WEBRTC.heapTotalPeak;
+			} else {
+				heap[i] = WEBRTC.heapLive[source] || 0;
+				heap[i+1] = WEBRTC.heapAllocations[source] || 0;
+				heap[i+2] = WEBRTC.heapPeak[source] || 0;
 			}
+#else
+			heap[i] = heap[i+1] = heap[i+2] = 0;
+#endif
 		},
 
 		js_rtcSetUserPointer: function(i, ptr) {
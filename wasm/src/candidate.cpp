@@ -24,15 +24,187 @@
 
 namespace rtc {
 
+namespace {
+
+using std::string_view;
+
+bool equalsIgnoreCase(string_view a, string_view b) {
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); ++i) {
+		char c = a[i] >= 'A' && a[i] <= 'Z' ? char(a[i] - 'A' + 'a') : a[i];
+		if (c != b[i])
+			return false;
+	}
+	return true;
+}
+
+template <typename T> bool parseUInt(string_view str, T &value) {
+	if (str.empty())
+		return false;
+
+	uint64_t result = 0;
+	for (char c : str) {
+		if (c < '0' || c > '9')
+			return false;
+		result = result * 10 + uint64_t(c - '0');
+		if (result > uint64_t(T(~T(0))))
+			return false;
+	}
+	value = T(result);
+	return true;
+}
+
+} // namespace
+
 Candidate::Candidate(const string &candidate, const string &mid)
-    : mCandidate(candidate), mMid(mid) {}
+    : mCandidate(candidate), mMid(mid) {
+	parse();
+}
 
-string Candidate::candidate() const { return mCandidate; }
+const string &Candidate::candidate() const { return mCandidate; }
 
-string Candidate::mid() const { return mMid; }
+const string &Candidate::mid() const { return mMid; }
 
 Candidate::operator string() const { return "a=" + mCandidate; }
 
+bool Candidate::isParsed() const { return mParsed; }
+
+string_view Candidate::foundation() const { return field(mFoundation); }
+
+uint16_t Candidate::component() const { return mComponent; }
+
+string_view Candidate::transport() const { return field(mTransport); }
+
+Candidate::TransportType Candidate::transportType() const { return mTransportType; }
+
+uint32_t Candidate::priority() const { return mPriority; }
+
+string_view Candidate::address() const { return field(mAddress); }
+
+uint16_t Candidate::port() const { return mPort; }
+
+Candidate::Type Candidate::type() const {
+	string_view type = field(mType);
+	if (type == "host")
+		return Type::Host;
+	if (type == "srflx")
+		return Type::ServerReflexive;
+	if (type == "prflx")
+		return Type::PeerReflexive;
+	if (type == "relay")
+		return Type::Relayed;
+
+	return Type::Unknown;
+}
+
+string_view Candidate::typeString() const { return field(mType); }
+
+optional<string_view> Candidate::relatedAddress() const {
+	if (mRelatedAddress.pos == string::npos)
+		return nullopt;
+
+	return field(mRelatedAddress);
+}
+
+optional<uint16_t> Candidate::relatedPort() const { return mRelatedPort; }
+
+void Candidate::parse() {
+	// [a=]candidate:<foundation> <component> <transport> <priority> <address> <port> typ <type>
+	// followed by optional name and value pairs like raddr, rport and tcptype
+	string_view line(mCandidate);
+	size_t offset = 0;
+	if (line.substr(0, 2) == "a=")
+		offset += 2;
+	if (line.substr(offset, 10) != "candidate:")
+		return;
+	offset += 10;
+
+	string_view tcptype;
+	string_view previous;
+	int index = 0;
+	while (offset < line.size()) {
+		size_t end = line.find(' ', offset);
+		if (end == string_view::npos)
+			end = line.size();
+
+		Field f{offset, end - offset};
+		string_view token = line.substr(offset, end - offset);
+		offset = end + 1;
+		if (token.empty())
+			continue;
+
+		switch (index++) {
+		case 0:
+			mFoundation = f;
+			break;
+		case 1:
+			if (!parseUInt(token, mComponent))
+				return;
+			break;
+		case 2:
+			mTransport = f;
+			break;
+		case 3:
+			if (!parseUInt(token, mPriority))
+				return;
+			break;
+		case 4:
+			mAddress = f;
+			break;
+		case 5:
+			if (!parseUInt(token, mPort))
+				return;
+			break;
+		default:
+			// Extensions come as name and value pairs, starting with typ
+			if ((index - 7) % 2 == 0) {
+				previous = token;
+				break;
+			}
+			if (previous == "typ") {
+				mType = f;
+			} else if (previous == "raddr") {
+				mRelatedAddress = f;
+			} else if (previous == "rport") {
+				uint16_t port = 0;
+				if (parseUInt(token, port))
+					mRelatedPort = port;
+			} else if (previous == "tcptype") {
+				tcptype = token;
+			}
+			break;
+		}
+	}
+
+	if (index < 8 || mType.pos == string::npos)
+		return;
+
+	string_view transport = field(mTransport);
+	if (equalsIgnoreCase(transport, "udp"))
+		mTransportType = TransportType::Udp;
+	else if (!equalsIgnoreCase(transport, "tcp"))
+		mTransportType = TransportType::Unknown;
+	else if (tcptype == "active")
+		mTransportType = TransportType::TcpActive;
+	else if (tcptype == "passive")
+		mTransportType = TransportType::TcpPassive;
+	else if (tcptype == "so")
+		mTransportType = TransportType::TcpSo;
+	else
+		mTransportType = TransportType::TcpUnknown;
+
+	mParsed = true;
+}
+
+string_view Candidate::field(const Field &f) const {
+	if (f.pos == string::npos)
+		return string_view();
+
+	return string_view(mCandidate).substr(f.pos, f.len);
+}
+
 } // namespace rtc
 
 std::ostream &operator<<(std::ostream &out, const rtc::Candidate &candidate) {
@@ -31,6 +31,7 @@ std::unordered_map<int, shared_ptr<DataChannel>> dataChannelMap;
 #if RTC_ENABLE_WEBSOCKET
 std::unordered_map<int, shared_ptr<WebSocket>> webSocketMap;
 #endif
+std::unordered_map<int, shared_ptr<RttProbe>> rttProbeMap; // by PeerConnection ID
 std::unordered_map<int, void *> userPointerMap;
 std::mutex mutex;
 int lastId = 0;
@@ -82,9 +83,29 @@ void erasePeerConnection(int pc) {
 	std::lock_guard lock(mutex);
 	if (peerConnectionMap.erase(pc) == 0)
 		throw std::invalid_argument("Peer Connection ID does not exist");
+	rttProbeMap.erase(pc);
 	userPointerMap.erase(pc);
 }
 
+shared_ptr<RttProbe> getRttProbe(int pc) {
+	std::lock_guard lock(mutex);
+	if (auto it = rttProbeMap.find(pc); it != rttProbeMap.end())
+		return it->second;
+	else
+		throw std::invalid_argument("RTT probe is not started");
+}
+
+void emplaceRttProbe(int pc, shared_ptr<RttProbe> ptr) {
+	std::lock_guard lock(mutex);
+	rttProbeMap[pc] = std::move(ptr);
+}
+
+void eraseRttProbe(int pc) {
+	std::lock_guard lock(mutex);
+	if (rttProbeMap.erase(pc) == 0)
+		throw std::invalid_argument("RTT probe is not started");
+}
+
 void eraseDataChannel(int dc) {
 	std::lock_guard lock(mutex);
 	if (dataChannelMap.erase(dc) == 0)
@@ -95,6 +116,7 @@ void eraseDataChannel(int dc) {
 size_t eraseAll() {
 	std::lock_guard lock(mutex);
 	size_t count = dataChannelMap.size() + peerConnectionMap.size();
+	rttProbeMap.clear();
 	dataChannelMap.clear();
 	peerConnectionMap.clear();
 #if RTC_ENABLE_WEBSOCKET
@@ -165,6 +187,26 @@ template <typename T> int copyAndReturn(std::vector<T> b, T *buffer, int size) {
 	return int(b.size());
 }
 
+DataChannelInit toDataChannelInit(const rtcDataChannelInit *init) {
+	DataChannelInit dci = {};
+	if (init) {
+		auto *reliability = &init->reliability;
+		dci.reliability.unordered = reliability->unordered;
+		if (reliability->unreliable) {
+			if (reliability->maxPacketLifeTime > 0)
+				dci.reliability.maxPacketLifeTime.emplace(
+				    milliseconds(reliability->maxPacketLifeTime));
+			else
+				dci.reliability.maxRetransmits.emplace(reliability->maxRetransmits);
+		}
+
+		dci.negotiated = init->negotiated;
+		dci.id = init->manualStream ? std::make_optional(init->stream) : nullopt;
+		dci.protocol = init->protocol ? init->protocol : "";
+	}
+	return dci;
+}
+
 template <typename F> int wrap(F func) {
 	try {
 		return int(func());
@@ -214,6 +256,25 @@ int rtcCreatePeerConnection(const rtcConfiguration *config) {
 		Configuration c;
 		for (int i = 0; i < config->iceServersCount; ++i)
 			c.iceServers.emplace_back(string(config->iceServers[i]));
+
+		c.certificateType = static_cast<CertificateType>(config->certificateType);
+		c.iceTransportPolicy = static_cast<TransportPolicy>(config->iceTransportPolicy);
+		c.bundlePolicy = static_cast<BundlePolicy>(config->bundlePolicy);
+		c.rtcpMuxPolicy = static_cast<RtcpMuxPolicy>(config->rtcpMuxPolicy);
+
+		if (config->iceCandidatePoolSize < 0 || config->iceCandidatePoolSize > 255)
+			throw std::invalid_argument("Invalid ICE candidate pool size");
+
+		c.iceCandidatePoolSize = uint16_t(config->iceCandidatePoolSize);
+		c.disableAutoNegotiation = config->disableAutoNegotiation;
+		c.candidateSignaling =
+		    static_cast<Configuration::CandidateSignaling>(config->candidateSignaling);
+
+		if (config->candidateBatchIntervalMs > 0)
+			c.candidateBatchInterval = milliseconds(config->candidateBatchIntervalMs);
+
+		if (config->maxGatheringDelayMs > 0)
+			c.maxGatheringDelay = milliseconds(config->maxGatheringDelayMs);
 		return emplacePeerConnection(std::make_shared<PeerConnection>(std::move(c)));
 	});
 }
@@ -369,6 +430,73 @@ int rtcAddRemoteCandidate(int pc, const char *cand, const char *mid) {
 	});
 }
 
+bool rtcIsNegotiationNeeded(int pc) {
+	return wrap([&] { return getPeerConnection(pc)->negotiationNeeded() ? 0 : 1; }) == 0 ? true
+	                                                                                    : false;
+}
+
+int rtcRestartIce(int pc) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+		peerConnection->restartIce();
+		return RTC_ERR_SUCCESS;
+	});
+}
+
+int rtcGetIceRestartLatency(int pc) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+		if (auto latency = peerConnection->iceRestartLatency())
+			return int(latency->count());
+		else
+			return RTC_ERR_NOT_AVAIL;
+	});
+}
+
+int rtcStartRttProbe(int pc, int stream, int intervalMs) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+
+		if (stream > 65534)
+			throw std::invalid_argument("Invalid RTT probe stream ID");
+
+		auto interval = intervalMs > 0 ? milliseconds(intervalMs) : milliseconds(1000);
+		auto probe = std::make_shared<RttProbe>(
+		    peerConnection, stream >= 0 ? uint16_t(stream) : RttProbe::DEFAULT_STREAM, interval);
+		emplaceRttProbe(pc, std::move(probe));
+		return RTC_ERR_SUCCESS;
+	});
+}
+
+int rtcStopRttProbe(int pc) {
+	return wrap([&] {
+		eraseRttProbe(pc);
+		return RTC_ERR_SUCCESS;
+	});
+}
+
+int rtcGetRttStats(int pc, rtcRttStats *stats) {
+	return wrap([&] {
+		auto probe = getRttProbe(pc);
+
+		if (!stats)
+			throw std::invalid_argument("Unexpected null pointer for stats");
+
+		auto s = probe->stats();
+		stats->pingsSent = s.pingsSent;
+		stats->pongsReceived = s.pongsReceived;
+		stats->last = s.last.value_or(-1);
+		stats->smoothed = s.smoothed.value_or(-1);
+		stats->jitter = s.jitter.value_or(-1);
+		stats->min = s.min.value_or(-1);
+		stats->max = s.max.value_or(-1);
+		stats->p50 = probe->percentile(0.50).value_or(-1);
+		stats->p90 = probe->percentile(0.90).value_or(-1);
+		stats->p99 = probe->percentile(0.99).value_or(-1);
+		return RTC_ERR_SUCCESS;
+	});
+}
+
 int rtcGetLocalDescription(int pc, char *buffer, int size) {
 	return wrap([&] {
 		auto peerConnection = getPeerConnection(pc);
@@ -413,6 +541,79 @@ int rtcGetRemoteDescriptionType(int pc, char *buffer, int size) {
 	});
 }
 
+int rtcGetLocalAddress(int pc, char *buffer, int size) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+
+		if (auto addr = peerConnection->localAddress())
+			return copyAndReturn(std::move(*addr), buffer, size);
+		else
+			return RTC_ERR_NOT_AVAIL;
+	});
+}
+
+int rtcGetRemoteAddress(int pc, char *buffer, int size) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+
+		if (auto addr = peerConnection->remoteAddress())
+			return copyAndReturn(std::move(*addr), buffer, size);
+		else
+			return RTC_ERR_NOT_AVAIL;
+	});
+}
+
+int rtcGetSelectedCandidatePair(int pc, char *local, int localSize, char *remote, int remoteSize) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+
+		Candidate localCand("", "");
+		Candidate remoteCand("", "");
+		if (!peerConnection->getSelectedCandidatePair(&localCand, &remoteCand))
+			return RTC_ERR_NOT_AVAIL;
+
+		int localRet = copyAndReturn(string(localCand), local, localSize);
+		if (localRet < 0)
+			return localRet;
+
+		int remoteRet = copyAndReturn(string(remoteCand), remote, remoteSize);
+		if (remoteRet < 0)
+			return remoteRet;
+
+		return std::max(localRet, remoteRet);
+	});
+}
+
+int rtcGetStats(int pc, rtcStats *stats) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+
+		if (!stats)
+			throw std::invalid_argument("Unexpected null pointer for stats");
+
+		auto s = peerConnection->stats();
+		stats->timestamp = s.timestamp;
+		stats->rtt = s.rtt ? *s.rtt : -1.0;
+		stats->bytesSent = s.bytesSent;
+		stats->bytesReceived = s.bytesReceived;
+		stats->messagesSent = s.messagesSent;
+		stats->messagesReceived = s.messagesReceived;
+		return RTC_ERR_SUCCESS;
+	});
+}
+
+int rtcSetStatsInterval(int pc, int intervalMs) {
+	return wrap([&] {
+		auto peerConnection = getPeerConnection(pc);
+
+		if (intervalMs <= 0)
+			throw std::invalid_argument("Invalid stats interval");
+
+		peerConnection->setStatsInterval(milliseconds(intervalMs));
+		return RTC_ERR_SUCCESS;
+	});
+}
+
 int rtcSetOpenCallback(int id, rtcOpenCallbackFunc cb) {
 	return wrap([&] {
 		auto channel = getChannel(id);
@@ -516,6 +717,13 @@ bool rtcIsClosed(int id) {
 	return wrap([id] { return getChannel(id)->isClosed() ? 0 : 1; }) == 0 ? true : false;
 }
 
+int rtcMaxMessageSize(int id) {
+	return wrap([id] {
+		auto channel = getChannel(id);
+		return int(channel->maxMessageSize());
+	});
+}
+
 int rtcGetBufferedAmount(int id) {
 	return wrap([id] {
 		auto channel = getChannel(id);
@@ -545,28 +753,45 @@ int rtcSetBufferedAmountLowCallback(int id, rtcBufferedAmountLowCallbackFunc cb)
 	});
 }
 
+int rtcGetChannelMetrics(int id, rtcChannelMetrics *metrics) {
+	return wrap([&] {
+		auto channel = getChannel(id);
+
+		if (!metrics)
+			throw std::invalid_argument("Unexpected null pointer for metrics");
+
+		static_assert(RTC_DISPATCH_LATENCY_BUCKETS ==
+		              std::tuple_size_v<decltype(ChannelMetrics::dispatchLatency)>);
+
+		const auto &m = channel->metrics();
+		metrics->messagesSent = m.messagesSent;
+		metrics->bytesSent = m.bytesSent;
+		metrics->messagesReceived = m.messagesReceived;
+		metrics->bytesReceived = m.bytesReceived;
+		metrics->sendRejected = m.sendRejected;
+		metrics->peakBufferedAmount = m.peakBufferedAmount;
+		std::copy(m.dispatchLatency.begin(), m.dispatchLatency.end(), metrics->dispatchLatency);
+		return RTC_ERR_SUCCESS;
+	});
+}
+
+int rtcResetChannelMetrics(int id) {
+	return wrap([id] {
+		auto channel = getChannel(id);
+		channel->resetMetrics();
+		return RTC_ERR_SUCCESS;
+	});
+}
+
 int rtcCreateDataChannel(int pc, const char *label) {
 	return rtcCreateDataChannelEx(pc, label, nullptr);
 }
 
 int rtcCreateDataChannelEx(int pc, const char *label, const rtcDataChannelInit *init) {
 	return wrap([&] {
-		DataChannelInit dci = {};
-		if (init) {
-			auto *reliability = &init->reliability;
-			dci.reliability.unordered = reliability->unordered;
-			if (reliability->unreliable) {
-				if (reliability->maxPacketLifeTime > 0)
-					dci.reliability.maxPacketLifeTime.emplace(
-					    milliseconds(reliability->maxPacketLifeTime));
-				else
-					dci.reliability.maxRetransmits.emplace(reliability->maxRetransmits);
-			}
-		}
-
 		auto peerConnection = getPeerConnection(pc);
 		int dc = emplaceDataChannel(
-		    peerConnection->createDataChannel(string(label ? label : ""), std::move(dci)));
+		    peerConnection->createDataChannel(string(label ? label : ""), toDataChannelInit(init)));
 
 		if (auto ptr = getUserPointer(pc))
 			rtcSetUserPointer(dc, *ptr);
@@ -575,6 +800,31 @@ int rtcCreateDataChannelEx(int pc, const char *label, const rtcDataChannelInit *
 	});
 }
 
+int rtcCreateDataChannels(int pc, const char **labels, const rtcDataChannelInit *inits, int count,
+                          int *dcs) {
+	return wrap([&] {
+		if (count < 0 || (count > 0 && (!labels || !dcs)))
+			throw std::invalid_argument("Unexpected null pointer for labels or ids");
+
+		std::vector<ChannelSpec> specs;
+		specs.reserve(count);
+		for (int i = 0; i < count; ++i)
+			specs.push_back({string(labels[i] ? labels[i] : ""),
+			                 toDataChannelInit(inits ? &inits[i] : nullptr)});
+
+		auto peerConnection = getPeerConnection(pc);
+		auto channels = peerConnection->createDataChannels(specs);
+
+		auto ptr = getUserPointer(pc);
+		for (int i = 0; i < count; ++i) {
+			dcs[i] = emplaceDataChannel(channels[i]);
+			if (ptr)
+				rtcSetUserPointer(dcs[i], *ptr);
+		}
+		return count;
+	});
+}
+
 int rtcDeleteDataChannel(int dc) {
 	return wrap([dc] {
 		auto dataChannel = getDataChannel(dc);
@@ -584,6 +834,16 @@ int rtcDeleteDataChannel(int dc) {
 	});
 }
 
+int rtcGetDataChannelStream(int dc) {
+	return wrap([dc] {
+		auto dataChannel = getDataChannel(dc);
+		if (auto stream = dataChannel->stream())
+			return int(*stream);
+		else
+			return RTC_ERR_NOT_AVAIL;
+	});
+}
+
 int rtcGetDataChannelLabel(int dc, char *buffer, int size) {
 	return wrap([&] {
 		auto dataChannel = getDataChannel(dc);
@@ -591,6 +851,13 @@ int rtcGetDataChannelLabel(int dc, char *buffer, int size) {
 	});
 }
 
+int rtcGetDataChannelProtocol(int dc, char *buffer, int size) {
+	return wrap([&] {
+		auto dataChannel = getDataChannel(dc);
+		return copyAndReturn(dataChannel->protocol(), buffer, size);
+	});
+}
+
 int rtcGetDataChannelReliability(int dc, rtcReliability *reliability) {
 	return wrap([&] {
 		auto dataChannel = getDataChannel(dc);
@@ -625,6 +892,40 @@ int rtcCreateWebSocket(const char *url) {
 	});
 }
 
+int rtcCreateWebSocketEx(const char *url, const rtcWsConfiguration *config) {
+	return wrap([&] {
+		if (!url)
+			throw std::invalid_argument("Unexpected null pointer for URL");
+
+		if (!config)
+			throw std::invalid_argument("Unexpected null pointer for config");
+
+		WebSocket::Configuration c;
+		for (int i = 0; i < config->protocolsCount; ++i)
+			c.protocols.emplace_back(string(config->protocols[i]));
+
+		if (config->maxMessageSize > 0)
+			c.maxMessageSize = size_t(config->maxMessageSize);
+
+		c.autoReconnect = config->autoReconnect;
+		if (config->reconnectInitialDelayMs > 0)
+			c.reconnectInitialDelay = milliseconds(config->reconnectInitialDelayMs);
+
+		if (config->reconnectMaxDelayMs > 0)
+			c.reconnectMaxDelay = milliseconds(config->reconnectMaxDelayMs);
+
+		if (config->maxReconnectAttempts > 0)
+			c.maxReconnectAttempts = (unsigned int)config->maxReconnectAttempts;
+
+		if (config->reconnectBufferSize > 0)
+			c.reconnectBufferSize = size_t(config->reconnectBufferSize);
+
+		auto webSocket = std::make_shared<WebSocket>(std::move(c));
+		webSocket->open(url);
+		return emplaceWebSocket(webSocket);
+	});
+}
+
 int rtcDeleteWebSocket(int ws) {
 	return wrap([&] {
 		auto webSocket = getWebSocket(ws);
@@ -634,6 +935,24 @@ int rtcDeleteWebSocket(int ws) {
 	});
 }
 
+int rtcGetWebSocketReconnectMetrics(int ws, rtcWsReconnectMetrics *metrics) {
+	return wrap([&] {
+		auto webSocket = getWebSocket(ws);
+
+		if (!metrics)
+			throw std::invalid_argument("Unexpected null pointer for metrics");
+
+		auto m = webSocket->reconnectMetrics();
+		metrics->attempts = m.attempts;
+		metrics->reconnections = m.reconnections;
+		metrics->droppedMessages = m.droppedMessages;
+		metrics->lastLatencyMs = int64_t(m.lastLatency.count());
+		metrics->maxLatencyMs = int64_t(m.maxLatency.count());
+		metrics->totalLatencyMs = int64_t(m.totalLatency.count());
+		return RTC_ERR_SUCCESS;
+	});
+}
+
 #endif
 
 void rtcPreload() {
@@ -652,3 +971,18 @@ void rtcCleanup() {
 	} catch (const std::exception &e) {
 	}
 }
+
+int rtcGetLiveObjectCount() { return wrap([] { return int(rtc::LiveObjectCount()); }); }
+
+int rtcGetHeapStats(rtcHeapSource source, rtcHeapStats *stats) {
+	return wrap([&] {
+		if (!stats)
+			throw std::invalid_argument("Unexpected null pointer for stats");
+
+		auto s = rtc::GetHeapStats(static_cast<rtc::HeapSource>(source));
+		stats->liveBytes = s.liveBytes;
+		stats->allocations = s.allocations;
+		stats->peakBytes = s.peakBytes;
+		return RTC_ERR_SUCCESS;
+	});
+}
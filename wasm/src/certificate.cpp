@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "certificate.hpp"
+
+extern "C" {
+extern int js_rtcGenerateCertificate(int type);
+extern void js_rtcDeleteCertificate(int cert);
+extern int js_rtcIsCertificateReady(int cert);
+extern void js_rtcPreloadCertificate(int type);
+}
+
+namespace rtc {
+
+shared_ptr<Certificate> Certificate::Generate(CertificateType type) {
+	int id = js_rtcGenerateCertificate(int(type));
+	if (!id)
+		throw std::runtime_error("Certificate generation not supported");
+
+	return shared_ptr<Certificate>(new Certificate(id, type));
+}
+
+void Certificate::Preload(CertificateType type) { js_rtcPreloadCertificate(int(type)); }
+
+Certificate::Certificate(int id, CertificateType type) : mId(id), mType(type) {}
+
+Certificate::~Certificate() { js_rtcDeleteCertificate(mId); }
+
+CertificateType Certificate::type() const { return mType; }
+
+bool Certificate::isReady() const { return js_rtcIsCertificateReady(mId) != 0; }
+
+} // namespace rtc
@@ -22,12 +22,16 @@
 
 #include "channel.hpp"
 
+#include <chrono>
+
 namespace rtc {
 
 using std::function;
 
 size_t Channel::bufferedAmount() const { return 0; /* Dummy */ }
 
+size_t Channel::maxMessageSize() const { return DEFAULT_MAX_MESSAGE_SIZE; }
+
 void Channel::onOpen(std::function<void()> callback) { mOpenCallback = std::move(callback); }
 
 void Channel::onClosed(std::function<void()> callback) { mClosedCallback = std::move(callback); }
@@ -55,6 +59,10 @@ void Channel::onBufferedAmountLow(std::function<void()> callback) {
 void Channel::setBufferedAmountLowThreshold(size_t amount) { /* Dummy */
 }
 
+const ChannelMetrics &Channel::metrics() const { return mMetrics; }
+
+void Channel::resetMetrics() { mMetrics = ChannelMetrics(); }
+
 void Channel::triggerOpen() {
 	if (mOpenCallback)
 		mOpenCallback();
@@ -71,8 +79,22 @@ void Channel::triggerError(string error) {
 }
 
 void Channel::triggerMessage(const message_variant data) {
-	if (mMessageCallback)
-		mMessageCallback(data);
+	mMetrics.messagesReceived++;
+	mMetrics.bytesReceived += std::visit([](const auto &d) { return d.size(); }, data);
+
+	if (!mMessageCallback)
+		return;
+
+	using clock = std::chrono::steady_clock;
+	auto start = clock::now();
+	mMessageCallback(data);
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+
+	const auto &bounds = ChannelMetrics::DispatchLatencyBounds;
+	size_t bucket = 0;
+	while (bucket < bounds.size() && elapsed.count() >= bounds[bucket])
+		++bucket;
+	mMetrics.dispatchLatency[bucket]++;
 }
 
 void Channel::triggerBufferedAmountLow() {
@@ -80,4 +102,16 @@ void Channel::triggerBufferedAmountLow() {
 		mBufferedAmountLowCallback();
 }
 
+void Channel::recordSent(size_t size) {
+	mMetrics.messagesSent++;
+	mMetrics.bytesSent += size;
+}
+
+void Channel::recordSendRejected() { mMetrics.sendRejected++; }
+
+void Channel::recordBufferedAmount(size_t amount) {
+	if (amount > mMetrics.peakBufferedAmount)
+		mMetrics.peakBufferedAmount = amount;
+}
+
 } // namespace rtc
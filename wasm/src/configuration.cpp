@@ -24,6 +24,24 @@
 
 namespace rtc {
 
+namespace {
+
+bool isLinkLocal(std::string_view address) {
+	if (address.substr(0, 8) == "169.254.")
+		return true;
+
+	// fe80::/10 covers fe80 to febf
+	if (address.find(':') != std::string_view::npos && (address[0] == 'f' || address[0] == 'F') &&
+	    (address[1] == 'e' || address[1] == 'E')) {
+		char c = address[2];
+		return c == '8' || c == '9' || c == 'a' || c == 'A' || c == 'b' || c == 'B';
+	}
+
+	return false;
+}
+
+} // namespace
+
 IceServer::IceServer(const string &url) : hostname(url), port(0), type(Type::Dummy) {}
 
 IceServer::IceServer(string hostname_, uint16_t port_)
@@ -54,4 +72,51 @@ IceServer::IceServer(string hostname_, string service_, string username_, string
 	}
 }
 
+bool CandidateFilter::acceptsAll() const {
+	return udp && tcp && host && serverReflexive && peerReflexive && relayed && ipv6 &&
+	       linkLocal && !custom;
+}
+
+bool CandidateFilter::accept(const Candidate &candidate) const {
+	// Candidates which can't be parsed are kept, the browser will decide
+	if (!candidate.isParsed())
+		return custom ? custom(candidate) : true;
+
+	using TransportType = Candidate::TransportType;
+	TransportType transportType = candidate.transportType();
+	if (!udp && transportType == TransportType::Udp)
+		return false;
+	if (!tcp && transportType != TransportType::Udp && transportType != TransportType::Unknown)
+		return false;
+
+	switch (candidate.type()) {
+	case Candidate::Type::Host:
+		if (!host)
+			return false;
+		break;
+	case Candidate::Type::ServerReflexive:
+		if (!serverReflexive)
+			return false;
+		break;
+	case Candidate::Type::PeerReflexive:
+		if (!peerReflexive)
+			return false;
+		break;
+	case Candidate::Type::Relayed:
+		if (!relayed)
+			return false;
+		break;
+	default:
+		break;
+	}
+
+	std::string_view address = candidate.address();
+	if (!ipv6 && address.find(':') != std::string_view::npos)
+		return false;
+	if (!linkLocal && isLinkLocal(address))
+		return false;
+
+	return custom ? custom(candidate) : true;
+}
+
 } // namespace rtc
@@ -21,6 +21,7 @@
  */
 
 #include "datachannel.hpp"
+#include "trace.hpp"
 
 #include <emscripten/emscripten.h>
 
@@ -31,6 +32,8 @@
 extern "C" {
 extern void js_rtcDeleteDataChannel(int dc);
 extern int js_rtcGetDataChannelLabel(int dc, char *buffer, int size);
+extern int js_rtcGetDataChannelProtocol(int dc, char *buffer, int size);
+extern int js_rtcGetDataChannelStream(int dc);
 extern int js_rtcGetDataChannelUnordered(int dc);
 extern int js_rtcGetDataChannelMaxPacketLifeTime(int dc);
 extern int js_rtcGetDataChannelMaxRetransmits(int dc);
@@ -49,18 +52,21 @@ namespace rtc {
 using std::function;
 
 void DataChannel::OpenCallback(void *ptr) {
+	RTC_TRACE_SCOPE("DataChannel::OpenCallback");
 	DataChannel *d = static_cast<DataChannel *>(ptr);
 	if (d)
 		d->triggerOpen();
 }
 
 void DataChannel::ErrorCallback(const char *error, void *ptr) {
+	RTC_TRACE_SCOPE("DataChannel::ErrorCallback");
 	DataChannel *d = static_cast<DataChannel *>(ptr);
 	if (d)
 		d->triggerError(string(error ? error : "unknown"));
 }
 
 void DataChannel::MessageCallback(const char *data, int size, void *ptr) {
+	RTC_TRACE_SCOPE("DataChannel::MessageCallback");
 	DataChannel *d = static_cast<DataChannel *>(ptr);
 	if (d) {
 		if (data) {
@@ -78,6 +84,7 @@ void DataChannel::MessageCallback(const char *data, int size, void *ptr) {
 }
 
 void DataChannel::BufferedAmountLowCallback(void *ptr) {
+	RTC_TRACE_SCOPE("DataChannel::BufferedAmountLowCallback");
 	DataChannel *d = static_cast<DataChannel *>(ptr);
 	if (d) {
 		d->triggerBufferedAmountLow();
@@ -96,6 +103,8 @@ DataChannel::DataChannel(int id) : mId(id), mConnected(false) {
 	mLabel = str;
 }
 
+DataChannel::DataChannel(string label) : mId(0), mLabel(std::move(label)), mConnected(false) {}
+
 DataChannel::~DataChannel() { close(); }
 
 void DataChannel::close() {
@@ -107,23 +116,30 @@ void DataChannel::close() {
 }
 
 bool DataChannel::send(message_variant message) {
-	if (!mId)
-		return false;
-
 	return std::visit(
 	    overloaded{[this](const binary &b) {
 		               auto data = reinterpret_cast<const char *>(b.data());
-		               return js_rtcSendMessage(mId, data, int(b.size())) >= 0;
+		               return sendMessage(data, int(b.size()), b.size());
 	               },
-	               [this](const string &s) { return js_rtcSendMessage(mId, s.c_str(), -1) >= 0; }},
+	               [this](const string &s) { return sendMessage(s.c_str(), -1, s.size()); }},
 	    std::move(message));
 }
 
 bool DataChannel::send(const byte *data, size_t size) {
-	if (!mId)
+	return sendMessage(reinterpret_cast<const char *>(data), int(size), size);
+}
+
+bool DataChannel::sendMessage(const char *data, int size, size_t length) {
+	// On success, the browser returns the buffered amount after sending
+	int ret = mId ? js_rtcSendMessage(mId, data, size) : -1;
+	if (ret < 0) {
+		recordSendRejected();
 		return false;
+	}
 
-	return js_rtcSendMessage(mId, reinterpret_cast<const char *>(data), int(size)) >= 0;
+	recordSent(length);
+	recordBufferedAmount(size_t(ret));
+	return true;
 }
 
 bool DataChannel::isOpen() const { return mConnected; }
@@ -141,8 +157,32 @@ size_t DataChannel::bufferedAmount() const {
 	return size_t(ret);
 }
 
+optional<uint16_t> DataChannel::stream() const {
+	if (!mId)
+		return nullopt;
+
+	// The stream ID is only known once the SCTP transport is up
+	int stream = js_rtcGetDataChannelStream(mId);
+	return stream >= 0 ? std::make_optional(uint16_t(stream)) : nullopt;
+}
+
+optional<uint16_t> DataChannel::id() const { return stream(); }
+
 std::string DataChannel::label() const { return mLabel; }
 
+std::string DataChannel::protocol() const {
+	if (!mId)
+		return "";
+
+	int size = js_rtcGetDataChannelProtocol(mId, nullptr, 0);
+	if (size <= 0)
+		return "";
+
+	string protocol(size_t(size), '\0');
+	js_rtcGetDataChannelProtocol(mId, protocol.data(), size + 1);
+	return protocol;
+}
+
 Reliability DataChannel::reliability() const {
 	Reliability reliability = {};
 
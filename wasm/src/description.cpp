@@ -22,30 +22,394 @@
 
 #include "description.hpp"
 
-#include <unordered_map>
+#include <sstream>
 
 namespace rtc {
 
-Description::Description(const string &sdp, Type type) : mSdp(sdp), mType(typeToString(type)) {}
+namespace {
+
+using std::string_view;
+
+const uint8_t COMPACT_VERSION = 2;
+
+const char *const FingerprintAlgorithms[] = {"sha-256", "sha-1", "sha-384", "sha-512"};
+const char *const SetupRoles[] = {"actpass", "active", "passive"};
+
+const uint8_t FLAG_TRICKLE = 0x01;
+const uint8_t FLAG_END_OF_CANDIDATES = 0x02;
+
+bool startsWith(string_view str, string_view prefix) {
+	return str.size() >= prefix.size() && str.substr(0, prefix.size()) == prefix;
+}
+
+// Calls func for each line of the SDP without the line terminator
+template <typename F> void forEachLine(string_view sdp, F func) {
+	while (!sdp.empty()) {
+		size_t pos = sdp.find('\n');
+		string_view line = sdp.substr(0, pos);
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+
+		if (!line.empty())
+			func(line);
+
+		if (pos == string_view::npos)
+			break;
+
+		sdp.remove_prefix(pos + 1);
+	}
+}
+
+optional<uint64_t> parseUInt(string_view str) {
+	if (str.empty())
+		return nullopt;
+
+	uint64_t value = 0;
+	for (char c : str) {
+		if (c < '0' || c > '9')
+			return nullopt;
+		value = value * 10 + uint64_t(c - '0');
+	}
+	return value;
+}
+
+int hexValue(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	throw std::invalid_argument("Invalid fingerprint in description");
+}
+
+void writeVarint(binary &out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back(byte(uint8_t(value) | 0x80));
+		value >>= 7;
+	}
+	out.push_back(byte(uint8_t(value)));
+}
+
+void writeString(binary &out, string_view str) {
+	writeVarint(out, str.size());
+	for (char c : str)
+		out.push_back(byte(c));
+}
+
+class CompactReader {
+public:
+	explicit CompactReader(const binary &data) : mData(data), mPos(0) {}
+
+	uint8_t readByte() {
+		if (mPos >= mData.size())
+			throw std::invalid_argument("Truncated compact description");
+		return std::to_integer<uint8_t>(mData[mPos++]);
+	}
+
+	uint64_t readVarint() {
+		uint64_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint8_t b = readByte();
+			value |= uint64_t(b & 0x7F) << shift;
+			if (!(b & 0x80))
+				return value;
+		}
+		throw std::invalid_argument("Invalid compact description");
+	}
+
+	string readString() {
+		uint64_t size = readVarint();
+		if (size > mData.size() - mPos)
+			throw std::invalid_argument("Truncated compact description");
+		string str(reinterpret_cast<const char *>(mData.data() + mPos), size_t(size));
+		mPos += size_t(size);
+		return str;
+	}
+
+private:
+	const binary &mData;
+	size_t mPos;
+};
+
+} // namespace
+
+Description::Description(const string &sdp, Type type) : mSdp(sdp), mType(type) {
+	if (mType == Type::Unspec)
+		mUnknownType = typeToString(mType);
+}
 
 Description::Description(const string &sdp, string typeString)
-    : mSdp(sdp), mType(std::move(typeString)) {}
+    : mSdp(sdp), mType(stringToType(typeString)) {
+	if (mType == Type::Unspec)
+		mUnknownType = std::move(typeString);
+}
+
+Description::Type Description::type() const { return mType; }
+
+string Description::typeString() const {
+	return mType == Type::Unspec ? mUnknownType : typeToString(mType);
+}
+
+optional<string_view> Description::iceUfrag() const { return field(parsed().ufrag); }
+
+optional<string_view> Description::icePwd() const { return field(parsed().pwd); }
+
+optional<string_view> Description::fingerprint() const { return field(parsed().fingerprint); }
 
-Description::Type Description::type() const { return stringToType(mType); }
+optional<uint16_t> Description::sctpPort() const { return parsed().sctpPort; }
 
-string Description::typeString() const { return mType; }
+optional<size_t> Description::maxMessageSize() const { return parsed().maxMessageSize; }
+
+size_t Description::candidateCount() const { return parsed().candidateCount; }
+
+std::vector<Candidate> Description::candidates() const {
+	string mid(field(parsed().mid).value_or("0"));
+	std::vector<Candidate> result;
+	result.reserve(parsed().candidateCount);
+	forEachLine(mSdp, [&](string_view line) {
+		if (startsWith(line, "a=candidate:"))
+			result.emplace_back(string(line.substr(2)), mid);
+	});
+	return result;
+}
+
+const Description::Parsed &Description::parsed() const {
+	if (mParsed)
+		return *mParsed;
+
+	Parsed &p = mParsed.emplace();
+	string_view sdp(mSdp);
+	auto locate = [&sdp](string_view value) {
+		return Field{size_t(value.data() - sdp.data()), value.size()};
+	};
+
+	forEachLine(sdp, [&](string_view line) {
+		if (line.size() < 2 || line[1] != '=')
+			return;
+
+		switch (line[0]) {
+		case 'o': {
+			// o=<username> <sess-id> <sess-version> IN IP4 <address>
+			size_t first = line.find(' ');
+			size_t second = first != string_view::npos ? line.find(' ', first + 1) : first;
+			if (second == string_view::npos)
+				break;
+			p.username = locate(line.substr(2, first - 2));
+			size_t third = line.find(' ', second + 1);
+			p.sessionId = parseUInt(line.substr(first + 1, second - first - 1)).value_or(0);
+			p.sessionVersion = parseUInt(line.substr(second + 1, third - second - 1)).value_or(0);
+			break;
+		}
+		case 'm':
+			if (startsWith(line, "m=application "))
+				++p.applicationCount;
+			else
+				++p.otherMediaCount;
+			break;
+		case 'a':
+			if (startsWith(line, "a=candidate:")) {
+				++p.candidateCount;
+			} else if (startsWith(line, "a=ice-ufrag:")) {
+				p.ufrag = locate(line.substr(12));
+			} else if (startsWith(line, "a=ice-pwd:")) {
+				p.pwd = locate(line.substr(10));
+			} else if (startsWith(line, "a=fingerprint:")) {
+				if (p.fingerprintCount++ == 0)
+					p.fingerprint = locate(line.substr(14));
+			} else if (startsWith(line, "a=setup:")) {
+				p.setup = locate(line.substr(8));
+			} else if (startsWith(line, "a=mid:")) {
+				p.mid = locate(line.substr(6));
+			} else if (startsWith(line, "a=sctp-port:")) {
+				if (auto port = parseUInt(line.substr(12)); port && *port <= 65535)
+					p.sctpPort = uint16_t(*port);
+			} else if (startsWith(line, "a=max-message-size:")) {
+				if (auto size = parseUInt(line.substr(19)))
+					p.maxMessageSize = size_t(*size);
+			} else if (startsWith(line, "a=ice-options:")) {
+				p.iceOptions = locate(line.substr(14));
+				p.trickle = line.find("trickle") != string_view::npos;
+			} else if (line == "a=end-of-candidates") {
+				p.endOfCandidates = true;
+			}
+			break;
+		default:
+			break;
+		}
+	});
+
+	return p;
+}
+
+optional<string_view> Description::field(const Field &f) const {
+	if (f.pos == string::npos)
+		return nullopt;
+
+	return string_view(mSdp).substr(f.pos, f.len);
+}
 
 Description::operator string() const { return mSdp; }
 
+binary Description::encodeCompact() const {
+	const Parsed &p = parsed();
+	if (p.applicationCount != 1 || p.otherMediaCount != 0)
+		throw std::invalid_argument("Only data channel descriptions can be made compact");
+
+	// Reject what decoding would not reproduce rather than silently changing it
+	if (mType == Type::Unspec && mUnknownType != typeToString(Type::Unspec))
+		throw std::invalid_argument("Unknown description type can't be made compact");
+	if (p.fingerprintCount != 1)
+		throw std::invalid_argument("Only descriptions with one fingerprint can be made compact");
+	if (auto options = field(p.iceOptions); options && *options != "trickle")
+		throw std::invalid_argument("Description ICE options can't be made compact");
+	if (!field(p.ufrag) || !field(p.pwd))
+		throw std::invalid_argument("Description without ICE credentials can't be made compact");
+
+	uint8_t flags = 0;
+	if (p.trickle)
+		flags |= FLAG_TRICKLE;
+	if (p.endOfCandidates)
+		flags |= FLAG_END_OF_CANDIDATES;
+
+	string_view setup = field(p.setup).value_or("");
+	string_view fingerprint = field(p.fingerprint).value_or("");
+
+	binary out;
+	out.reserve(128 + 64 * p.candidateCount);
+	out.push_back(byte(COMPACT_VERSION));
+	out.push_back(byte(uint8_t(mType)));
+	out.push_back(byte(flags));
+	writeString(out, field(p.username).value_or("-"));
+	writeVarint(out, p.sessionId);
+	writeVarint(out, p.sessionVersion);
+	writeString(out, *field(p.ufrag));
+	writeString(out, *field(p.pwd));
+	writeString(out, field(p.mid).value_or(""));
+
+	uint8_t setupIndex = 0;
+	while (setupIndex < 3 && setup != SetupRoles[setupIndex])
+		++setupIndex;
+	if (setupIndex == 3)
+		throw std::invalid_argument("Unsupported setup role in description");
+	out.push_back(byte(setupIndex));
+
+	// The fingerprint is stored as raw bytes, halving its size
+	size_t space = fingerprint.find(' ');
+	string_view algorithm = fingerprint.substr(0, space);
+	string_view hex = space != string_view::npos ? fingerprint.substr(space + 1) : string_view();
+	uint8_t algorithmIndex = 0;
+	while (algorithmIndex < 4 && algorithm != FingerprintAlgorithms[algorithmIndex])
+		++algorithmIndex;
+	if (algorithmIndex == 4)
+		throw std::invalid_argument("Unsupported fingerprint algorithm in description");
+
+	// Expect colon-separated pairs of hex digits, as anything else would not be reproduced
+	if (hex.empty() || hex.size() % 3 != 2)
+		throw std::invalid_argument("Invalid fingerprint in description");
+
+	out.push_back(byte(algorithmIndex));
+	writeVarint(out, (hex.size() + 1) / 3);
+	for (size_t i = 0; i < hex.size(); i += 3) {
+		if (i + 2 < hex.size() && hex[i + 2] != ':')
+			throw std::invalid_argument("Invalid fingerprint in description");
+		out.push_back(byte(uint8_t(hexValue(hex[i]) << 4 | hexValue(hex[i + 1]))));
+	}
+
+	writeVarint(out, p.sctpPort.value_or(0));
+	writeVarint(out, p.maxMessageSize.value_or(0));
+
+	writeVarint(out, p.candidateCount);
+	forEachLine(mSdp, [&out](string_view line) {
+		if (startsWith(line, "a=candidate:"))
+			writeString(out, line.substr(2));
+	});
+
+	return out;
+}
+
+Description Description::decodeCompact(const binary &data) {
+	CompactReader reader(data);
+	if (reader.readByte() != COMPACT_VERSION)
+		throw std::invalid_argument("Unsupported compact description version");
+
+	uint8_t type = reader.readByte();
+	if (type > uint8_t(Type::Rollback))
+		throw std::invalid_argument("Invalid compact description type");
+
+	uint8_t flags = reader.readByte();
+	string username = reader.readString();
+	uint64_t sessionId = reader.readVarint();
+	uint64_t sessionVersion = reader.readVarint();
+	string ufrag = reader.readString();
+	string pwd = reader.readString();
+	string mid = reader.readString();
+
+	uint8_t setupIndex = reader.readByte();
+	uint8_t algorithmIndex = reader.readByte();
+	if (setupIndex >= 3 || algorithmIndex >= 4)
+		throw std::invalid_argument("Invalid compact description");
+
+	static const char *const HexDigits = "0123456789ABCDEF";
+	uint64_t fingerprintSize = reader.readVarint();
+	string fingerprint;
+	fingerprint.reserve(size_t(fingerprintSize) * 3);
+	for (uint64_t i = 0; i < fingerprintSize; ++i) {
+		uint8_t b = reader.readByte();
+		if (i > 0)
+			fingerprint += ':';
+		fingerprint += HexDigits[b >> 4];
+		fingerprint += HexDigits[b & 0x0F];
+	}
+
+	uint64_t sctpPort = reader.readVarint();
+	uint64_t maxMessageSize = reader.readVarint();
+
+	std::ostringstream sdp;
+	const char *eol = "\r\n";
+	sdp << "v=0" << eol;
+	sdp << "o=" << username << " " << sessionId << " " << sessionVersion << " IN IP4 127.0.0.1" << eol;
+	sdp << "s=-" << eol;
+	sdp << "t=0 0" << eol;
+	sdp << "a=group:BUNDLE " << mid << eol;
+	sdp << "a=msid-semantic: WMS" << eol;
+	sdp << "m=application 9 UDP/DTLS/SCTP webrtc-datachannel" << eol;
+	sdp << "c=IN IP4 0.0.0.0" << eol;
+
+	uint64_t candidateCount = reader.readVarint();
+	for (uint64_t i = 0; i < candidateCount; ++i)
+		sdp << "a=" << reader.readString() << eol;
+
+	if (flags & FLAG_END_OF_CANDIDATES)
+		sdp << "a=end-of-candidates" << eol;
+
+	sdp << "a=ice-ufrag:" << ufrag << eol;
+	sdp << "a=ice-pwd:" << pwd << eol;
+	if (flags & FLAG_TRICKLE)
+		sdp << "a=ice-options:trickle" << eol;
+
+	sdp << "a=fingerprint:" << FingerprintAlgorithms[algorithmIndex] << " " << fingerprint << eol;
+	sdp << "a=setup:" << SetupRoles[setupIndex] << eol;
+	sdp << "a=mid:" << mid << eol;
+	if (sctpPort)
+		sdp << "a=sctp-port:" << sctpPort << eol;
+	if (maxMessageSize)
+		sdp << "a=max-message-size:" << maxMessageSize << eol;
+
+	return Description(sdp.str(), static_cast<Type>(type));
+}
+
 Description::Type Description::stringToType(const string &typeString) {
-	using TypeMap_t = std::unordered_map<string, Type>;
-	static const TypeMap_t TypeMap = {{"unspec", Type::Unspec},
-	                                  {"offer", Type::Offer},
-	                                  {"answer", Type::Answer},
-	                                  {"pranswer", Type::Pranswer},
-	                                  {"rollback", Type::Rollback}};
-	auto it = TypeMap.find(typeString);
-	return it != TypeMap.end() ? it->second : Type::Unspec;
+	if (typeString == "offer")
+		return Type::Offer;
+	if (typeString == "answer")
+		return Type::Answer;
+	if (typeString == "pranswer")
+		return Type::Pranswer;
+	if (typeString == "rollback")
+		return Type::Rollback;
+
+	return Type::Unspec;
 }
 
 string Description::typeToString(Type type) {
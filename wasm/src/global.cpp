@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "global.hpp"
+#include "certificate.hpp"
+
+extern "C" {
+extern int js_rtcGetLiveObjectCount();
+extern void js_rtcGetHeapStats(int source, double *pStats);
+}
+
+namespace rtc {
+
+void Preload() { Certificate::Preload(CertificateType::Default); }
+
+void Cleanup() { /* Dummy */ }
+
+size_t LiveObjectCount() { return size_t(js_rtcGetLiveObjectCount()); }
+
+HeapStats GetHeapStats(HeapSource source) {
+	double buffer[3] = {};
+	js_rtcGetHeapStats(int(source), buffer);
+
+	HeapStats stats;
+	stats.liveBytes = uint64_t(buffer[0]);
+	stats.allocations = uint64_t(buffer[1]);
+	stats.peakBytes = uint64_t(buffer[2]);
+	return stats;
+}
+
+} // namespace rtc
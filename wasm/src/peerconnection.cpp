@@ -21,6 +21,8 @@
  */
 
 #include "peerconnection.hpp"
+#include "certificate.hpp"
+#include "trace.hpp"
 
 #include <emscripten/emscripten.h>
 
@@ -30,29 +32,56 @@
 
 extern "C" {
 extern int js_rtcCreatePeerConnection(const char **pUrls, const char **pUsernames,
-                                   const char **pPasswords, int nIceServers);
+                                   const char **pPasswords, int nIceServers,
+                                   bool disableAutoNegotiation, int candidateSignaling,
+                                   int candidateBatchInterval, int maxGatheringDelay,
+                                   int iceTransportPolicy, int bundlePolicy, int rtcpMuxPolicy,
+                                   int iceCandidatePoolSize, int certificate,
+                                   int certificateType);
+extern void js_rtcClosePeerConnection(int pc);
 extern void js_rtcDeletePeerConnection(int pc);
+extern void js_rtcRestartIce(int pc);
+extern void js_rtcFree(void *ptr);
 extern char *js_rtcGetLocalDescription(int pc);
 extern char *js_rtcGetLocalDescriptionType(int pc);
 extern char *js_rtcGetRemoteDescription(int pc);
 extern char *js_rtcGetRemoteDescriptionType(int pc);
 extern int js_rtcCreateDataChannel(int pc, const char *label, bool unordered, int maxRetransmits,
-                                int maxPacketLifeTime);
+                                int maxPacketLifeTime, const char *protocol, bool negotiated,
+                                int stream);
+extern int js_rtcCreateDataChannels(int pc, int count, const char **pLabels, const char **pProtocols,
+                                    const int *pParams, void **pUserPointers,
+                                    void (*openCallback)(void *),
+                                    void (*errorCallback)(const char *, void *),
+                                    void (*messageCallback)(const char *, int, void *),
+                                    void (*bufferedAmountLowCallback)(void *), int *pIds);
 extern void js_rtcSetDataChannelCallback(int pc, void (*dataChannelCallback)(int, void *));
 extern void js_rtcSetLocalDescriptionCallback(int pc,
                                            void (*descriptionCallback)(const char *, const char *,
                                                                        void *));
 extern void js_rtcSetLocalCandidateCallback(int pc, void (*candidateCallback)(const char *,
                                                                            const char *, void *));
+extern void js_rtcSetLocalCandidatesCallback(int pc, void (*candidatesCallback)(const char *, int,
+                                                                             void *));
 extern void js_rtcSetStateChangeCallback(int pc, void (*stateChangeCallback)(int, void *));
 extern void js_rtcSetIceStateChangeCallback(int pc, void (*iceStateChangeCallback)(int, void *));
 extern void js_rtcSetGatheringStateChangeCallback(int pc,
                                                void (*gatheringStateChangeCallback)(int, void *));
 extern void js_rtcSetSignalingStateChangeCallback(int pc,
                                                void (*signalingStateChangeCallback)(int, void *));
+extern void js_rtcSetSelectedCandidatePairChangeCallback(
+    int pc, void (*selectedCandidatePairChangeCallback)(void *));
+extern void js_rtcSetLocalDescription(int pc, const char *type, const char *iceUfrag,
+                                      const char *icePwd);
+extern int js_rtcIsNegotiationNeeded(int pc);
 extern void js_rtcSetRemoteDescription(int pc, const char *sdp, const char *type);
 extern void js_rtcAddRemoteCandidate(int pc, const char *candidate, const char *mid);
 extern void js_rtcSetUserPointer(int i, void *ptr);
+extern void js_rtcStartStats(int pc, double *pBuffer, int interval);
+extern int js_rtcGetSelectedCandidatePair(int pc, char *local, int localSize, char *remote,
+                                          int remoteSize);
+extern int js_rtcGetLocalAddress(int pc, char *buffer, int size);
+extern int js_rtcGetRemoteAddress(int pc, char *buffer, int size);
 }
 
 namespace rtc {
@@ -60,49 +89,133 @@ namespace rtc {
 using std::function;
 using std::vector;
 
+namespace {
+
+struct DataChannelParams {
+	int maxRetransmits;
+	int maxPacketLifeTime;
+	int stream;
+};
+
+DataChannelParams checkDataChannelInit(const DataChannelInit &init) {
+	const Reliability &reliability = init.reliability;
+	if (reliability.maxPacketLifeTime && reliability.maxRetransmits)
+		throw std::invalid_argument("Both maxPacketLifeTime and maxRetransmits are set");
+
+	if (init.negotiated && !init.id)
+		throw std::invalid_argument("A negotiated DataChannel requires a stream ID");
+
+	if (init.id && *init.id > 65534)
+		throw std::invalid_argument("Invalid DataChannel stream ID");
+
+	DataChannelParams params;
+	params.maxRetransmits = reliability.maxRetransmits ? int(*reliability.maxRetransmits) : -1;
+	params.maxPacketLifeTime =
+	    reliability.maxPacketLifeTime ? int(reliability.maxPacketLifeTime->count()) : -1;
+	params.stream = init.id ? int(*init.id) : -1;
+	return params;
+}
+
+} // namespace
+
 void PeerConnection::DataChannelCallback(int dc, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::DataChannelCallback");
 	PeerConnection *p = static_cast<PeerConnection *>(ptr);
 	if (p)
 		p->triggerDataChannel(std::make_shared<DataChannel>(dc));
 }
 
 void PeerConnection::DescriptionCallback(const char *sdp, const char *type, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::DescriptionCallback");
 	PeerConnection *p = static_cast<PeerConnection *>(ptr);
-	if (p)
-		p->triggerLocalDescription(Description(sdp, type));
+	if (!p)
+		return;
+
+	// Unless candidates are only embedded in the description, they were already counted when
+	// trickled
+	bool embedded = p->mCandidateSignaling == Configuration::CandidateSignaling::NonTrickle;
+	p->triggerLocalDescription(p->filterCandidates(
+	    Description(sdp, type), embedded ? &p->mLocalCandidatesDropped : nullptr));
 }
 
 void PeerConnection::CandidateCallback(const char *candidate, const char *mid, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::CandidateCallback");
 	PeerConnection *p = static_cast<PeerConnection *>(ptr);
-	if (p)
-		p->triggerLocalCandidate(Candidate(candidate, mid));
+	if (!p)
+		return;
+
+	Candidate cand(candidate, mid);
+	if (!p->mCandidateFilter.accept(cand)) {
+		++p->mLocalCandidatesDropped;
+		return;
+	}
+	p->triggerLocalCandidate(cand);
+}
+
+void PeerConnection::CandidatesCallback(const char *buffer, int count, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::CandidatesCallback");
+	PeerConnection *p = static_cast<PeerConnection *>(ptr);
+	if (!p)
+		return;
+
+	// The batch is packed as consecutive null-terminated candidate and mid strings
+	vector<Candidate> candidates;
+	candidates.reserve(count);
+	for (int i = 0; i < count; ++i) {
+		string candidate(buffer);
+		buffer += candidate.size() + 1;
+		string mid(buffer);
+		buffer += mid.size() + 1;
+		Candidate cand(candidate, mid);
+		if (p->mCandidateFilter.accept(cand))
+			candidates.push_back(std::move(cand));
+		else
+			++p->mLocalCandidatesDropped;
+	}
+	if (!candidates.empty())
+		p->triggerLocalCandidates(candidates);
 }
 
 void PeerConnection::StateChangeCallback(int state, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::StateChangeCallback");
 	PeerConnection *p = static_cast<PeerConnection *>(ptr);
 	if (p)
 		p->triggerStateChange(static_cast<State>(state));
 }
 
 void PeerConnection::IceStateChangeCallback(int state, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::IceStateChangeCallback");
 	PeerConnection *p = static_cast<PeerConnection *>(ptr);
 	if (p)
 		p->triggerIceStateChange(static_cast<IceState>(state));
 }
 
 void PeerConnection::GatheringStateChangeCallback(int state, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::GatheringStateChangeCallback");
 	PeerConnection *p = static_cast<PeerConnection *>(ptr);
 	if (p)
 		p->triggerGatheringStateChange(static_cast<GatheringState>(state));
 }
 
 void PeerConnection::SignalingStateChangeCallback(int state, void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::SignalingStateChangeCallback");
 	PeerConnection *p = static_cast<PeerConnection *>(ptr);
 	if (p)
 		p->triggerSignalingStateChange(static_cast<SignalingState>(state));
 }
 
-PeerConnection::PeerConnection(const Configuration &config) {
+void PeerConnection::SelectedCandidatePairChangeCallback(void *ptr) {
+	RTC_TRACE_SCOPE("PeerConnection::SelectedCandidatePairChangeCallback");
+	PeerConnection *p = static_cast<PeerConnection *>(ptr);
+	if (p && p->mIceRestarting &&
+	    (p->mIceState == IceState::Connected || p->mIceState == IceState::Completed))
+		p->completeIceRestart();
+}
+
+PeerConnection::PeerConnection() : PeerConnection(Configuration()) {}
+
+PeerConnection::PeerConnection(const Configuration &config)
+    : mCandidateFilter(config.candidateFilter), mCandidateSignaling(config.candidateSignaling) {
 	vector<string> urls;
 	urls.reserve(config.iceServers.size());
 	for (const IceServer &iceServer : config.iceServers) {
@@ -140,7 +253,15 @@ PeerConnection::PeerConnection(const Configuration &config) {
 		password_ptrs.push_back(iceServer.password.c_str());
 	}
 	mId = js_rtcCreatePeerConnection(url_ptrs.data(), username_ptrs.data(), password_ptrs.data(),
-	                              config.iceServers.size());
+	                              config.iceServers.size(), config.disableAutoNegotiation,
+	                              int(config.candidateSignaling),
+	                              int(config.candidateBatchInterval.count()),
+	                              config.maxGatheringDelay ? int(config.maxGatheringDelay->count())
+	                                                       : 0,
+	                              int(config.iceTransportPolicy), int(config.bundlePolicy),
+	                              int(config.rtcpMuxPolicy), int(config.iceCandidatePoolSize),
+	                              config.certificate ? config.certificate->mId : 0,
+	                              int(config.certificateType));
 	if (!mId)
 		throw std::runtime_error("WebRTC not supported");
 
@@ -148,15 +269,25 @@ PeerConnection::PeerConnection(const Configuration &config) {
 	js_rtcSetDataChannelCallback(mId, DataChannelCallback);
 	js_rtcSetLocalDescriptionCallback(mId, DescriptionCallback);
 	js_rtcSetLocalCandidateCallback(mId, CandidateCallback);
+	js_rtcSetLocalCandidatesCallback(mId, CandidatesCallback);
 	js_rtcSetStateChangeCallback(mId, StateChangeCallback);
 	js_rtcSetIceStateChangeCallback(mId, IceStateChangeCallback);
 	js_rtcSetGatheringStateChangeCallback(mId, GatheringStateChangeCallback);
 	js_rtcSetSignalingStateChangeCallback(mId, SignalingStateChangeCallback);
+	js_rtcSetSelectedCandidatePairChangeCallback(mId, SelectedCandidatePairChangeCallback);
 }
 
 PeerConnection::~PeerConnection() { js_rtcDeletePeerConnection(mId); }
 
-void PeerConnection::close() {}
+void PeerConnection::close() {
+	if (mState == State::Closed)
+		return;
+
+	// Closes and unregisters all channels of the connection, whose closed callbacks are called
+	js_rtcClosePeerConnection(mId);
+	mIceRestarting = false;
+	triggerStateChange(State::Closed);
+}
 
 PeerConnection::State PeerConnection::state() const { return mState; }
 
@@ -170,13 +301,13 @@ optional<Description> PeerConnection::localDescription() const {
 	char *sdp = js_rtcGetLocalDescription(mId);
 	char *type = js_rtcGetLocalDescriptionType(mId);
 	if (!sdp || !type) {
-		free(sdp);
-		free(type);
+		js_rtcFree(sdp);
+		js_rtcFree(type);
 		return std::nullopt;
 	}
 	Description description(sdp, type);
-	free(sdp);
-	free(type);
+	js_rtcFree(sdp);
+	js_rtcFree(type);
 	return description;
 }
 
@@ -184,40 +315,260 @@ optional<Description> PeerConnection::remoteDescription() const {
 	char *sdp = js_rtcGetRemoteDescription(mId);
 	char *type = js_rtcGetRemoteDescriptionType(mId);
 	if (!sdp || !type) {
-		free(sdp);
-		free(type);
+		js_rtcFree(sdp);
+		js_rtcFree(type);
 		return std::nullopt;
 	}
 	Description description(sdp, type);
-	free(sdp);
-	free(type);
+	js_rtcFree(sdp);
+	js_rtcFree(type);
 	return description;
 }
 
+bool PeerConnection::negotiationNeeded() const { return js_rtcIsNegotiationNeeded(mId) != 0; }
+
+PeerConnection::Stats PeerConnection::stats() const {
+	startStats();
+
+	Stats stats;
+	stats.timestamp = mStatsBuffer[0];
+	if (mStatsBuffer[1] >= 0)
+		stats.rtt = mStatsBuffer[1];
+	stats.bytesSent = uint64_t(mStatsBuffer[2]);
+	stats.bytesReceived = uint64_t(mStatsBuffer[3]);
+	stats.messagesSent = uint64_t(mStatsBuffer[4]);
+	stats.messagesReceived = uint64_t(mStatsBuffer[5]);
+	return stats;
+}
+
+void PeerConnection::setStatsInterval(std::chrono::milliseconds interval) {
+	mStatsInterval = interval;
+	if (mStatsStarted)
+		js_rtcStartStats(mId, mStatsBuffer.data(), int(mStatsInterval.count()));
+}
+
+optional<double> PeerConnection::rtt() const { return stats().rtt; }
+
+uint64_t PeerConnection::bytesSent() const { return stats().bytesSent; }
+
+uint64_t PeerConnection::bytesReceived() const { return stats().bytesReceived; }
+
+bool PeerConnection::getSelectedCandidatePair(Candidate *local, Candidate *remote) const {
+	startStats();
+
+	char localBuffer[256];
+	char remoteBuffer[256];
+	if (js_rtcGetSelectedCandidatePair(mId, localBuffer, 256, remoteBuffer, 256) <= 0)
+		return false;
+
+	if (local)
+		*local = Candidate(localBuffer, "");
+	if (remote)
+		*remote = Candidate(remoteBuffer, "");
+	return true;
+}
+
+optional<string> PeerConnection::localAddress() const {
+	startStats();
+
+	char buffer[64];
+	if (js_rtcGetLocalAddress(mId, buffer, 64) <= 0)
+		return nullopt;
+
+	return string(buffer);
+}
+
+optional<string> PeerConnection::remoteAddress() const {
+	startStats();
+
+	char buffer[64];
+	if (js_rtcGetRemoteAddress(mId, buffer, 64) <= 0)
+		return nullopt;
+
+	return string(buffer);
+}
+
+void PeerConnection::startStats() const {
+	if (mStatsStarted)
+		return;
+
+	mStatsBuffer[1] = -1;
+	mStatsStarted = true;
+	js_rtcStartStats(mId, mStatsBuffer.data(), int(mStatsInterval.count()));
+}
+
 shared_ptr<DataChannel> PeerConnection::createDataChannel(const string &label,
                                                           DataChannelInit init) {
-	const Reliability &reliability = init.reliability;
-	if (reliability.maxPacketLifeTime && reliability.maxRetransmits)
-		throw std::invalid_argument("Both maxPacketLifeTime and maxRetransmits are set");
+	DataChannelParams params = checkDataChannelInit(init);
+	int dc = js_rtcCreateDataChannel(mId, label.c_str(), init.reliability.unordered,
+	                                 params.maxRetransmits, params.maxPacketLifeTime,
+	                                 init.protocol.c_str(), init.negotiated, params.stream);
+	if (!dc)
+		throw std::runtime_error("DataChannel creation failed");
+
+	return std::make_shared<DataChannel>(dc);
+}
 
-	int maxRetransmits = reliability.maxRetransmits ? int(*reliability.maxRetransmits) : -1;
-	int maxPacketLifeTime =
-	    reliability.maxPacketLifeTime ? int(reliability.maxPacketLifeTime->count()) : -1;
+vector<shared_ptr<DataChannel>>
+PeerConnection::createDataChannels(const vector<ChannelSpec> &specs) {
+	vector<shared_ptr<DataChannel>> channels;
+	if (specs.empty())
+		return channels;
+
+	vector<const char *> labels;
+	vector<const char *> protocols;
+	vector<int> params;
+	vector<void *> userPointers;
+	labels.reserve(specs.size());
+	protocols.reserve(specs.size());
+	params.reserve(specs.size() * 5);
+	userPointers.reserve(specs.size());
+	channels.reserve(specs.size());
+	for (const ChannelSpec &spec : specs) {
+		DataChannelParams p = checkDataChannelInit(spec.init);
+		labels.push_back(spec.label.c_str());
+		protocols.push_back(spec.init.protocol.c_str());
+		params.push_back(spec.init.reliability.unordered ? 1 : 0);
+		params.push_back(p.maxRetransmits);
+		params.push_back(p.maxPacketLifeTime);
+		params.push_back(spec.init.negotiated ? 1 : 0);
+		params.push_back(p.stream);
+
+		// The label is known already, so there is no need to fetch it back from the browser
+		auto channel = shared_ptr<DataChannel>(new DataChannel(spec.label));
+		userPointers.push_back(channel.get());
+		channels.push_back(std::move(channel));
+	}
+
+	vector<int> ids(specs.size(), 0);
+	int count = js_rtcCreateDataChannels(
+	    mId, int(specs.size()), labels.data(), protocols.data(), params.data(), userPointers.data(),
+	    DataChannel::OpenCallback, DataChannel::ErrorCallback, DataChannel::MessageCallback,
+	    DataChannel::BufferedAmountLowCallback, ids.data());
+	if (count != int(specs.size()))
+		throw std::runtime_error("DataChannel creation failed");
+
+	for (size_t i = 0; i < channels.size(); ++i)
+		channels[i]->mId = ids[i];
+
+	return channels;
+}
+
+void PeerConnection::setLocalDescription(Description::Type type, LocalDescriptionInit init) {
+	// An empty type lets the browser side pick an offer or an answer from the signaling state
+	string typeString = type != Description::Type::Unspec ? Description::typeToString(type) : "";
+	js_rtcSetLocalDescription(mId, typeString.c_str(),
+	                          init.iceUfrag ? init.iceUfrag->c_str() : nullptr,
+	                          init.icePwd ? init.icePwd->c_str() : nullptr);
+}
+
+void PeerConnection::restartIce() {
+	startIceRestart();
+	js_rtcRestartIce(mId);
+}
 
-	return std::make_shared<DataChannel>(js_rtcCreateDataChannel(
-	    mId, label.c_str(), init.reliability.unordered, maxRetransmits, maxPacketLifeTime));
+optional<std::chrono::milliseconds> PeerConnection::iceRestartLatency() const {
+	return mIceRestartLatency;
 }
 
-void PeerConnection::setLocalDescription(Description::Type type, LocalDescriptionInit init) {}
+void PeerConnection::startIceRestart() {
+	mIceRestarting = true;
+	mIceRestartChecking = false;
+	mIceRestartTime = emscripten_get_now();
+}
+
+void PeerConnection::checkIceRestart() {
+	if (!mIceRestarting)
+		return;
+
+	switch (mIceState) {
+	case IceState::Failed:
+	case IceState::Closed:
+		mIceRestarting = false;
+		break;
+	case IceState::Checking:
+		mIceRestartChecking = true;
+		break;
+	case IceState::Connected:
+	case IceState::Completed:
+		// Still connected on the previous candidate pair, the description exchange alone does not
+		// mean the new credentials work
+		if (mIceRestartChecking)
+			completeIceRestart();
+		break;
+	default:
+		break;
+	}
+}
+
+void PeerConnection::completeIceRestart() {
+	mIceRestarting = false;
+	mIceRestartChecking = false;
+	mIceRestartLatency =
+	    std::chrono::milliseconds(int64_t(emscripten_get_now() - mIceRestartTime));
+}
 
 void PeerConnection::setRemoteDescription(const Description &description) {
-	js_rtcSetRemoteDescription(mId, string(description).c_str(), description.typeString().c_str());
+	// The answering side never calls restartIce(), so measure from the offer restarting ICE
+	auto ufrag = description.iceUfrag();
+	auto pwd = description.icePwd();
+	if (ufrag && pwd) {
+		if (description.type() == Description::Type::Offer && !mIceRestarting &&
+		    !mRemoteIceUfrag.empty() && (*ufrag != mRemoteIceUfrag || *pwd != mRemoteIcePwd))
+			startIceRestart();
+		mRemoteIceUfrag = string(*ufrag);
+		mRemoteIcePwd = string(*pwd);
+	}
+
+	Description filtered = filterCandidates(description, &mRemoteCandidatesDropped);
+	js_rtcSetRemoteDescription(mId, string(filtered).c_str(), filtered.typeString().c_str());
 }
 
 void PeerConnection::addRemoteCandidate(const Candidate &candidate) {
+	if (!mCandidateFilter.accept(candidate)) {
+		++mRemoteCandidatesDropped;
+		return;
+	}
 	js_rtcAddRemoteCandidate(mId, candidate.candidate().c_str(), candidate.mid().c_str());
 }
 
+void PeerConnection::setCandidateFilter(CandidateFilter filter) {
+	mCandidateFilter = std::move(filter);
+}
+
+uint64_t PeerConnection::localCandidatesDropped() const { return mLocalCandidatesDropped; }
+
+uint64_t PeerConnection::remoteCandidatesDropped() const { return mRemoteCandidatesDropped; }
+
+Description PeerConnection::filterCandidates(const Description &description,
+                                             uint64_t *dropped) const {
+	if (mCandidateFilter.acceptsAll() || description.candidateCount() == 0)
+		return description;
+
+	const string sdp(description);
+	string result;
+	result.reserve(sdp.size());
+	size_t pos = 0;
+	while (pos < sdp.size()) {
+		size_t end = sdp.find('\n', pos);
+		end = end != string::npos ? end + 1 : sdp.size();
+		if (sdp.compare(pos, 12, "a=candidate:") == 0) {
+			size_t len = end - pos;
+			while (len > 0 && (sdp[pos + len - 1] == '\n' || sdp[pos + len - 1] == '\r'))
+				--len;
+			if (!mCandidateFilter.accept(Candidate(sdp.substr(pos + 2, len - 2), ""))) {
+				if (dropped)
+					++*dropped;
+				pos = end;
+				continue;
+			}
+		}
+		result.append(sdp, pos, end - pos);
+		pos = end;
+	}
+	return Description(result, description.typeString());
+}
+
 void PeerConnection::onDataChannel(function<void(shared_ptr<DataChannel>)> callback) {
 	mDataChannelCallback = callback;
 }
@@ -230,6 +581,10 @@ void PeerConnection::onLocalCandidate(function<void(const Candidate &)> callback
 	mLocalCandidateCallback = callback;
 }
 
+void PeerConnection::onLocalCandidates(function<void(const vector<Candidate> &)> callback) {
+	mLocalCandidatesCallback = callback;
+}
+
 void PeerConnection::onStateChange(function<void(State state)> callback) {
 	mStateChangeCallback = callback;
 }
@@ -261,6 +616,16 @@ void PeerConnection::triggerLocalCandidate(const Candidate &candidate) {
 		mLocalCandidateCallback(candidate);
 }
 
+void PeerConnection::triggerLocalCandidates(const vector<Candidate> &candidates) {
+	if (mLocalCandidatesCallback) {
+		mLocalCandidatesCallback(candidates);
+		return;
+	}
+
+	for (const Candidate &candidate : candidates)
+		triggerLocalCandidate(candidate);
+}
+
 void PeerConnection::triggerStateChange(State state) {
 	mState = state;
 	if (mStateChangeCallback)
@@ -269,6 +634,7 @@ void PeerConnection::triggerStateChange(State state) {
 
 void PeerConnection::triggerIceStateChange(IceState state) {
 	mIceState = state;
+	checkIceRestart();
 	if (mIceStateChangeCallback)
 		mIceStateChangeCallback(state);
 }
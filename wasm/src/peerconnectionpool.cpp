@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "peerconnectionpool.hpp"
+
+#include <emscripten/eventloop.h>
+
+#include <exception>
+
+namespace rtc {
+
+void PeerConnectionPool::ProcessCallback(void *ptr) {
+	PeerConnectionPool *p = static_cast<PeerConnectionPool *>(ptr);
+	if (p) {
+		p->mTimeout = 0;
+		p->process();
+	}
+}
+
+PeerConnectionPool::PeerConnectionPool(Configuration config, size_t size, bool preGather)
+    : mConfig(std::move(config)), mSize(size), mTimeout(0) {
+	// Browsers only gather before setLocalDescription if the candidate pool is not empty
+	if (preGather && mConfig.iceCandidatePoolSize == 0)
+		mConfig.iceCandidatePoolSize = 1;
+
+	schedule();
+}
+
+PeerConnectionPool::~PeerConnectionPool() {
+	if (mTimeout)
+		emscripten_clear_timeout(mTimeout);
+}
+
+shared_ptr<PeerConnection> PeerConnectionPool::acquire() {
+	shared_ptr<PeerConnection> peerConnection;
+	while (!mIdle.empty() && !peerConnection) {
+		auto front = std::move(mIdle.front());
+		mIdle.pop_front();
+		if (front->state() == PeerConnection::State::Failed ||
+		    front->state() == PeerConnection::State::Closed)
+			mRetired.push_back(std::move(front));
+		else
+			peerConnection = std::move(front);
+	}
+
+	if (!peerConnection)
+		peerConnection = create();
+
+	schedule();
+	return peerConnection;
+}
+
+void PeerConnectionPool::release(shared_ptr<PeerConnection> peerConnection) {
+	if (!peerConnection)
+		return;
+
+	// A used RTCPeerConnection can't be reset, so it is recycled by replacing it
+	mRetired.push_back(std::move(peerConnection));
+	schedule();
+}
+
+void PeerConnectionPool::resize(size_t size) {
+	mSize = size;
+	schedule();
+}
+
+size_t PeerConnectionPool::size() const { return mSize; }
+
+size_t PeerConnectionPool::available() const { return mIdle.size(); }
+
+shared_ptr<PeerConnection> PeerConnectionPool::create() {
+	return std::make_shared<PeerConnection>(mConfig);
+}
+
+void PeerConnectionPool::schedule() {
+	if (!mTimeout)
+		mTimeout = emscripten_set_timeout(ProcessCallback, 0, this);
+}
+
+void PeerConnectionPool::process() {
+	// Do one unit of work per event loop iteration to avoid blocking the page
+	if (!mRetired.empty()) {
+		auto peerConnection = std::move(mRetired.back());
+		mRetired.pop_back();
+		peerConnection->close();
+		peerConnection.reset(); // deleted if nobody else holds it
+
+	} else if (mIdle.size() > mSize) {
+		mRetired.push_back(std::move(mIdle.back()));
+		mIdle.pop_back();
+
+	} else if (mIdle.size() < mSize) {
+		try {
+			mIdle.push_back(create());
+		} catch (const std::exception &) {
+			return; // WebRTC not supported, don't retry
+		}
+	}
+
+	if (!mRetired.empty() || mIdle.size() != mSize)
+		schedule();
+}
+
+} // namespace rtc
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "peergroup.hpp"
+
+#include <algorithm>
+
+extern "C" {
+extern int js_rtcSendMessageMulti(const int *pIds, int count, const char *buffer, int size,
+                                  int *pBufferedAmounts);
+}
+
+namespace rtc {
+
+PeerGroup::PeerGroup(size_t laggingThreshold) : mLaggingThreshold(laggingThreshold) {}
+
+PeerGroup::~PeerGroup() {}
+
+void PeerGroup::join(string id, shared_ptr<PeerConnection> peerConnection,
+                     shared_ptr<DataChannel> dataChannel) {
+	if (!dataChannel)
+		throw std::invalid_argument("PeerGroup member must have a DataChannel");
+
+	auto it = std::find_if(mMembers.begin(), mMembers.end(),
+	                       [&id](const Member &m) { return m.id == id; });
+	if (it != mMembers.end()) {
+		it->peerConnection = std::move(peerConnection);
+		it->dataChannel = std::move(dataChannel);
+		mLagging[it - mMembers.begin()] = false;
+	} else {
+		mMembers.push_back(Member{id, std::move(peerConnection), std::move(dataChannel)});
+		mLagging.push_back(false);
+	}
+
+	if (mJoinCallback)
+		mJoinCallback(id);
+}
+
+bool PeerGroup::leave(const string &id) {
+	auto it = std::find_if(mMembers.begin(), mMembers.end(),
+	                       [&id](const Member &m) { return m.id == id; });
+	if (it == mMembers.end())
+		return false;
+
+	remove(it);
+	return true;
+}
+
+void PeerGroup::clear() {
+	while (!mMembers.empty())
+		remove(mMembers.end() - 1);
+}
+
+bool PeerGroup::contains(const string &id) const {
+	return std::any_of(mMembers.begin(), mMembers.end(),
+	                   [&id](const Member &m) { return m.id == id; });
+}
+
+size_t PeerGroup::size() const { return mMembers.size(); }
+
+const std::vector<PeerGroup::Member> &PeerGroup::members() const { return mMembers; }
+
+shared_ptr<DataChannel> PeerGroup::dataChannel(const string &id) const {
+	for (const auto &m : mMembers)
+		if (m.id == id)
+			return m.dataChannel;
+
+	return nullptr;
+}
+
+shared_ptr<PeerConnection> PeerGroup::peerConnection(const string &id) const {
+	for (const auto &m : mMembers)
+		if (m.id == id)
+			return m.peerConnection;
+
+	return nullptr;
+}
+
+size_t PeerGroup::broadcast(message_variant data) {
+	return std::visit(
+	    overloaded{[this](const binary &b) {
+		               auto data = reinterpret_cast<const char *>(b.data());
+		               return broadcast(data, int(b.size()), b.size());
+	               },
+	               [this](const string &s) { return broadcast(s.c_str(), -1, s.size()); }},
+	    std::move(data));
+}
+
+size_t PeerGroup::broadcast(const byte *data, size_t size) {
+	return broadcast(reinterpret_cast<const char *>(data), int(size), size);
+}
+
+size_t PeerGroup::broadcast(const char *data, int size, size_t length) {
+	// Members whose channel was closed leave the group
+	std::vector<string> closed;
+	for (const auto &m : mMembers)
+		if (m.dataChannel->isClosed())
+			closed.push_back(m.id);
+
+	for (const auto &id : closed)
+		leave(id);
+
+	mIds.clear();
+	for (const auto &m : mMembers)
+		mIds.push_back(m.dataChannel->mId);
+
+	mBufferedAmounts.assign(mIds.size(), -1);
+	if (mIds.empty())
+		return 0;
+
+	int sent = js_rtcSendMessageMulti(mIds.data(), int(mIds.size()), data, size,
+	                                  mBufferedAmounts.data());
+
+	// Callbacks are called afterwards as they might modify the group
+	std::vector<std::pair<string, size_t>> newlyLagging;
+	for (size_t i = 0; i < mMembers.size() && i < mBufferedAmounts.size(); ++i) {
+		DataChannel *dataChannel = mMembers[i].dataChannel.get();
+		if (mBufferedAmounts[i] >= 0) {
+			dataChannel->recordSent(length);
+			dataChannel->recordBufferedAmount(size_t(mBufferedAmounts[i]));
+		} else {
+			dataChannel->recordSendRejected();
+		}
+
+		bool lagging = mBufferedAmounts[i] >= 0 && size_t(mBufferedAmounts[i]) > mLaggingThreshold;
+		if (lagging && !mLagging[i])
+			newlyLagging.emplace_back(mMembers[i].id, size_t(mBufferedAmounts[i]));
+
+		mLagging[i] = lagging;
+	}
+
+	if (mLaggingCallback)
+		for (const auto &[id, amount] : newlyLagging)
+			mLaggingCallback(id, amount);
+
+	return sent > 0 ? size_t(sent) : 0;
+}
+
+std::vector<string> PeerGroup::lagging() const {
+	std::vector<string> result;
+	for (size_t i = 0; i < mMembers.size(); ++i)
+		if (mLagging[i])
+			result.push_back(mMembers[i].id);
+
+	return result;
+}
+
+void PeerGroup::setLaggingThreshold(size_t threshold) { mLaggingThreshold = threshold; }
+
+void PeerGroup::onJoin(std::function<void(const string &id)> callback) {
+	mJoinCallback = std::move(callback);
+}
+
+void PeerGroup::onLeave(std::function<void(const string &id)> callback) {
+	mLeaveCallback = std::move(callback);
+}
+
+void PeerGroup::onLagging(std::function<void(const string &id, size_t bufferedAmount)> callback) {
+	mLaggingCallback = std::move(callback);
+}
+
+void PeerGroup::remove(std::vector<Member>::iterator it) {
+	string id = std::move(it->id);
+	mLagging.erase(mLagging.begin() + (it - mMembers.begin()));
+	mMembers.erase(it);
+
+	if (mLeaveCallback)
+		mLeaveCallback(id);
+}
+
+} // namespace rtc
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "rttprobe.hpp"
+
+#include <emscripten/emscripten.h>
+#include <emscripten/eventloop.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace rtc {
+
+namespace {
+
+// Messages are a type byte followed by the sender timestamp, which is echoed back as is
+const uint8_t MessagePing = 0x01;
+const uint8_t MessagePong = 0x02;
+const size_t MessageSize = 1 + sizeof(double);
+
+} // namespace
+
+void RttProbe::PingCallback(void *ptr) {
+	RttProbe *p = static_cast<RttProbe *>(ptr);
+	if (p)
+		p->ping();
+}
+
+RttProbe::RttProbe(shared_ptr<PeerConnection> peerConnection, uint16_t stream,
+                   std::chrono::milliseconds interval)
+    : mInterval(interval), mIntervalId(0) {
+	if (!peerConnection)
+		throw std::invalid_argument("RttProbe requires a PeerConnection");
+
+	// Unreliable so that retransmissions don't skew measurements, lost pings are not counted
+	DataChannelInit init;
+	init.reliability.unordered = true;
+	init.reliability.maxRetransmits = 0;
+	init.negotiated = true;
+	init.id = stream;
+	init.protocol = "rtt-probe";
+	mDataChannel = peerConnection->createDataChannel("rtt-probe", std::move(init));
+
+	mDataChannel->onOpen([this]() { start(); });
+	mDataChannel->onClosed([this]() { stop(); });
+	mDataChannel->onMessage([this](binary message) { handleMessage(message); }, [](string) {});
+}
+
+RttProbe::~RttProbe() {
+	stop();
+	mDataChannel->onOpen(nullptr);
+	mDataChannel->onClosed(nullptr);
+	mDataChannel->onMessage(nullptr);
+	mDataChannel->close();
+}
+
+void RttProbe::setInterval(std::chrono::milliseconds interval) {
+	mInterval = interval;
+	if (mIntervalId) {
+		stop();
+		start();
+	}
+}
+
+RttProbe::Stats RttProbe::stats() const { return mStats; }
+
+optional<double> RttProbe::percentile(double p) const {
+	if (mStats.pongsReceived == 0)
+		return nullopt;
+
+	p = std::clamp(p, 0.0, 1.0);
+	auto rank = uint64_t(std::ceil(p * double(mStats.pongsReceived)));
+	uint64_t count = 0;
+	for (size_t i = 0; i < HistogramSize; ++i) {
+		count += mHistogram[i];
+		if (count >= rank && count > 0) {
+			// Upper bound of the bucket, capped by the observed extremes
+			double bound = HistogramBase * std::pow(HistogramFactor, double(i));
+			return std::clamp(bound, *mStats.min, *mStats.max);
+		}
+	}
+	return mStats.max;
+}
+
+void RttProbe::start() {
+	if (!mIntervalId)
+		mIntervalId = emscripten_set_interval(PingCallback, double(mInterval.count()), this);
+}
+
+void RttProbe::stop() {
+	if (mIntervalId) {
+		emscripten_clear_interval(mIntervalId);
+		mIntervalId = 0;
+	}
+}
+
+void RttProbe::ping() {
+	std::array<byte, MessageSize> message;
+	double now = emscripten_get_now();
+	message[0] = byte(MessagePing);
+	std::memcpy(message.data() + 1, &now, sizeof(now));
+	if (mDataChannel->send(message.data(), message.size()))
+		mStats.pingsSent++;
+}
+
+void RttProbe::handleMessage(const binary &message) {
+	if (message.size() != MessageSize)
+		return;
+
+	switch (std::to_integer<uint8_t>(message[0])) {
+	case MessagePing: {
+		binary pong(message);
+		pong[0] = byte(MessagePong);
+		mDataChannel->send(pong.data(), pong.size());
+		break;
+	}
+	case MessagePong: {
+		double sent;
+		std::memcpy(&sent, message.data() + 1, sizeof(sent));
+		double rtt = emscripten_get_now() - sent;
+		if (rtt >= 0)
+			addSample(rtt);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void RttProbe::addSample(double rtt) {
+	// Same estimators as the TCP retransmission timer (RFC 6298)
+	Stats &s = mStats;
+	if (s.smoothed) {
+		s.jitter = 0.75 * *s.jitter + 0.25 * std::abs(*s.smoothed - rtt);
+		s.smoothed = 0.875 * *s.smoothed + 0.125 * rtt;
+	} else {
+		s.jitter = rtt / 2;
+		s.smoothed = rtt;
+	}
+	s.last = rtt;
+	s.min = s.min ? std::min(*s.min, rtt) : rtt;
+	s.max = s.max ? std::max(*s.max, rtt) : rtt;
+	s.pongsReceived++;
+
+	size_t bucket = 0;
+	double bound = HistogramBase;
+	while (bucket < HistogramSize - 1 && rtt > bound) {
+		bound *= HistogramFactor;
+		++bucket;
+	}
+	mHistogram[bucket]++;
+}
+
+} // namespace rtc
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2017-2022 Paul-Louis Ageneau
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RTC_TRACE_H
+#define RTC_TRACE_H
+
+// Tracing of callbacks from the browser, enabled with the RTC_ENABLE_TRACE CMake option.
+// Entries are emitted as performance measures named "rtc:<name>".
+
+#if RTC_ENABLE_TRACE
+
+#include <emscripten/emscripten.h>
+
+extern "C" {
+extern void js_rtcTraceMeasure(const char *name, double start);
+}
+
+namespace rtc {
+
+class TraceScope final {
+public:
+	explicit TraceScope(const char *name) : mName(name), mStart(emscripten_get_now()) {}
+	~TraceScope() { js_rtcTraceMeasure(mName, mStart); }
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+	const char *mName;
+	double mStart;
+};
+
+} // namespace rtc
+
+#define RTC_TRACE_CONCAT_IMPL(a, b) a##b
+#define RTC_TRACE_CONCAT(a, b) RTC_TRACE_CONCAT_IMPL(a, b)
+#define RTC_TRACE_SCOPE(name) ::rtc::TraceScope RTC_TRACE_CONCAT(rtcTraceScope, __LINE__)(name)
+
+#else
+
+#define RTC_TRACE_SCOPE(name)
+
+#endif
+
+#endif // RTC_TRACE_H
@@ -24,14 +24,39 @@
 
 #include <cstring>
 #include <emscripten/emscripten.h>
+#include <emscripten/eventloop.h>
 #include <emscripten/websocket.h>
 
+#include <algorithm>
 #include <exception>
 #include <memory>
 
+extern "C" {
+extern int js_rtcIsWebSocketStreamSupported();
+extern int js_rtcCreateWebSocketStream(const char *url, const char *protocols, void *ptr,
+                                       void (*openCallback)(void *),
+                                       void (*errorCallback)(const char *, void *),
+                                       void (*messageCallback)(const char *, int, void *),
+                                       void (*closedCallback)(void *),
+                                       void (*bufferedAmountLowCallback)(void *));
+extern void js_rtcDeleteWebSocketStream(int ws);
+extern int js_rtcSendWebSocketStream(int ws, const char *buffer, int size);
+extern int js_rtcGetWebSocketStreamBufferedAmount(int ws);
+extern void js_rtcSetWebSocketStreamBufferedAmountLowThreshold(int ws, int threshold);
+extern void js_rtcSetWebSocketStreamPaused(int ws, int paused);
+}
+
 namespace rtc {
 
-EmscriptenWebSocketCreateAttributes ws_attrs = {"", NULL, EM_TRUE};
+const double BufferedAmountPollInterval = 10; // ms
+
+namespace {
+
+size_t messageSize(const message_variant &message) {
+	return std::visit([](const auto &m) { return m.size(); }, message);
+}
+
+} // namespace
 
 EM_BOOL WebSocket::OpenCallback(int eventType, const EmscriptenWebSocketOpenEvent *websocketEvent,
                                 void *userData) {
@@ -61,21 +86,98 @@ EM_BOOL WebSocket::MessageCallback(int eventType, const EmscriptenWebSocketMessa
 
 	if (w) {
 		if (e->data) {
-			if (e->numBytes >= 0) {
-				auto b = reinterpret_cast<const byte *>(e->data);
-				w->triggerMessage(binary(b, b + e->numBytes));
+			// For text messages, numBytes includes the null terminator
+			size_t size = e->isText && e->numBytes > 0 ? e->numBytes - 1 : e->numBytes;
+			if (size > w->maxMessageSize()) {
+				w->triggerError("Received message exceeds maximum size");
+			} else if (e->isText) {
+				w->triggerMessage(string(reinterpret_cast<const char *>(e->data), size));
 			} else {
-				w->triggerMessage(string((char *)e->data));
+				auto b = reinterpret_cast<const byte *>(e->data);
+				w->triggerMessage(binary(b, b + size));
 			}
 		} else {
-			w->close();
-			w->triggerClosed();
+			w->handleClose();
 		}
 	}
 	return 0;
 }
 
-WebSocket::WebSocket() : mId(0), mConnected(false) {}
+EM_BOOL WebSocket::CloseCallback(int eventType, const EmscriptenWebSocketCloseEvent *websocketEvent,
+                                 void *userData) {
+	WebSocket *w = static_cast<WebSocket *>(userData);
+	if (w)
+		w->handleClose();
+	return 0;
+}
+
+void WebSocket::StreamOpenCallback(void *ptr) {
+	WebSocket *w = static_cast<WebSocket *>(ptr);
+	if (w)
+		w->triggerOpen();
+}
+
+void WebSocket::StreamErrorCallback(const char *error, void *ptr) {
+	WebSocket *w = static_cast<WebSocket *>(ptr);
+	if (w)
+		w->triggerError(string(error ? error : "unknown"));
+}
+
+void WebSocket::StreamMessageCallback(const char *data, int size, void *ptr) {
+	WebSocket *w = static_cast<WebSocket *>(ptr);
+	if (w) {
+		size_t length = size >= 0 ? size_t(size) : std::strlen(data);
+		if (length > w->maxMessageSize()) {
+			w->triggerError("Received message exceeds maximum size");
+		} else if (size >= 0) {
+			auto *b = reinterpret_cast<const byte *>(data);
+			w->triggerMessage(binary(b, b + size));
+		} else {
+			w->triggerMessage(string(data, length));
+		}
+	}
+}
+
+void WebSocket::StreamClosedCallback(void *ptr) {
+	WebSocket *w = static_cast<WebSocket *>(ptr);
+	if (w)
+		w->handleClose();
+}
+
+void WebSocket::StreamBufferedAmountLowCallback(void *ptr) {
+	WebSocket *w = static_cast<WebSocket *>(ptr);
+	if (w)
+		w->triggerBufferedAmountLow();
+}
+
+void WebSocket::BufferedAmountPollCallback(void *userData) {
+	WebSocket *w = static_cast<WebSocket *>(userData);
+	if (w) {
+		w->mBufferedAmountPollTimeout = 0;
+		w->pollBufferedAmount();
+	}
+}
+
+void WebSocket::ReconnectCallback(void *userData) {
+	WebSocket *w = static_cast<WebSocket *>(userData);
+	if (w) {
+		w->mReconnectTimeout = 0;
+		try {
+			w->connect();
+		} catch (const std::exception &e) {
+			w->triggerError(e.what());
+			w->handleClose();
+		}
+	}
+}
+
+WebSocket::WebSocket() : WebSocket(Configuration()) {}
+
+WebSocket::WebSocket(Configuration config)
+    : mConfig(std::move(config)), mId(0), mStream(false), mConnected(false),
+      mReadingPaused(false), mBufferedAmountLowThreshold(0),
+      mBufferedAmountPollTimeout(0), mBufferedAmountWasHigh(false), mReconnecting(false),
+      mReconnectTimeout(0), mReconnectAttempt(0), mDisconnectTime(0), mQueuedBytes(0) {}
 
 WebSocket::~WebSocket() { close(); }
 
@@ -85,52 +187,305 @@ void WebSocket::open(const string &url) {
 		throw std::runtime_error("WebSocket not supported");
 	}
 
-	strcpy((char *)ws_attrs.url, url.c_str());
-	EMSCRIPTEN_WEBSOCKET_T ws = emscripten_websocket_new(&ws_attrs);
-	mId = ws;
+	mUrl = url;
+	mProtocols.clear();
+	for (const string &protocol : mConfig.protocols) {
+		if (!mProtocols.empty())
+			mProtocols += ',';
+		mProtocols += protocol;
+	}
 
-	emscripten_websocket_set_onopen_callback(ws, this, OpenCallback);
-	emscripten_websocket_set_onerror_callback(ws, this, ErrorCallback);
-	emscripten_websocket_set_onmessage_callback(ws, this, MessageCallback);
+	connect();
 }
 
 void WebSocket::close() {
-	mConnected = false;
-	if (mId) {
-		emscripten_websocket_close(mId, 0, 0);
-		mId = 0;
+	if (mReconnectTimeout) {
+		emscripten_clear_timeout(mReconnectTimeout);
+		mReconnectTimeout = 0;
 	}
+	mReconnecting = false;
+	mReconnectAttempt = 0;
+	mQueue = {};
+	mQueuedBytes = 0;
+	closeSocket();
 }
 
 bool WebSocket::isOpen() const { return mConnected; }
 
-bool WebSocket::isClosed() const { return mId == 0; }
+bool WebSocket::isClosed() const { return mId == 0 && !mReconnecting; }
 
-bool WebSocket::send(message_variant message) {
+size_t WebSocket::bufferedAmount() const {
 	if (!mId)
+		return mQueuedBytes;
+
+	if (mStream)
+		return size_t(js_rtcGetWebSocketStreamBufferedAmount(mId)) + mQueuedBytes;
+
+	size_t amount = 0;
+	if (emscripten_websocket_get_buffered_amount(mId, &amount) < 0)
+		return mQueuedBytes;
+
+	return amount + mQueuedBytes;
+}
+
+size_t WebSocket::maxMessageSize() const {
+	return mConfig.maxMessageSize.value_or(DEFAULT_WS_MAX_MESSAGE_SIZE);
+}
+
+void WebSocket::setBufferedAmountLowThreshold(size_t amount) {
+	mBufferedAmountLowThreshold = amount;
+	if (mStream && mId)
+		js_rtcSetWebSocketStreamBufferedAmountLowThreshold(mId, int(amount));
+}
+
+WebSocket::ReconnectMetrics WebSocket::reconnectMetrics() const { return mReconnectMetrics; }
+
+void WebSocket::pauseReading() {
+	mReadingPaused = true;
+	if (mStream && mId)
+		js_rtcSetWebSocketStreamPaused(mId, 1);
+}
+
+void WebSocket::resumeReading() {
+	mReadingPaused = false;
+	if (mStream && mId)
+		js_rtcSetWebSocketStreamPaused(mId, 0);
+}
+
+bool WebSocket::isReadingPaused() const { return mReadingPaused; }
+
+bool WebSocket::isStream() const { return mStream; }
+
+bool WebSocket::send(message_variant message) {
+	if (messageSize(message) > maxMessageSize()) {
+		recordSendRejected();
+		return false;
+	}
+
+	if (!mConnected && mConfig.autoReconnect && !isClosed())
+		return enqueue(std::move(message));
+
+	// Don't overtake messages still waiting to be replayed
+	if (!mQueue.empty()) {
+		bool ret = enqueue(std::move(message));
+		flushQueue();
+		return ret;
+	}
+
+	if (!mId) {
+		recordSendRejected();
 		return false;
+	}
 
-	return std::visit(
-	    overloaded{[this](const binary &b) {
-		               auto data = reinterpret_cast<const char *>(b.data());
-		               return emscripten_websocket_send_binary(mId, (void *)data, b.size()) >= 0;
-	               },
-	               [this](const string &s) {
-		               return emscripten_websocket_send_utf8_text(mId, s.c_str()) >= 0;
-	               }},
-	    std::move(message));
+	bool ret = sendNow(message);
+	if (ret)
+		pollBufferedAmount();
+
+	return ret;
 }
 
 bool WebSocket::send(const byte *data, size_t size) {
-	if (!mId)
+	if (size > maxMessageSize()) {
+		recordSendRejected();
 		return false;
+	}
 
-	return emscripten_websocket_send_binary(mId, (void *) data, size) >= 0;
+	if (!mConnected && mConfig.autoReconnect && !isClosed())
+		return enqueue(binary(data, data + size));
+
+	if (!mQueue.empty()) {
+		bool ret = enqueue(binary(data, data + size));
+		flushQueue();
+		return ret;
+	}
+
+	if (!mId) {
+		recordSendRejected();
+		return false;
+	}
+
+	bool ret = sendBinary(data, size);
+	if (ret)
+		pollBufferedAmount();
+
+	return ret;
 }
 
 void WebSocket::triggerOpen() {
 	mConnected = true;
+
+	if (mReconnecting) {
+		using std::chrono::milliseconds;
+		auto latency = milliseconds(int64_t(emscripten_get_now() - mDisconnectTime));
+		mReconnectMetrics.reconnections++;
+		mReconnectMetrics.lastLatency = latency;
+		mReconnectMetrics.maxLatency = std::max(mReconnectMetrics.maxLatency, latency);
+		mReconnectMetrics.totalLatency += latency;
+		mReconnecting = false;
+	}
+	mReconnectAttempt = 0;
+
+	// Replay queued messages before notifying so that ordering is preserved
+	flushQueue();
 	Channel::triggerOpen();
 }
 
+void WebSocket::connect() {
+	if (mConfig.preferWebSocketStream && js_rtcIsWebSocketStreamSupported()) {
+		mId = js_rtcCreateWebSocketStream(
+		    mUrl.c_str(), !mProtocols.empty() ? mProtocols.c_str() : nullptr, this,
+		    StreamOpenCallback, StreamErrorCallback, StreamMessageCallback, StreamClosedCallback,
+		    StreamBufferedAmountLowCallback);
+		if (!mId)
+			throw std::runtime_error("WebSocketStream creation failed");
+
+		mStream = true;
+		js_rtcSetWebSocketStreamBufferedAmountLowThreshold(mId, int(mBufferedAmountLowThreshold));
+		if (mReadingPaused)
+			js_rtcSetWebSocketStreamPaused(mId, 1);
+
+		return;
+	}
+
+	// Attributes are owned by each WebSocket so that several sockets can be opened concurrently
+	EmscriptenWebSocketCreateAttributes attrs;
+	attrs.url = mUrl.c_str();
+	attrs.protocols = !mProtocols.empty() ? mProtocols.c_str() : NULL;
+	attrs.createOnMainThread = EM_TRUE;
+
+	EMSCRIPTEN_WEBSOCKET_T ws = emscripten_websocket_new(&attrs);
+	if (ws <= 0)
+		throw std::runtime_error("WebSocket creation failed");
+
+	mId = ws;
+
+	emscripten_websocket_set_onopen_callback(ws, this, OpenCallback);
+	emscripten_websocket_set_onerror_callback(ws, this, ErrorCallback);
+	emscripten_websocket_set_onmessage_callback(ws, this, MessageCallback);
+	emscripten_websocket_set_onclose_callback(ws, this, CloseCallback);
+}
+
+void WebSocket::closeSocket() {
+	cancelBufferedAmountPoll();
+	mConnected = false;
+	if (mId) {
+		if (mStream) {
+			js_rtcDeleteWebSocketStream(mId);
+		} else {
+			emscripten_websocket_close(mId, 0, 0);
+			emscripten_websocket_delete(mId); // also unregisters callbacks
+		}
+		mId = 0;
+	}
+	mStream = false;
+}
+
+void WebSocket::handleClose() {
+	bool wasReconnecting = mReconnecting;
+	closeSocket();
+
+	if (mConfig.autoReconnect && !mUrl.empty() &&
+	    (!mConfig.maxReconnectAttempts || mReconnectAttempt < *mConfig.maxReconnectAttempts)) {
+		if (!wasReconnecting)
+			mDisconnectTime = emscripten_get_now();
+
+		scheduleReconnect();
+		return;
+	}
+
+	close();
+	triggerClosed();
+}
+
+void WebSocket::scheduleReconnect() {
+	// Exponential backoff with equal jitter: the delay is drawn in [d/2, d]
+	double initial = double(mConfig.reconnectInitialDelay.count());
+	double max = double(mConfig.reconnectMaxDelay.count());
+	double delay = std::min(max, initial * double(1u << std::min(mReconnectAttempt, 16u)));
+	delay = delay / 2 + emscripten_random() * delay / 2;
+
+	mReconnecting = true;
+	mReconnectAttempt++;
+	mReconnectMetrics.attempts++;
+	mReconnectTimeout = emscripten_set_timeout(ReconnectCallback, delay, this);
+}
+
+bool WebSocket::enqueue(message_variant message) {
+	size_t size = messageSize(message);
+	if (mQueuedBytes + size > mConfig.reconnectBufferSize) {
+		mReconnectMetrics.droppedMessages++;
+		recordSendRejected();
+		return false;
+	}
+
+	mQueuedBytes += size;
+	mQueue.push(std::move(message));
+	return true;
+}
+
+void WebSocket::flushQueue() {
+	while (!mQueue.empty() && mConnected) {
+		if (!sendNow(mQueue.front()))
+			break;
+
+		mQueuedBytes -= messageSize(mQueue.front());
+		mQueue.pop();
+	}
+	pollBufferedAmount();
+}
+
+bool WebSocket::sendNow(const message_variant &message) {
+	return std::visit(overloaded{[this](const binary &b) { return sendBinary(b.data(), b.size()); },
+	                             [this](const string &s) { return sendText(s); }},
+	                  message);
+}
+
+bool WebSocket::sendBinary(const byte *data, size_t size) {
+	auto buffer = reinterpret_cast<const char *>(data);
+	bool ret = mStream ? js_rtcSendWebSocketStream(mId, buffer, int(size)) >= 0
+	                   : emscripten_websocket_send_binary(mId, (void *)data, size) >= 0;
+	if (ret)
+		recordSent(size);
+	else
+		recordSendRejected();
+
+	return ret;
+}
+
+bool WebSocket::sendText(const string &text) {
+	bool ret = mStream ? js_rtcSendWebSocketStream(mId, text.c_str(), -1) >= 0
+	                   : emscripten_websocket_send_utf8_text(mId, text.c_str()) >= 0;
+	if (ret)
+		recordSent(text.size());
+	else
+		recordSendRejected();
+
+	return ret;
+}
+
+void WebSocket::pollBufferedAmount() {
+	// WebSocketStream reports writes completion, so it does not need polling
+	if (!mId || mStream || mBufferedAmountPollTimeout)
+		return;
+
+	size_t amount = bufferedAmount();
+	recordBufferedAmount(amount);
+	if (amount > mBufferedAmountLowThreshold) {
+		mBufferedAmountPollTimeout =
+		    emscripten_set_timeout(BufferedAmountPollCallback, BufferedAmountPollInterval, this);
+		mBufferedAmountWasHigh = true;
+	} else if (mBufferedAmountWasHigh) {
+		mBufferedAmountWasHigh = false;
+		triggerBufferedAmountLow();
+	}
+}
+
+void WebSocket::cancelBufferedAmountPoll() {
+	if (mBufferedAmountPollTimeout) {
+		emscripten_clear_timeout(mBufferedAmountPollTimeout);
+		mBufferedAmountPollTimeout = 0;
+	}
+	mBufferedAmountWasHigh = false;
+}
+
 } // namespace rtc